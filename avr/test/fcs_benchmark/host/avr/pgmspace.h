@@ -0,0 +1,9 @@
+//    avr/pgmspace.h
+//
+//    This header stands in for the avr-libc program memory definitions
+//    when the fcs sources are compiled for the host.  Program memory
+//    data is just ordinary data on the host.
+//
+#pragma once
+#define PROGMEM
+#define pgm_read_word(addr) (*(addr))
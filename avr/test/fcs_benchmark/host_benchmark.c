@@ -0,0 +1,130 @@
+//*******************************************************************
+//    host_benchmark.c
+//
+//    This creates a host side benchmark for the frame check sequence
+//    engines in userver/fcs.c.  The Makefile builds fcs.c once for each
+//    FCS_IMPLEMENTATION with its functions renamed, so that all three
+//    can be linked here.  Each engine is checked against the RFC 1662
+//    check value and against the others over random frames, and the
+//    host time per byte is reported.  Host times only rank the engines;
+//    the avr cycle counts and footprints come from the simulavr target.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define INITFCS 0xffff
+#define GOODFCS 0xf0b8
+
+// the engines, one for each FCS_IMPLEMENTATION
+unsigned int fcs_calcFcs_0(unsigned int fcs, unsigned char* cp, unsigned int len);
+unsigned int fcs_updateFcs_0(unsigned int fcs, unsigned char ch);
+unsigned int fcs_calcFcs_1(unsigned int fcs, unsigned char* cp, unsigned int len);
+unsigned int fcs_updateFcs_1(unsigned int fcs, unsigned char ch);
+unsigned int fcs_calcFcs_2(unsigned int fcs, unsigned char* cp, unsigned int len);
+unsigned int fcs_updateFcs_2(unsigned int fcs, unsigned char ch);
+
+typedef struct {
+    const char *name;
+    unsigned int (*calcFcs)(unsigned int fcs, unsigned char* cp, unsigned int len);
+    unsigned int (*updateFcs)(unsigned int fcs, unsigned char ch);
+} Engine;
+
+static const Engine engines[] = {
+    { "FCS_IMPL_SRAM_TABLE  ", fcs_calcFcs_0, fcs_updateFcs_0 },
+    { "FCS_IMPL_FLASH_TABLE ", fcs_calcFcs_1, fcs_updateFcs_1 },
+    { "FCS_IMPL_NIBBLE_TABLE", fcs_calcFcs_2, fcs_updateFcs_2 }
+};
+#define ENGINE_COUNT (sizeof(engines)/sizeof(engines[0]))
+
+// the size of the frames timed and the number of passes over them
+#define FRAME_SIZE 128
+#define PASSES     200000
+
+//*******************************************************************
+// now()
+//
+// returns:
+//    the time in nanoseconds from an arbitrary start
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+//*******************************************************************
+// checkEngine()
+//
+// returns:
+//    true if the engine gives the RFC 1662 check value for "123456789"
+//    and a frame carrying its own fcs checks as good
+static int checkEngine(const Engine *e) {
+    unsigned char frame[11] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    unsigned int fcs = e->calcFcs(INITFCS, frame, 9) ^ 0xffff;
+    unsigned int update = INITFCS;
+    for (int i = 0; i < 9; i++) update = e->updateFcs(update, frame[i]);
+    frame[9] = fcs & 0xff;
+    frame[10] = fcs >> 8;
+    return (fcs == 0x906e) && ((update ^ 0xffff) == fcs) && (e->calcFcs(INITFCS, frame, 11) == GOODFCS);
+}
+
+int main()
+{
+    static unsigned char frame[FRAME_SIZE];
+    int failures = 0;
+
+    // every engine must agree with the first over random frames of
+    // every length
+    srand(1);
+    for (int n = 0; n < 10000; n++) {
+        unsigned int length = rand() % (FRAME_SIZE + 1);
+        for (unsigned int i = 0; i < length; i++) frame[i] = rand();
+        unsigned int expected = engines[0].calcFcs(INITFCS, frame, length);
+        for (unsigned int e = 1; e < ENGINE_COUNT; e++) {
+            if (engines[e].calcFcs(INITFCS, frame, length) != expected) {
+                printf("%s disagrees on frame %d\n", engines[e].name, n);
+                failures++;
+            }
+        }
+    }
+
+    for (unsigned int e = 0; e < ENGINE_COUNT; e++) {
+        const Engine *engine = &engines[e];
+        int pass = checkEngine(engine);
+        if (!pass) failures++;
+
+        volatile unsigned int sink;
+        double start = now();
+        for (int p = 0; p < PASSES; p++) sink = engine->calcFcs(INITFCS, frame, FRAME_SIZE);
+        double calc = (now() - start) / ((double)PASSES * FRAME_SIZE);
+
+        start = now();
+        for (int p = 0; p < PASSES; p++) {
+            unsigned int fcs = INITFCS;
+            for (int i = 0; i < FRAME_SIZE; i++) fcs = engine->updateFcs(fcs, frame[i]);
+            sink = fcs;
+        }
+        double update = (now() - start) / ((double)PASSES * FRAME_SIZE);
+        (void)sink;
+
+        printf("%s: calcFcs %5.2f ns/byte, updateFcs %5.2f ns/byte%s\n",
+            engine->name, calc, update, pass ? "" : " FAIL");
+    }
+    printf(failures ? "fcs host benchmark: FAIL\n" : "fcs host benchmark: PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a frame check sequence benchmark for the atmega328p.
+//    It is meant to be run under simulavr (see the Makefile), which
+//    builds it once for each FCS_IMPLEMENTATION.  Timer 1 counts cpu
+//    clocks around fcs_calcFcs() over a block of data and around a loop
+//    of fcs_updateFcs() calls, and the cost of an empty call is taken
+//    off, so that the cycles per byte of the engine are reported.  The
+//    result is also checked against the RFC 1662 check value.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__
+#define __AVR_ATmega328P__
+#endif
+
+#include <avr/io.h>
+#include "fcs.h"
+
+#ifndef F_CPU
+    #define F_CPU 16000000
+#endif
+
+// the number of bytes timed.  The longest run must fit in the 16 bit
+// count of timer 1.
+#define BLOCK_SIZE 256
+
+static unsigned char block[BLOCK_SIZE];
+static volatile unsigned int result;
+
+/********************************************************************
+* print helpers
+*
+* blocking writes to the uart.  Simulavr echoes the uart output to
+* stdout.
+*/
+static void putChar(char ch) {
+    while (!(UCSR0A & (1<<UDRE0)));
+    UDR0 = ch;
+}
+
+static void putString(const char *str) {
+    while (*str) putChar(*str++);
+}
+
+static void putLong(long value) {
+    char digits[11];
+    unsigned char n = 0;
+    unsigned long magnitude = value;
+    if (value < 0) {
+        putChar('-');
+        magnitude = -value;
+    }
+    do {
+        digits[n++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    while (n) putChar(digits[--n]);
+}
+
+// print a count of cycles per byte with two decimal places
+static void putPerByte(unsigned int cycles) {
+    unsigned long hundredths = ((unsigned long)cycles*100 + BLOCK_SIZE/2) / BLOCK_SIZE;
+    putLong(hundredths/100);
+    putChar('.');
+    putChar('0' + (hundredths%100)/10);
+    putChar('0' + hundredths%10);
+}
+
+/********************************************************************
+* timeCalc()
+*
+* returns:
+*    the cpu clocks taken by fcs_calcFcs() over the first len bytes of
+*    the block
+*/
+static unsigned int timeCalc(unsigned int len) {
+    unsigned int start = TCNT1;
+    result = fcs_calcFcs(INITFCS, block, len);
+    return TCNT1 - start;
+}
+
+/********************************************************************
+* timeUpdate()
+*
+* returns:
+*    the cpu clocks taken by a loop of fcs_updateFcs() calls over the
+*    first len bytes of the block
+*/
+static unsigned int timeUpdate(unsigned int len) {
+    unsigned int fcs = INITFCS;
+    unsigned int start = TCNT1;
+    for (unsigned int i = 0; i < len; i++) fcs = fcs_updateFcs(fcs, block[i]);
+    unsigned int end = TCNT1;
+    result = fcs;
+    return end - start;
+}
+
+/********************************************************************
+* checkFcs()
+*
+* returns:
+*    non-zero if both fcs functions give the RFC 1662 check value for
+*    "123456789" and a frame carrying its own fcs checks as good
+*/
+static unsigned char checkFcs() {
+    unsigned char frame[11] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    unsigned int fcs = fcs_calcFcs(INITFCS, frame, 9);
+    unsigned int update = INITFCS;
+    for (unsigned char i = 0; i < 9; i++) update = fcs_updateFcs(update, frame[i]);
+
+    fcs ^= 0xffff;
+    frame[9] = fcs & 0xff;
+    frame[10] = fcs >> 8;
+    return (fcs == 0x906e) && ((update ^ 0xffff) == fcs) && (fcs_calcFcs(INITFCS, frame, 11) == GOODFCS);
+}
+
+int main(void)
+{
+    // set the uart for 9600 baud, 8 bits, no parity, one stop bit
+    UBRR0 = (F_CPU/16)/9600-1;
+    UCSR0B = (1<<TXEN0);
+    UCSR0C = (1<<UCSZ01) | (1<<UCSZ00);
+
+    // timer 1 counts cpu clocks
+    TCCR1A = 0x00;
+    TCCR1B = 0x01;
+
+    // the block includes every byte value
+    for (unsigned int i = 0; i < BLOCK_SIZE; i++) block[i] = i * 7;
+
+    unsigned int calc = timeCalc(BLOCK_SIZE) - timeCalc(0);
+    unsigned int update = timeUpdate(BLOCK_SIZE) - timeUpdate(0);
+    unsigned char pass = checkFcs();
+
+    putString("fcs implementation ");
+    putLong(FCS_IMPLEMENTATION);
+    putString(": calcFcs ");
+    putPerByte(calc);
+    putString(" cycles/byte, updateFcs ");
+    putPerByte(update);
+    putString(" cycles/byte");
+    putString(pass ? " PASS\r\n" : " FAIL\r\n");
+
+    while (1);
+    return 0;
+}
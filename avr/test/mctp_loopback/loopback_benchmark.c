@@ -0,0 +1,248 @@
+//*******************************************************************
+//    loopback_benchmark.c
+//
+//    This creates a host side benchmark for the uart loopback program.
+//    MCTP packets of several sizes are sent to the board one at a time
+//    and the echo of each one is timed.  For each size the round trip
+//    time and the payload throughput are reported, along with the time
+//    the bytes themselves take on the wire, so that the processing time
+//    of the board shows up as the difference.  This builds for linux
+//    (see the benchmark target of the Makefile).
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include "fcs.h"
+
+// the escape and sync characters and the header fields used by the
+// loopback program (see mctp.h)
+#define ESCAPE_CHAR        0x7D
+#define SYNC_CHAR          0x7E
+#define MCTP_SERIAL_REV    0x01
+#define MCTP_MESSAGE_TYPE  0x01
+
+// the largest payload that fits in the receive buffer of the board
+#define MAX_PAYLOAD 120
+
+// packets sent at each size
+#define DEFAULT_COUNT 50
+
+// the time allowed for the board to start after the port is opened
+// (opening the port resets the board into its bootloader)
+#define STARTUP_MS 2500
+
+static int port;
+
+//*******************************************************************
+// now()
+//
+// returns:
+//    the time in microseconds from an arbitrary start
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+//*******************************************************************
+// openPort()
+//
+// open the serial port for raw 8 bit data at the given baud rate.
+// termios2 is used so that rates without a Bxxx constant (250000)
+// can be set.
+//
+// parameters:
+//    name - the name of the serial device (e.g. "/dev/ttyUSB0")
+//    baud - the baud rate
+// returns:
+//    true if the port was opened
+static int openPort(const char *name, unsigned int baud) {
+    struct termios2 tio;
+    port = open(name, O_RDWR | O_NOCTTY);
+    if (port < 0) return 0;
+    if (ioctl(port, TCGETS2, &tio) < 0) return 0;
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    return ioctl(port, TCSETS2, &tio) == 0;
+}
+
+//*******************************************************************
+// buildFrame()
+//
+// build a serial MCTP frame around a payload, in the format expected
+// by the loopback program.
+//
+// parameters:
+//    frame - where to write the frame (at least 2*size+13 bytes)
+//    payload - the payload
+//    size - the number of payload bytes
+// returns:
+//    the number of bytes in the frame
+static unsigned int buildFrame(unsigned char *frame, const unsigned char *payload, unsigned int size) {
+    unsigned char header[] = { SYNC_CHAR, MCTP_SERIAL_REV, size + 5, 0x01, 0x00, 0x00, 0xC8, MCTP_MESSAGE_TYPE };
+    unsigned int fcs = fcs_calcFcs(INITFCS, header, sizeof(header));
+    fcs = fcs_calcFcs(fcs, (unsigned char*)payload, size);
+
+    unsigned int length = sizeof(header);
+    memcpy(frame, header, length);
+    for (unsigned int i = 0; i < size; i++) {
+        if ((payload[i] == SYNC_CHAR) || (payload[i] == ESCAPE_CHAR)) {
+            frame[length++] = ESCAPE_CHAR;
+            frame[length++] = payload[i] - 0x20;
+        } else {
+            frame[length++] = payload[i];
+        }
+    }
+    frame[length++] = (fcs >> 8) & 0xff;
+    frame[length++] = fcs & 0xff;
+    frame[length++] = SYNC_CHAR;
+    return length;
+}
+
+//*******************************************************************
+// receiveFrame()
+//
+// wait for a frame from the board and check its fcs.  The frame
+// format is the same as that of buildFrame().  Anything that is not
+// a good frame is skipped.
+//
+// parameters:
+//    payload - where to place the received payload
+//    deadline - the time (see now()) to give up at
+// returns:
+//    the number of payload bytes, or -1 on timeout
+static int receiveFrame(unsigned char *payload, double deadline) {
+    unsigned char raw[2*MAX_PAYLOAD + 16];
+    unsigned int length = 0;
+
+    while (1) {
+        double left = deadline - now();
+        if (left <= 0) return -1;
+        struct pollfd pfd = { port, POLLIN, 0 };
+        if (poll(&pfd, 1, (int)(left/1000) + 1) <= 0) continue;
+        unsigned char ch;
+        if (read(port, &ch, 1) != 1) continue;
+
+        // collect bytes from a sync character.  The header bytes are
+        // not escaped, so the length is taken from the third byte.
+        if ((length == 0) && (ch != SYNC_CHAR)) continue;
+        if (length >= sizeof(raw)) length = 0;
+        raw[length++] = ch;
+        if ((length == 2) && (ch != MCTP_SERIAL_REV)) length = (ch == SYNC_CHAR) ? 1 : 0;
+        if ((length < 8) || (ch != SYNC_CHAR)) continue;
+        if (raw[2] < 5) {
+            length = 1;
+            continue;
+        }
+
+        // a sync character after the header ends the frame - remove
+        // the escapes and check the length and the fcs
+        unsigned int size = 0;
+        unsigned int i;
+        for (i = 8; i < length - 3; i++) {
+            if (raw[i] == ESCAPE_CHAR) payload[size++] = raw[++i] + 0x20;
+            else payload[size++] = raw[i];
+        }
+        unsigned int fcs = fcs_calcFcs(INITFCS, raw, 8);
+        fcs = fcs_calcFcs(fcs, payload, size);
+        if ((i == length - 3) && (size == (unsigned int)raw[2] - 5) &&
+            (fcs == (((unsigned int)raw[length-3] << 8) | raw[length-2]))) return size;
+
+        // not a good frame - this sync may start the next one
+        raw[0] = SYNC_CHAR;
+        length = 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const unsigned int sizes[] = { 1, 8, 32, 64, MAX_PAYLOAD };
+    if (argc < 3) {
+        printf("usage: %s <serial device> <baud rate> [packets per size]\n", argv[0]);
+        return 1;
+    }
+    unsigned int baud = atoi(argv[2]);
+    unsigned int count = (argc > 3) ? atoi(argv[3]) : DEFAULT_COUNT;
+    if (!openPort(argv[1], baud)) {
+        printf("unable to open %s at %u baud\n", argv[1], baud);
+        return 1;
+    }
+
+    // wait for the board to start and throw away its greeting
+    usleep(STARTUP_MS*1000);
+    ioctl(port, TCFLSH, TCIFLUSH);
+
+    unsigned int failures = 0;
+    for (unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+        unsigned int size = sizes[s];
+        unsigned char payload[MAX_PAYLOAD];
+        unsigned char echo[MAX_PAYLOAD];
+        unsigned char frame[2*MAX_PAYLOAD + 16];
+        unsigned int good = 0;
+        unsigned int wireBytes = 0;
+        double total = 0, shortest = 1e12, longest = 0;
+        double start = now();
+
+        for (unsigned int n = 0; n < count; n++) {
+            // the payload pattern includes sync and escape characters
+            for (unsigned int i = 0; i < size; i++) payload[i] = (n*31 + i*7) & 0xff;
+            unsigned int length = buildFrame(frame, payload, size);
+
+            // allow ten times the time on the wire for the echo
+            double sent = now();
+            if (write(port, frame, length) != length) break;
+            double deadline = sent + 10*(2*length*10*1e6)/baud + 100000;
+            int received = receiveFrame(echo, deadline);
+            double rtt = now() - sent;
+            if ((received != (int)size) || (memcmp(echo, payload, size))) {
+                // let anything still in flight arrive before the next packet
+                usleep(100000);
+                ioctl(port, TCFLSH, TCIFLUSH);
+                continue;
+            }
+            good++;
+            wireBytes = length;
+            total += rtt;
+            if (rtt < shortest) shortest = rtt;
+            if (rtt > longest) longest = rtt;
+        }
+        double elapsed = now() - start;
+        if (good < count) failures++;
+
+        // the time each frame takes on the wire, each way
+        double wire = (wireBytes*10*1e6)/baud;
+        printf("%7u baud %3u byte payload: %3u/%u echoed, round trip mean %8.0f us "
+            "(min %8.0f, max %8.0f, wire %8.0f), throughput %7.0f bytes/s\n",
+            baud, size, good, count, good ? total/good : 0.0, good ? shortest : 0.0,
+            longest, 2*wire, (good*size)/(elapsed/1e6));
+    }
+    close(port);
+    return failures ? 1 : 0;
+}
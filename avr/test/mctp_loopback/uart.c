@@ -32,8 +32,11 @@
 #include <avr/interrupt.h>
 #include "uart.h"
 
-// Baud rate.
+// Baud rate.  This can be overridden from the make command line (see
+// the benchmark target of the Makefile).
+#ifndef BAUD
 #define BAUD 38400
+#endif
 #define BUFFERSIZE 64    // this must be an 8-bit power of 2
 #define BIT2NUM(bit) (1<<bit)
 
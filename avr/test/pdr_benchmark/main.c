@@ -0,0 +1,250 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a GetPDR record lookup benchmark for the atmega328p.
+//    It is meant to be run under simulavr (see the Makefile) with the
+//    stepper configuration, the largest repository.  For each record,
+//    timer 1 counts the cpu clocks taken to look the record up and
+//    read its bytes from program memory two ways:
+//
+//    before - the repository is scanned from the first record on every
+//             lookup, and the record size is looked up again in the
+//             loop condition, as GetPDR did before __pdr_index.
+//    after  - the offset, size and crc8 are read from __pdr_index, as
+//             node.c does now.
+//
+//    The lookup functions of node.c are static, so both ways are copied
+//    here.  The frame transmit is the same for both and is not
+//    included, nor is the crc8 that multi-part transfers used to add up
+//    byte by byte.  The two ways must agree on every record and the
+//    crc8 in the index must match the record data.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__
+#define __AVR_ATmega328P__
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "pldm.h"
+
+#ifndef F_CPU
+    #define F_CPU 16000000
+#endif
+
+// timer 1 bits 16-31, counted by the overflow interrupt
+static volatile unsigned int clock_high;
+
+// the bytes read are summed here so that the reads are not optimized out
+static volatile unsigned char sink;
+
+/********************************************************************
+* TIMER1_OVF_vect
+*
+* interrupt handler for timer 1 overflow.  Timer 1 runs from the cpu
+* clock and is extended to 32 bits here.
+*/
+ISR(TIMER1_OVF_vect) {
+    clock_high++;
+}
+
+/********************************************************************
+* readClock()
+*
+* returns:
+*    the number of cpu clocks since timer 1 was started
+*/
+static unsigned long readClock() {
+    __builtin_avr_cli();
+    unsigned int low = TCNT1;
+    unsigned long high = clock_high;
+    if ((TIFR1 & (1<<TOV1)) && (low < 0x8000)) high++;
+    __builtin_avr_sei();
+    return (high << 16) | low;
+}
+
+/********************************************************************
+* print helpers
+*
+* blocking writes to the uart.  Simulavr echoes the uart output to
+* stdout.
+*/
+static void putChar(char ch) {
+    while (!(UCSR0A & (1<<UDRE0)));
+    UDR0 = ch;
+}
+
+static void putString(const char *str) {
+    while (*str) putChar(*str++);
+}
+
+static void putLong(long value) {
+    char digits[11];
+    unsigned char n = 0;
+    unsigned long magnitude = value;
+    if (value < 0) {
+        putChar('-');
+        magnitude = -value;
+    }
+    do {
+        digits[n++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    while (n) putChar(digits[--n]);
+}
+
+static void putLabel(const char *label, long value) {
+    putString(label);
+    putLong(value);
+}
+
+/********************************************************************
+* scanOffset()
+*
+* the offset of a record found by scanning the repository from the
+* first record (the lookup used before __pdr_index).
+*/
+static unsigned int scanOffset(unsigned int index) {
+    if (index > 0) index--;
+    PdrCommonHeader* hdr = (PdrCommonHeader*)(__pdr_data);
+    unsigned int offset = 0;
+    unsigned int counter = 0;
+    while (counter != index) {
+        offset = offset + sizeof(PdrCommonHeader) + pgm_read_word(&(hdr->dataLength));
+        hdr = (PdrCommonHeader*)(&__pdr_data[offset]);
+        if (pgm_read_byte(&(__pdr_data[offset])) == 0) return 0;
+        counter++;
+    }
+    return offset;
+}
+
+/********************************************************************
+* scanSize()
+*
+* the size of a record found by scanning the repository from the
+* first record (the lookup used before __pdr_index).
+*/
+static unsigned int scanSize(unsigned int index) {
+    PdrCommonHeader* hdr = (PdrCommonHeader*)(&__pdr_data[scanOffset(index)]);
+    return pgm_read_word(&(hdr->dataLength)) + sizeof(PdrCommonHeader);
+}
+
+/********************************************************************
+* indexEntry()
+*
+* the index entry of a record (the lookup used by node.c now).
+*/
+static PDR_INDEX_TYPE *indexEntry(unsigned long handle) {
+    if (handle > 0) handle--;
+    if (handle >= PDR_NUMBER_OF_RECORDS) return 0;
+    return &__pdr_index[handle];
+}
+
+/********************************************************************
+* readBefore()
+*
+* look up and read a record the way GetPDR did before __pdr_index.  The
+* size is looked up again for every byte, as the loop condition did.
+*/
+static void readBefore(unsigned int handle, unsigned int *offset, unsigned int *size) {
+    unsigned int extractionPoint = scanOffset(handle);
+    *offset = extractionPoint;
+    *size = scanSize(handle);
+    for (unsigned int i = 0; i < scanSize(handle); i++) {
+        sink += pgm_read_byte(&(__pdr_data[extractionPoint++]));
+    }
+}
+
+/********************************************************************
+* readAfter()
+*
+* look up and read a record the way GetPDR does now.  The crc8 comes
+* from the index.
+*
+* returns:
+*    the crc8 of the record
+*/
+static unsigned char readAfter(unsigned int handle, unsigned int *offset, unsigned int *size) {
+    PDR_INDEX_TYPE *entry = indexEntry(handle);
+    unsigned int extractionPoint = pgm_read_word(&(entry->offset));
+    unsigned int count = pgm_read_word(&(entry->size));
+    *offset = extractionPoint;
+    *size = count;
+    while (count--) sink += pgm_read_byte(&(__pdr_data[extractionPoint++]));
+    return pgm_read_byte(&(entry->crc8));
+}
+
+/********************************************************************
+* recordCrc8()
+*
+* returns:
+*    the crc8 of the record data
+*/
+static unsigned char recordCrc8(unsigned int offset, unsigned int size) {
+    unsigned char crc8 = 0;
+    while (size--) crc8 = calc_new_crc8(crc8, pgm_read_byte(&(__pdr_data[offset++])));
+    return crc8;
+}
+
+int main(void)
+{
+    // set the uart for 9600 baud, 8 bits, no parity, one stop bit
+    UBRR0 = (F_CPU/16)/9600-1;
+    UCSR0B = (1<<TXEN0);
+    UCSR0C = (1<<UCSZ01) | (1<<UCSZ00);
+
+    // timer 1 counts cpu clocks
+    TCCR1A = 0x00;
+    TCCR1B = 0x01;
+    TIMSK1 = (1<<TOIE1);
+    __builtin_avr_sei();
+
+    unsigned char failures = 0;
+    unsigned long totalBefore = 0, totalAfter = 0;
+    for (unsigned int handle = 1; handle <= PDR_NUMBER_OF_RECORDS; handle++) {
+        unsigned int offsetBefore, sizeBefore, offsetAfter, sizeAfter;
+
+        unsigned long start = readClock();
+        readBefore(handle, &offsetBefore, &sizeBefore);
+        unsigned long before = readClock() - start;
+
+        start = readClock();
+        unsigned char crc8 = readAfter(handle, &offsetAfter, &sizeAfter);
+        unsigned long after = readClock() - start;
+
+        unsigned char pass = (offsetBefore == offsetAfter) && (sizeBefore == sizeAfter) &&
+            (crc8 == recordCrc8(offsetAfter, sizeAfter));
+        if (!pass) failures++;
+        totalBefore += before;
+        totalAfter += after;
+
+        putLabel("record ", handle);
+        putLabel(": size ", sizeAfter);
+        putLabel(" cycles before ", before);
+        putLabel(" after ", after);
+        putString(pass ? " PASS\r\n" : " FAIL\r\n");
+    }
+    putLabel("all records: cycles before ", totalBefore);
+    putLabel(" after ", totalAfter);
+    putString("\r\n");
+    putString(failures ? "pdr benchmark: FAIL\r\n" : "pdr benchmark: PASS\r\n");
+
+    while (1);
+    return 0;
+}
@@ -0,0 +1,335 @@
+//*******************************************************************
+//    request_benchmark.c
+//
+//    This creates a host side request rate benchmark for the userver
+//    firmware.  GetTID requests are sent to the board with one, two and
+//    four requests in flight, and the rate at which responses come back
+//    is reported along with the number of requests that got no answer.
+//    The highest rate with no lost requests is the sustainable request
+//    rate of the link.  The board is moved through the baud rates given
+//    on the command line with SetBaudRate.  This builds for linux (see
+//    the Makefile, which runs it against both framing modes).
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include "fcs.h"
+#include "mctp.h"
+#include "pldm.h"
+
+// the endpoint id used by the benchmark.  The board answers requests
+// sent to the null endpoint id before it has been assigned one.
+#define HOST_EID 0x10
+
+// the rate the board starts at (see uart.c)
+#define START_BAUD 38400
+
+// the largest body expected in a response
+#define MAX_BODY 64
+
+// requests sent at each depth
+#define DEFAULT_COUNT 500
+
+// the time allowed for the board to start after the port is opened
+// (opening the port resets the board into its bootloader)
+#define STARTUP_MS 2500
+
+// the time to wait for an answer before a request is counted as lost
+#define TIMEOUT_MS 200
+
+static int port;
+static unsigned char tag;
+
+//*******************************************************************
+// now()
+//
+// returns:
+//    the time in microseconds from an arbitrary start
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+//*******************************************************************
+// setBaud()
+//
+// set the serial port for raw 8 bit data at the given baud rate.
+// termios2 is used so that rates without a Bxxx constant (250000)
+// can be set.
+//
+// parameters:
+//    baud - the baud rate
+// returns:
+//    true if the rate was set
+static int setBaud(unsigned int baud) {
+    struct termios2 tio;
+    if (ioctl(port, TCGETS2, &tio) < 0) return 0;
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    return ioctl(port, TCSETS2, &tio) == 0;
+}
+
+//*******************************************************************
+// sendRequest()
+//
+// send a pldm request to the board in a single serial frame.
+//
+// parameters:
+//    instance - the pldm instance id (0-31)
+//    type - the pldm type
+//    command - the pldm command code
+//    data - the request data following the pldm header
+//    size - the number of request data bytes
+// returns:
+//    the number of bytes sent on the wire
+static unsigned int sendRequest(unsigned char instance, unsigned char type, unsigned char command, const unsigned char *data, unsigned int size) {
+    unsigned char body[MAX_BODY];
+    unsigned char frame[2*MAX_BODY + 16];
+    body[0] = 0x80 | instance;
+    body[1] = type;
+    body[2] = command;
+    memcpy(body + 3, data, size);
+    size += 3;
+
+    tag = (tag + 1) & MCTP_TAG_MASK;
+    unsigned char header[] = { SYNC_CHAR, MCTP_SERIAL_REV, size + 5, 0x01, MCTP_NULL_EID, HOST_EID,
+        MCTP_SOM | MCTP_EOM | MCTP_TO | tag, MCTP_TYPE_PLDM };
+    unsigned int fcs = fcs_calcFcs(INITFCS, header, sizeof(header));
+    fcs = fcs_calcFcs(fcs, body, size);
+
+    unsigned int length = sizeof(header);
+    memcpy(frame, header, length);
+    for (unsigned int i = 0; i < size; i++) {
+        if ((body[i] == SYNC_CHAR) || (body[i] == ESCAPE_CHAR)) {
+            frame[length++] = ESCAPE_CHAR;
+            frame[length++] = body[i] - 0x20;
+        } else {
+            frame[length++] = body[i];
+        }
+    }
+    frame[length++] = (fcs >> 8) & 0xff;
+    frame[length++] = fcs & 0xff;
+    frame[length++] = SYNC_CHAR;
+    if (write(port, frame, length) != (int)length) return 0;
+    return length;
+}
+
+//*******************************************************************
+// receiveResponse()
+//
+// wait for a pldm response from the board and check its fcs.  Anything
+// that is not a good single packet pldm response is skipped.
+//
+// parameters:
+//    body - where to place the pldm message (header and data)
+//    deadline - the time (see now()) to give up at
+// returns:
+//    the number of message bytes, or -1 on timeout
+static int receiveResponse(unsigned char *body, double deadline) {
+    unsigned char header[8];
+    unsigned int length = 0;
+    unsigned int size = 0;
+    unsigned int fcs = 0;
+    unsigned char escaped = 0;
+
+    while (1) {
+        double left = deadline - now();
+        if (left <= 0) return -1;
+        struct pollfd pfd = { port, POLLIN, 0 };
+        if (poll(&pfd, 1, (int)(left/1000) + 1) <= 0) continue;
+        unsigned char ch;
+        if (read(port, &ch, 1) != 1) continue;
+
+        // the header is never escaped, and its byte count gives the
+        // length of the body.  The frame check sequence is not escaped
+        // either, so it may hold a sync character.
+        if (length < sizeof(header)) {
+            if ((length == 0) && (ch != SYNC_CHAR)) continue;
+            if (((length == 1) && (ch != MCTP_SERIAL_REV)) || ((length == 2) && ((ch < 5) || (ch - 5 > MAX_BODY)))) {
+                length = (ch == SYNC_CHAR) ? 1 : 0;
+                continue;
+            }
+            header[length++] = ch;
+            size = 0;
+            continue;
+        }
+        if (size < (unsigned int)header[2] - 5) {
+            if (ch == ESCAPE_CHAR) {
+                escaped = 1;
+                continue;
+            }
+            body[size++] = escaped ? ch + 0x20 : ch;
+            escaped = 0;
+            continue;
+        }
+        if (length == sizeof(header)) {
+            fcs = ch << 8;
+            length++;
+            continue;
+        }
+        if (length == sizeof(header) + 1) {
+            fcs |= ch;
+            length++;
+            continue;
+        }
+
+        // the closing sync character - check the frame and the message
+        length = 0;
+        unsigned int calculated = fcs_calcFcs(INITFCS, header, sizeof(header));
+        calculated = fcs_calcFcs(calculated, body, size);
+        if ((ch == SYNC_CHAR) && (fcs == calculated) &&
+            ((header[6] & (MCTP_SOM | MCTP_EOM | MCTP_TO)) == (MCTP_SOM | MCTP_EOM)) &&
+            (header[7] == MCTP_TYPE_PLDM) && (size >= 4) && (!(body[0] & 0x80))) return size;
+    }
+}
+
+//*******************************************************************
+// changeBaud()
+//
+// move the board and the port to a new baud rate.  The board keeps
+// the new rate once it receives a request at that rate.
+//
+// parameters:
+//    baud - the new baud rate
+// returns:
+//    true if the board accepted the new rate
+static int changeBaud(unsigned int baud) {
+    unsigned char request[4] = { baud & 0xff, (baud >> 8) & 0xff, (baud >> 16) & 0xff, baud >> 24 };
+    unsigned char response[MAX_BODY];
+    sendRequest(0, PLDM_TYPE_OEM, CMD_OEM_SET_BAUD_RATE, request, sizeof(request));
+    if ((receiveResponse(response, now() + TIMEOUT_MS*1000) < 4) || (response[3] != RESPONSE_SUCCESS)) return 0;
+
+    // the board switches once the response has gone out
+    usleep(20000);
+    if (!setBaud(baud)) return 0;
+    ioctl(port, TCFLSH, TCIOFLUSH);
+    return 1;
+}
+
+//*******************************************************************
+// runDepth()
+//
+// send GetTID requests keeping the given number in flight and report
+// the rate at which they were answered.
+//
+// parameters:
+//    baud - the baud rate (for the report)
+//    depth - the number of requests kept in flight (at most 32)
+//    count - the number of requests to send
+// returns:
+//    the number of requests that were not answered
+static unsigned int runDepth(unsigned int baud, unsigned int depth, unsigned int count) {
+    unsigned char outstanding[32] = { 0 };
+    unsigned char response[MAX_BODY];
+    unsigned int inFlight = 0, sent = 0, answered = 0, lost = 0;
+    unsigned int wireBytes = 0, timeouts = 0;
+    unsigned char instance = 0;
+    double start = now();
+
+    while ((sent < count) || (inFlight)) {
+        // keep the pipe full
+        while ((sent < count) && (inFlight < depth)) {
+            instance = (instance + 1) & 0x1f;
+            wireBytes = sendRequest(instance, PLDM_TYPE_BASE, CMD_GET_TID, 0, 0);
+            outstanding[instance] = 1;
+            inFlight++;
+            sent++;
+        }
+
+        // match the response to its request by instance id.  When no
+        // answer comes, everything in flight is counted as lost.
+        int size = receiveResponse(response, now() + TIMEOUT_MS*1000);
+        if (size < 0) {
+            lost += inFlight;
+            timeouts++;
+            inFlight = 0;
+            memset(outstanding, 0, sizeof(outstanding));
+            ioctl(port, TCFLSH, TCIFLUSH);
+            continue;
+        }
+        unsigned char id = response[0] & 0x1f;
+        if ((response[2] != CMD_GET_TID) || (!outstanding[id])) continue;
+        outstanding[id] = 0;
+        inFlight--;
+        answered++;
+    }
+
+    // the time spent waiting for lost answers is not counted
+    double elapsed = (now() - start) - timeouts*TIMEOUT_MS*1000.0;
+
+    // the request rate the link can carry, from the request frame
+    // length alone (the response frames are longer)
+    printf("%7u baud depth %u: %4u/%u answered, %4u lost, %7.0f requests/s (request wire limit %7.0f/s)\n",
+        baud, depth, answered, count, lost, answered/(elapsed/1e6), baud/(10.0*wireBytes));
+    return lost;
+}
+
+int main(int argc, char *argv[])
+{
+    static const unsigned int depths[] = { 1, 2, 4 };
+    if (argc < 3) {
+        printf("usage: %s <serial device> [-n requests per depth] <baud rate>...\n", argv[0]);
+        return 1;
+    }
+    unsigned int count = DEFAULT_COUNT;
+    port = open(argv[1], O_RDWR | O_NOCTTY);
+    if ((port < 0) || (!setBaud(START_BAUD))) {
+        printf("unable to open %s\n", argv[1]);
+        return 1;
+    }
+
+    // wait for the board to start and throw away its greeting
+    usleep(STARTUP_MS*1000);
+    ioctl(port, TCFLSH, TCIFLUSH);
+
+    unsigned int failures = 0;
+    unsigned int current = START_BAUD;
+    for (int a = 2; a < argc; a++) {
+        if ((!strcmp(argv[a], "-n")) && (a + 1 < argc)) {
+            count = atoi(argv[++a]);
+            continue;
+        }
+        unsigned int baud = atoi(argv[a]);
+        if ((baud != current) && (!changeBaud(baud))) {
+            printf("%7u baud: the board did not accept the rate\n", baud);
+            failures++;
+            continue;
+        }
+        current = baud;
+
+        // the sustainable rate is that of the deepest pipe with no loss
+        for (unsigned int d = 0; d < sizeof(depths)/sizeof(depths[0]); d++) {
+            runDepth(baud, depths[d], count);
+        }
+    }
+    close(port);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,339 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a response transmit benchmark for the atmega328p.  It
+//    is meant to be run under simulavr (see the Makefile).  GetPDR
+//    responses for every record of the stepper repository, and a
+//    GetSensorReading response, are built from segments the way node.c
+//    builds them and sent with mctp_transmitFrame().  Timer 1 counts
+//    the cpu clocks taken to queue each response and the clocks the
+//    transmit source (mctp_txNextByte(), run by the uart transmit
+//    interrupt) takes to turn it into bytes on the wire.
+//
+//    The uart is replaced here by a stub that hands the transmit source
+//    to the benchmark, so the serializing time excludes the interrupt
+//    entry and exit and the write to the data register, and includes
+//    the store of each byte into the capture buffer.  Every response
+//    is decoded from the capture buffer and its frame check sequences
+//    and body are checked.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__
+#define __AVR_ATmega328P__
+#endif
+
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "pldm.h"
+#include "mctp.h"
+#include "fcs.h"
+#include "uart.h"
+
+#ifndef F_CPU
+    #define F_CPU 16000000
+#endif
+
+// room for the largest response on the wire, with every byte escaped
+#define WIRE_SIZE (2*PDR_MAX_RECORD_SIZE + 64)
+
+// timer 1 bits 16-31, counted by the overflow interrupt
+static volatile unsigned int clock_high;
+
+// the transmit source registered by mctp_init()
+static unsigned char (*txSource)(unsigned char *ch);
+
+// the bytes of the last response as they went out on the wire
+static unsigned char wire[WIRE_SIZE];
+static unsigned int wireLength;
+
+// the message body that the last response should carry
+static unsigned char expected[PDR_MAX_RECORD_SIZE + 32];
+static unsigned int expectedLength;
+
+/********************************************************************
+* uart stub
+*
+* mctp.c is linked against these in place of uart.c.  Only the
+* transmit source is used by the benchmark.
+*/
+void uart_setTxSource(unsigned char (*source)(unsigned char *ch)) {
+    txSource = source;
+}
+void uart_setRxSink(void (*sink)(unsigned char ch)) {
+}
+void uart_startTx() {
+}
+unsigned char uart_readCh(char *ch) {
+    return 0;
+}
+void uart_getStatistics(uart_statistics *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+void uart_clearStatistics() {
+}
+unsigned char uart_close() {
+    return 1;
+}
+
+/********************************************************************
+* TIMER1_OVF_vect
+*
+* interrupt handler for timer 1 overflow.  Timer 1 runs from the cpu
+* clock and is extended to 32 bits here.
+*/
+ISR(TIMER1_OVF_vect) {
+    clock_high++;
+}
+
+/********************************************************************
+* readClock()
+*
+* returns:
+*    the number of cpu clocks since timer 1 was started
+*/
+static unsigned long readClock() {
+    __builtin_avr_cli();
+    unsigned int low = TCNT1;
+    unsigned long high = clock_high;
+    if ((TIFR1 & (1<<TOV1)) && (low < 0x8000)) high++;
+    __builtin_avr_sei();
+    return (high << 16) | low;
+}
+
+/********************************************************************
+* print helpers
+*
+* blocking writes to the uart.  Simulavr echoes the uart output to
+* stdout.
+*/
+static void putChar(char ch) {
+    while (!(UCSR0A & (1<<UDRE0)));
+    UDR0 = ch;
+}
+
+static void putString(const char *str) {
+    while (*str) putChar(*str++);
+}
+
+static void putLong(long value) {
+    char digits[11];
+    unsigned char n = 0;
+    unsigned long magnitude = value;
+    if (value < 0) {
+        putChar('-');
+        magnitude = -value;
+    }
+    do {
+        digits[n++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    while (n) putChar(digits[--n]);
+}
+
+static void putLabel(const char *label, long value) {
+    putString(label);
+    putLong(value);
+}
+
+/********************************************************************
+* expect()
+*
+* add bytes to the body the response should carry.
+*/
+static void expect(const void *data, unsigned int size) {
+    memcpy(expected + expectedLength, data, size);
+    expectedLength += size;
+}
+
+static void expectLe(unsigned long value, unsigned char size) {
+    while (size--) {
+        expected[expectedLength++] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+/********************************************************************
+* decodeWire()
+*
+* split the captured bytes into frames, check the frame check sequence
+* and the packet flags of each and compare the reassembled body with
+* the expected one.
+*
+* returns:
+*    non-zero if the response is good
+*/
+static unsigned char decodeWire() {
+    static unsigned char body[PDR_MAX_RECORD_SIZE + 32];
+    unsigned int bodyLength = 0;
+    unsigned int i = 0;
+    unsigned char packets = 0;
+    unsigned char last = 0;
+
+    while ((i < wireLength) && (!last)) {
+        // the serial and transport headers are never escaped
+        unsigned char frame[MCTP_TX_UNIT + 16];
+        unsigned char n = 0;
+        if (wire[i] != SYNC_CHAR) return 0;
+        while ((i < wireLength) && (n < 8)) frame[n++] = wire[i++];
+        unsigned char flags = frame[6];
+        unsigned char headerLength = (flags & MCTP_SOM) ? 8 : 7;
+        if (n < headerLength) return 0;
+        i -= n - headerLength;
+        n = headerLength;
+        if (((flags & MCTP_SOM) != 0) != (packets == 0)) return 0;
+        if (((flags >> MCTP_SEQ_SHIFT) & 0x03) != (packets & 0x03)) return 0;
+        last = flags & MCTP_EOM;
+
+        // the body runs to the frame check sequence
+        unsigned char count = frame[2] - (headerLength - 3);
+        while (count--) {
+            if (i >= wireLength) return 0;
+            unsigned char byte = wire[i++];
+            if (byte == ESCAPE_CHAR) byte = wire[i++] + 0x20;
+            frame[n++] = byte;
+            body[bodyLength++] = byte;
+        }
+        if (i + 3 > wireLength) return 0;
+        unsigned int fcs = fcs_calcFcs(INITFCS, frame, n);
+        if (fcs != (((unsigned int)wire[i] << 8) | wire[i+1])) return 0;
+        if (wire[i+2] != SYNC_CHAR) return 0;
+        i += 3;
+        packets++;
+    }
+    return last && (i == wireLength) && (bodyLength == expectedLength) &&
+        (memcmp(body, expected, bodyLength) == 0);
+}
+
+/********************************************************************
+* runResponse()
+*
+* send a response, capture it from the transmit source and report the
+* time taken.
+*
+* parameters:
+*    label - the name of the response
+*    segments - the segments making up the message body
+*    count - the number of segments
+* returns:
+*    non-zero if the response was sent and decoded correctly
+*/
+static unsigned char runResponse(const char *label, const mctp_segment *segments, unsigned char count) {
+    unsigned char ch;
+    wireLength = 0;
+
+    unsigned long start = readClock();
+    unsigned char queued = mctp_transmitFrame(MCTP_TYPE_PLDM, segments, count);
+    unsigned long queue = readClock() - start;
+
+    start = readClock();
+    while ((wireLength < WIRE_SIZE) && (txSource(&ch))) wire[wireLength++] = ch;
+    unsigned long serialize = readClock() - start;
+
+    unsigned char pass = queued && decodeWire();
+    putString(label);
+    putLabel(": body ", expectedLength);
+    putLabel(" bytes, wire ", wireLength);
+    putLabel(" bytes, cycles queue ", queue);
+    putLabel(" serialize ", serialize);
+    putLabel(" total ", queue + serialize);
+    putLabel(" (", (queue + serialize) / wireLength);
+    putString("/byte)");
+    putString(pass ? " PASS\r\n" : " FAIL\r\n");
+    return pass;
+}
+
+/********************************************************************
+* runGetPdr()
+*
+* send a single part GetPDR response for a record, with the same
+* segments as transmitGetPdrResponse() in node.c.
+*/
+static unsigned char runGetPdr(unsigned int handle) {
+    unsigned char hdr[] = { 0x00, PLDM_TYPE_PLATFORM, CMD_GET_PDR, RESPONSE_SUCCESS };
+    PDR_INDEX_TYPE *entry = &__pdr_index[handle - 1];
+    unsigned int offset = pgm_read_word(&(entry->offset));
+    unsigned int size = pgm_read_word(&(entry->size));
+    unsigned long nextRecord = (handle < PDR_NUMBER_OF_RECORDS) ? handle + 1 : 0;
+    mctp_segment segments[] = {
+        MCTP_SEGMENT_RAM(hdr, sizeof(hdr)),
+        MCTP_SEGMENT_LE(nextRecord, 4),
+        MCTP_SEGMENT_LE(0, 4),
+        MCTP_SEGMENT_LE(0x05, 1),
+        MCTP_SEGMENT_LE(size, 2),
+        MCTP_SEGMENT_PROGMEM(&__pdr_data[offset], size)
+    };
+
+    expectedLength = 0;
+    expect(hdr, sizeof(hdr));
+    expectLe(nextRecord, 4);
+    expectLe(0, 4);
+    expectLe(0x05, 1);
+    expectLe(size, 2);
+    for (unsigned int i = 0; i < size; i++) expected[expectedLength++] = pgm_read_byte(&__pdr_data[offset + i]);
+
+    putLabel("GetPDR record ", handle);
+    return runResponse("", segments, 6);
+}
+
+/********************************************************************
+* runGetSensorReading()
+*
+* send a GetSensorReading response for a 32 bit numeric sensor, with
+* the same segments as transmitResponse() in node.c.
+*/
+static unsigned char runGetSensorReading() {
+    unsigned char hdr[] = { 0x00, PLDM_TYPE_PLATFORM, CMD_GET_SENSOR_READING, RESPONSE_SUCCESS };
+    unsigned char body[] = { 5, 0, 0, 1, 1, 1, 0x7d, 0x7e, 0x12, 0x00 };
+    mctp_segment segments[] = {
+        MCTP_SEGMENT_RAM(hdr, sizeof(hdr)),
+        MCTP_SEGMENT_RAM(body, sizeof(body))
+    };
+
+    expectedLength = 0;
+    expect(hdr, sizeof(hdr));
+    expect(body, sizeof(body));
+    return runResponse("GetSensorReading", segments, 2);
+}
+
+int main(void)
+{
+    // set the uart for 9600 baud, 8 bits, no parity, one stop bit
+    UBRR0 = (F_CPU/16)/9600-1;
+    UCSR0B = (1<<TXEN0);
+    UCSR0C = (1<<UCSZ01) | (1<<UCSZ00);
+
+    // timer 1 counts cpu clocks
+    TCCR1A = 0x00;
+    TCCR1B = 0x01;
+    TIMSK1 = (1<<TOIE1);
+    __builtin_avr_sei();
+
+    mctp_init();
+
+    unsigned char failures = 0;
+    for (unsigned int handle = 1; handle <= PDR_NUMBER_OF_RECORDS; handle++) {
+        if (!runGetPdr(handle)) failures++;
+    }
+    if (!runGetSensorReading()) failures++;
+    putString(failures ? "response benchmark: FAIL\r\n" : "response benchmark: PASS\r\n");
+
+    while (1);
+    return 0;
+}
@@ -0,0 +1,9 @@
+//    avr/io.h
+//
+//    This header stands in for the avr-libc register definitions when
+//    the state sensor and effecter sources are compiled for the host.
+//    Only the status register is used, to hold off interrupts around 
+//    shared state.
+//
+#pragma once
+extern unsigned char SREG;
@@ -0,0 +1,8 @@
+//    avr/pgmspace.h
+//
+//    This header stands in for the avr-libc program memory definitions
+//    when the configuration header is compiled for the host.  Program
+//    memory data is just ordinary data on the host.
+//
+#pragma once
+#define PROGMEM
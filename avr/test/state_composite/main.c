@@ -0,0 +1,293 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a round trip benchmark for composite state sensors
+//    and effecters (userver/StateSensor.c and StateEffecter.c).  A
+//    manager polls the stepper status (interlock, trigger, motion state
+//    and both limits) and sets and reads back three state effecters,
+//    once with one request per state and once with one composite
+//    request.  Two identical sets of instances are driven with the same
+//    inputs so that the responses of the two can be compared.  The
+//    number of round trips and the bytes on the serial link are
+//    reported for each.  The test is built and run on the host (see
+//    the Makefile).
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "StateSensor.h"
+#include "StateEffecter.h"
+
+// the status register used by the critical sections
+unsigned char SREG;
+
+// the number of status polls run
+#define POLLS 1000
+
+// serial framing around each PLDM message: sync, revision, byte count,
+// the four byte transport header and message type, then the FCS and
+// the closing sync
+#define FRAMING_BYTES 11
+
+// the sensors that make up the stepper status, in the order of the
+// status pdr (see getStateSensors() in entityStepper1.c)
+#define STATUS_COUNT 5
+static const unsigned int statusSensorIds[STATUS_COUNT] = {
+    ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID,
+    ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID,
+    ENTITY_STEPPER1_MOTIONSTATE_SENSORID,
+    ENTITY_STEPPER1_POSITIVELIMIT_SENSORID,
+    ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID
+};
+
+// the effecters set and read back each poll, with the states each one
+// allows.  The stepper has no composite effecter, so the composite
+// requests are made as if these were the states of one.
+#define EFFECTER_COUNT 3
+#define COMPOSITE_EFFECTERID 100
+static const unsigned int effecterIds[EFFECTER_COUNT] = {
+    ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID,
+    ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID,
+    ENTITY_STEPPER1_COMMAND_EFFECTERID
+};
+static const unsigned char effecterStates[EFFECTER_COUNT] = { 2, 2, 6 };
+
+// one copy of the stepper state sensors and effecters
+typedef struct {
+    StateSensorInstance sensors[STATUS_COUNT];
+    StateEffecterInstance effecters[EFFECTER_COUNT];
+    unsigned int roundTrips;
+    unsigned int wireBytes;
+} Stepper;
+
+static Stepper single;
+static Stepper composite;
+
+//*******************************************************************
+// initStepper()
+//
+// initialize and enable the sensors and effecters.  Events are enabled
+// on the sensors so that they trigger and have to be rearmed.
+static void initStepper(Stepper *s) {
+    for (unsigned char i = 0; i < STATUS_COUNT; i++) {
+        statesensor_init(&s->sensors[i]);
+        s->sensors[i].stateWhenHigh = 2;
+        s->sensors[i].stateWhenLow = 1;
+        statesensor_setOperationalState(&s->sensors[i], 0, 4);
+    }
+    for (unsigned char i = 0; i < EFFECTER_COUNT; i++) {
+        stateeffecter_init(&s->effecters[i]);
+        s->effecters[i].stateWhenHigh = 2;
+        s->effecters[i].stateWhenLow = 1;
+        s->effecters[i].defaultState = 1;
+        s->effecters[i].allowedStatesMask = (1<<effecterStates[i]) - 1;
+        stateeffecter_setOperationalState(&s->effecters[i], 0);
+    }
+    s->roundTrips = 0;
+    s->wireBytes = 0;
+}
+
+//*******************************************************************
+// frameSize()
+//
+// returns:
+//    the number of bytes a PLDM message takes on the serial link - every
+//    sync or escape character in the body is sent as two bytes
+static unsigned int frameSize(const unsigned char *message, unsigned int size) {
+    unsigned int bytes = FRAMING_BYTES + size;
+    for (unsigned int i = 0; i < size; i++) {
+        if ((message[i] == 0x7E) || (message[i] == 0x7D)) bytes++;
+    }
+    return bytes;
+}
+
+//*******************************************************************
+// exchange()
+//
+// account for one request and its response on the link.  The request
+// header and body are given separately; the response is the completion
+// code followed by the response body.
+static void exchange(Stepper *s, unsigned char command, const unsigned char *request, unsigned int requestSize,
+        unsigned char completionCode, const unsigned char *response, unsigned int responseSize) {
+    unsigned char message[64];
+    message[0] = 0x80;
+    message[1] = PLDM_TYPE_PLATFORM;
+    message[2] = command;
+    memcpy(message + 3, request, requestSize);
+    s->wireBytes += frameSize(message, 3 + requestSize);
+
+    message[0] = 0x00;
+    message[3] = completionCode;
+    memcpy(message + 4, response, responseSize);
+    s->wireBytes += frameSize(message, 4 + responseSize);
+    s->roundTrips++;
+}
+
+//*******************************************************************
+// getStateSensorReadings()
+//
+// read a (possibly composite) state sensor and rearm every state of it.
+//
+// returns:
+//    the size of the response body, which is written to body
+static unsigned char getStateSensorReadings(Stepper *s, unsigned int sensorId, StateSensorInstance **sensors,
+        unsigned char count, unsigned char *body) {
+    unsigned char rearm = (1<<count) - 1;
+    unsigned char request[] = { sensorId & 0xff, sensorId >> 8, rearm, 0 };
+    unsigned char size;
+    unsigned char cc = statesensor_getCompositeReadings(sensors, count, rearm, body, &size);
+    exchange(s, CMD_GET_STATE_SENSOR_READINGS, request, sizeof(request), cc, body, size);
+    return (cc == RESPONSE_SUCCESS) ? size : 0;
+}
+
+//*******************************************************************
+// setStateEffecterStates()
+//
+// set the states of a (possibly composite) state effecter.  fields
+// holds a {setRequest, effecterState} pair for each state.
+//
+// returns:
+//    the completion code
+static unsigned char setStateEffecterStates(Stepper *s, unsigned int effecterId, StateEffecterInstance **effecters,
+        unsigned char count, const unsigned char *fields) {
+    unsigned char request[3 + 2*EFFECTER_COUNT] = { effecterId & 0xff, effecterId >> 8, count };
+    memcpy(request + 3, fields, 2*count);
+    unsigned char cc = stateeffecter_setCompositeStates(effecters, count, request + 2);
+    exchange(s, CMD_SET_STATE_EFFECTER_STATES, request, 3 + 2*count, cc, 0, 0);
+    return cc;
+}
+
+//*******************************************************************
+// getStateEffecterStates()
+//
+// read a (possibly composite) state effecter.
+//
+// returns:
+//    the size of the response body, which is written to body
+static unsigned char getStateEffecterStates(Stepper *s, unsigned int effecterId, StateEffecterInstance **effecters,
+        unsigned char count, unsigned char *body) {
+    unsigned char request[] = { effecterId & 0xff, effecterId >> 8 };
+    unsigned char size;
+    unsigned char cc = stateeffecter_getCompositeStates(effecters, count, body, &size);
+    exchange(s, CMD_GET_STATE_EFFECTER_STATES, request, sizeof(request), cc, body, size);
+    return size;
+}
+
+//*******************************************************************
+// updateInputs()
+//
+// set the same random inputs on both copies and run the sensor state
+// machines, as the control isr would.
+static void updateInputs() {
+    unsigned char bits = rand();
+    unsigned char motion = 1 + rand() % 5;
+    for (unsigned char i = 0; i < STATUS_COUNT; i++) {
+        if (i == 2) {
+            statesensor_setValue(&single.sensors[i], motion);
+            statesensor_setValue(&composite.sensors[i], motion);
+        } else {
+            statesensor_setValueFromChannelBit(&single.sensors[i], (bits >> i) & 1);
+            statesensor_setValueFromChannelBit(&composite.sensors[i], (bits >> i) & 1);
+        }
+        statesensor_updateSensorState(&single.sensors[i]);
+        statesensor_updateSensorState(&composite.sensors[i]);
+    }
+}
+
+static void report(const char *label, Stepper *s) {
+    double bytes = (double)s->wireBytes / POLLS;
+    printf("  %-9s: %5.2f round trips, %6.1f bytes, wire time %5.2f ms at 38400, %5.2f ms at 115200 per poll\n",
+        label, (double)s->roundTrips / POLLS, bytes, bytes*10000/38400, bytes*10000/115200);
+}
+
+int main()
+{
+    StateSensorInstance *sensors[STATUS_COUNT];
+    StateEffecterInstance *effecters[EFFECTER_COUNT];
+    unsigned char singleBody[4*STATUS_COUNT];
+    unsigned char body[1 + 4*STATUS_COUNT];
+    int failures = 0;
+
+    // status polls
+    srand(1);
+    initStepper(&single);
+    initStepper(&composite);
+    for (unsigned char i = 0; i < STATUS_COUNT; i++) sensors[i] = &composite.sensors[i];
+    for (unsigned int poll = 0; poll < POLLS; poll++) {
+        updateInputs();
+        for (unsigned char i = 0; i < STATUS_COUNT; i++) {
+            StateSensorInstance *sensor = &single.sensors[i];
+            if (getStateSensorReadings(&single, statusSensorIds[i], &sensor, 1, body) != 5) failures++;
+            memcpy(singleBody + 4*i, body + 1, 4);
+        }
+        if ((getStateSensorReadings(&composite, ENTITY_STEPPER1_STATUS_SENSORID, sensors, STATUS_COUNT, body) != 1 + 4*STATUS_COUNT) ||
+            (body[0] != STATUS_COUNT) || (memcmp(body + 1, singleBody, sizeof(singleBody)))) {
+            printf("FAIL status poll %u: composite reading does not match the single readings\n", poll);
+            failures++;
+        }
+    }
+    printf("stepper status (%d state sensors), %d polls:\n", STATUS_COUNT, POLLS);
+    report("single", &single);
+    report("composite", &composite);
+
+    // effecter sets and read backs.  Each poll sets a random subset of
+    // the effecters; the single requests are only made for those.
+    initStepper(&single);
+    initStepper(&composite);
+    for (unsigned char i = 0; i < EFFECTER_COUNT; i++) effecters[i] = &composite.effecters[i];
+    for (unsigned int poll = 0; poll < POLLS; poll++) {
+        unsigned char fields[2*EFFECTER_COUNT];
+        for (unsigned char i = 0; i < EFFECTER_COUNT; i++) {
+            fields[2*i] = rand() & 1;
+            fields[2*i+1] = 1 + rand() % effecterStates[i];
+            if (fields[2*i]) {
+                StateEffecterInstance *effecter = &single.effecters[i];
+                if (setStateEffecterStates(&single, effecterIds[i], &effecter, 1, fields + 2*i) != RESPONSE_SUCCESS) failures++;
+            }
+        }
+        if (setStateEffecterStates(&composite, COMPOSITE_EFFECTERID, effecters, EFFECTER_COUNT, fields) != RESPONSE_SUCCESS) failures++;
+
+        for (unsigned char i = 0; i < EFFECTER_COUNT; i++) {
+            StateEffecterInstance *effecter = &single.effecters[i];
+            if (getStateEffecterStates(&single, effecterIds[i], &effecter, 1, body) != 4) failures++;
+            memcpy(singleBody + 3*i, body + 1, 3);
+        }
+        if ((getStateEffecterStates(&composite, COMPOSITE_EFFECTERID, effecters, EFFECTER_COUNT, body) != 1 + 3*EFFECTER_COUNT) ||
+            (body[0] != EFFECTER_COUNT) || (memcmp(body + 1, singleBody, 3*EFFECTER_COUNT))) {
+            printf("FAIL effecter poll %u: composite states do not match the single states\n", poll);
+            failures++;
+        }
+    }
+    printf("set and read back %d state effecters, %d polls:\n", EFFECTER_COUNT, POLLS);
+    report("single", &single);
+    report("composite", &composite);
+
+    // a composite set with one state that is not allowed must leave all
+    // of the effecters unchanged
+    unsigned char bad[2*EFFECTER_COUNT] = { 1, 1, 1, 1, 1, effecterStates[2] + 1 };
+    getStateEffecterStates(&composite, COMPOSITE_EFFECTERID, effecters, EFFECTER_COUNT, singleBody);
+    if ((setStateEffecterStates(&composite, COMPOSITE_EFFECTERID, effecters, EFFECTER_COUNT, bad) != RESPONSE_UNSUPPORTED_EFFECTERSTATE) ||
+        (getStateEffecterStates(&composite, COMPOSITE_EFFECTERID, effecters, EFFECTER_COUNT, body) != 1 + 3*EFFECTER_COUNT) ||
+        (memcmp(body, singleBody, 1 + 3*EFFECTER_COUNT))) {
+        printf("FAIL a rejected composite set changed the effecters\n");
+        failures++;
+    }
+
+    printf(failures ? "state composite: FAIL\n" : "state composite: PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a step/dir pulse timing test for the atmega328p.  It
+//    is meant to be run under simulavr (see the Makefile).  A series of
+//    constant step rates is requested from the step/dir output, one call
+//    per 4kHz frame, and every pulse on the step pin is timestamped with
+//    a free-running clock.  For each rate the test reports the number of
+//    pulses seen against the number requested and the number reported
+//    by step_dir_out1_setOutput(), along with the mean, shortest and
+//    longest pulse intervals.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__
+#define __AVR_ATmega328P__
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "stepdir_out.h"
+
+#ifndef F_CPU
+    #define F_CPU 16000000
+#endif
+
+// the frame length in cpu clocks - timer 2 divides by 32 and counts
+// to OCR2A
+#define FRAME_CLOCKS (((F_CPU/32)/4000+1)*32)
+
+// frames run at each rate, the number of those frames to wait before
+// the pulse intervals are measured, and the number of frames run at a
+// rate of zero afterwards so that all owed pulses are output
+#define RUN_FRAMES    400
+#define SETTLE_FRAMES 40
+#define STOP_FRAMES   40
+
+// the largest allowed difference (in cpu clocks) between a pulse
+// interval and the ideal one.  This is mostly the interrupt latency of
+// the timestamp - the output itself is within a couple of clocks.
+#define JITTER_LIMIT 128
+
+// the rates to test (16.16 pulses per frame).  The highest rate keeps
+// the step pulse wide enough for the pin change interrupt to see it.
+static const long rates[] = {
+    0x00010000L,     //  1.0 pulses/frame (4kHz)
+    0x00028000L,     //  2.5 pulses/frame
+    0x00074CCDL,     //  7.3 pulses/frame
+    0x000DB333L,     // 13.7 pulses/frame
+    0x00140000L,     // 20.0 pulses/frame (80kHz)
+    -0x00053333L     // -5.2 pulses/frame
+};
+#define RATE_COUNT (sizeof(rates)/sizeof(rates[0]))
+
+// values shared with the interrupt handlers
+static volatile unsigned long clock_high;   // timestamp clock bits 8-31
+static volatile long rate;                  // the rate requested each frame
+static volatile unsigned int frames_left;   // frames left at this rate
+static volatile unsigned char measuring;    // non-zero while intervals are measured
+static volatile long position;              // pulses seen on the step pin
+static volatile long returned;              // pulses reported by the output
+static long requested_total;                // pulses requested (16.16)
+static volatile unsigned long last_edge;    // timestamp of the last pulse
+static volatile unsigned char have_edge;    // non-zero once last_edge is valid
+static volatile unsigned int intervals;     // number of intervals measured
+static volatile unsigned long interval_sum; // sum of the intervals measured
+static volatile unsigned int interval_min;  // shortest interval measured
+static volatile unsigned int interval_max;  // longest interval measured
+
+/********************************************************************
+* TIMER0_OVF_vect
+*
+* interrupt handler for timer 0 overflow.  Timer 0 runs from the cpu
+* clock and is extended to 32 bits here to timestamp the pulses.
+*/
+ISR(TIMER0_OVF_vect) {
+    clock_high += 256;
+}
+
+/********************************************************************
+* PCINT0_vect
+*
+* interrupt handler for the step pin (PB2).  Rising edges are counted
+* in the direction given by the direction pin (PB4) and the time since
+* the last rising edge is added to the interval statistics.
+*/
+ISR(PCINT0_vect) {
+    unsigned char low = TCNT0;
+    unsigned long now = clock_high;
+    if ((TIFR0 & (1<<TOV0)) && (low < 128)) now += 256;
+    now += low;
+
+    unsigned char pins = PINB;
+    if (!(pins & (1<<PINB2))) return;
+    if (pins & (1<<PINB4)) position--;
+    else position++;
+
+    if (measuring && have_edge) {
+        unsigned int interval = now - last_edge;
+        intervals++;
+        interval_sum += interval;
+        if (interval < interval_min) interval_min = interval;
+        if (interval > interval_max) interval_max = interval;
+    }
+    last_edge = now;
+    have_edge = measuring;
+}
+
+/********************************************************************
+* TIMER2_COMPA_vect
+*
+* interrupt handler for the 4kHz frame timer.  Other interrupts are
+* allowed while the step output is updated so that the pulse timestamps
+* are only held off by its short critical section.
+*/
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK) {
+    if (!frames_left) return;
+    if (frames_left == RUN_FRAMES + STOP_FRAMES - SETTLE_FRAMES) measuring = 1;
+    if (frames_left == STOP_FRAMES) {
+        rate = 0;
+        measuring = 0;
+    }
+    returned += step_dir_out1_setOutput(rate);
+    frames_left--;
+}
+
+/********************************************************************
+* print helpers
+*
+* blocking writes to the uart.  Simulavr echoes the uart output to
+* stdout.
+*/
+static void putChar(char ch) {
+    while (!(UCSR0A & (1<<UDRE0)));
+    UDR0 = ch;
+}
+
+static void putString(const char *str) {
+    while (*str) putChar(*str++);
+}
+
+static void putLong(long value) {
+    char digits[11];
+    unsigned char n = 0;
+    unsigned long magnitude = value;
+    if (value < 0) {
+        putChar('-');
+        magnitude = -value;
+    }
+    do {
+        digits[n++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    while (n) putChar(digits[--n]);
+}
+
+// print a 16.16 value with two decimal places
+static void putFixed(long value) {
+    if (value < 0) {
+        putChar('-');
+        value = -value;
+    }
+    putLong(value>>16);
+    putChar('.');
+    unsigned int hundredths = (((value & 0xFFFF)*100)+0x8000)>>16;
+    putChar('0' + hundredths/10);
+    putChar('0' + hundredths%10);
+}
+
+static void putLabel(const char *label, long value) {
+    putString(label);
+    putLong(value);
+}
+
+/********************************************************************
+* runRate()
+*
+* run the step output at one rate and report the result.
+*
+* parameters:
+*    requested - the rate in pulses per frame (16.16)
+* returns:
+*    non-zero if the pulse count and timing are within limits
+*/
+static unsigned char runRate(long requested) {
+    long start_position = position;
+    long start_returned = returned;
+
+    __builtin_avr_cli();
+    rate = requested;
+    measuring = 0;
+    have_edge = 0;
+    intervals = 0;
+    interval_sum = 0;
+    interval_min = 0xFFFF;
+    interval_max = 0;
+    frames_left = RUN_FRAMES + STOP_FRAMES;
+    __builtin_avr_sei();
+    while (frames_left);
+
+    // the pulses output and the pulses still owed (less than one) must
+    // add up to the pulses requested
+    long seen = position - start_position;
+    long reported = returned - start_returned;
+    requested_total += requested * RUN_FRAMES;
+    long owed = requested_total - (position<<16);
+    unsigned char pass = (seen == reported) && (owed < 65536L) && (owed > -65536L);
+
+    // the mean interval must match the rate and no interval may stray
+    // more than the jitter limit from it
+    unsigned long magnitude = (requested < 0) ? -requested : requested;
+    unsigned long ideal16 = (((unsigned long)FRAME_CLOCKS)<<20) / magnitude;
+    unsigned long mean16 = 0;
+    if (intervals) mean16 = (interval_sum<<4) / intervals;
+    long mean_error = mean16 - ideal16;
+    if (mean_error < 0) mean_error = -mean_error;
+    if ((intervals == 0) || (mean_error > (long)(ideal16/1000) + 16)) pass = 0;
+    if ((((long)interval_min<<4) < (long)ideal16 - (JITTER_LIMIT<<4)) ||
+        (((long)interval_max<<4) > (long)ideal16 + (JITTER_LIMIT<<4))) pass = 0;
+
+    putString("rate ");
+    putFixed(requested);
+    putLabel(": pulses ", seen);
+    putString(" requested ");
+    putFixed(requested * RUN_FRAMES);
+    putLabel(" returned ", reported);
+    putLabel(" interval ideal ", ideal16>>4);
+    putLabel(" mean ", mean16>>4);
+    putLabel(" min ", interval_min);
+    putLabel(" max ", interval_max);
+    putString(pass ? " PASS\r\n" : " FAIL\r\n");
+    return pass;
+}
+
+int main(void)
+{
+    // set the uart for 9600 baud, 8 bits, no parity, one stop bit
+    UBRR0 = (F_CPU/16)/9600-1;
+    UCSR0B = (1<<TXEN0);
+    UCSR0C = (1<<UCSZ01) | (1<<UCSZ00);
+
+    // timer 0 counts cpu clocks for the timestamps
+    TCCR0A = 0x00;
+    TCCR0B = 0x01;
+    TIMSK0 = (1<<TOIE0);
+
+    // interrupt on any change of the step pin
+    PCMSK0 = (1<<PCINT2);
+    PCICR = (1<<PCIE0);
+
+    // timer 2 gives the 4kHz frame (CTC mode, divide by 32)
+    TCCR2A = 0x02;
+    TCCR2B = 0x03;
+    OCR2A = (F_CPU/32) / 4000;
+    TIMSK2 = 0x02;
+
+    step_dir_out1_init();
+    __builtin_avr_sei();
+
+    unsigned char failures = 0;
+    for (unsigned char i = 0; i < RATE_COUNT; i++) {
+        if (!runRate(rates[i])) failures++;
+    }
+    putString(failures ? "stepdir timing: FAIL\r\n" : "stepdir timing: PASS\r\n");
+
+    while (1);
+    return 0;
+}
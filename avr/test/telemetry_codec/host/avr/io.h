@@ -0,0 +1,8 @@
+//    avr/io.h
+//
+//    This header stands in for the avr-libc register definitions when
+//    the telemetry sources are compiled for the host.  None of the
+//    registers are used by the code under test.
+//
+#pragma once
+extern unsigned char SREG;
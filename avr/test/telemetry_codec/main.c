@@ -0,0 +1,211 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a round trip test and bandwidth benchmark for the
+//    telemetry stream (userver/telemetry.c).  The telemetry code is run
+//    on the host against a model of the serial link: a frame can only
+//    be queued once the previous one has gone out at the baud rate.
+//    Every frame is decoded with telemetry_decodeFrame() and checked
+//    against the values that were sampled, and the number of rows the
+//    link carried is reported for the raw and delta encodings.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "mctp.h"
+#include "telemetry.h"
+#include "telemetry_decode.h"
+
+// the status register (unused by the code under test)
+unsigned char SREG;
+
+// the control loop rate and the length of each run
+#define SAMPLE_RATE 4000
+#define RUN_CYCLES  20000
+
+// serial framing around each PLDM message: sync, revision, byte count,
+// the four byte transport header and message type, then the FCS and
+// the closing sync.  Escapes within the FCS are not counted.
+#define FRAMING_BYTES 11
+
+// the simulated sensors
+static volatile int32_t position;       // stepper position (steps)
+static volatile int32_t voltage;        // analog input (FIXEDPOINT_24_8 volts)
+static volatile unsigned char state;    // a state sensor
+
+// the values of every sample taken, indexed by sample number
+static int32_t truth[RUN_CYCLES][TELEMETRY_MAX_SENSORS];
+
+// the endpoint the frames are sent to
+#define RECEIVER_EID 0x20
+
+// the simulated link
+static double now;                      // time in seconds
+static double linkFree;                 // time the link finishes the last frame
+static double baudRate;
+
+// results of a run
+static unsigned long frames;
+static unsigned long rows;
+static unsigned long wireBytes;
+static unsigned long errors;
+static unsigned char nextSequence;
+static unsigned char sensorCount;
+
+//*******************************************************************
+// mctp_isTransmitIdle()
+//
+// link model - the link is idle once the last frame has gone out.
+unsigned char mctp_isTransmitIdle() {
+    return now >= linkFree;
+}
+
+//*******************************************************************
+// mctp_transmitRequest()
+//
+// link model - decode and check the frame and mark the link busy for
+// the time it takes to send it.
+unsigned char mctp_transmitRequest(unsigned char destEid, unsigned char mctp_message_type, const mctp_segment *segments, unsigned char count) {
+    unsigned char message[256];
+    unsigned int length = 0;
+    for (unsigned char i = 0; i < count; i++) {
+        memcpy(message + length, segments[i].data.ptr, segments[i].size);
+        length += segments[i].size;
+    }
+
+    // every sync or escape character in the body is sent as two bytes
+    unsigned int bytes = FRAMING_BYTES + length;
+    for (unsigned int i = 0; i < length; i++) {
+        if ((message[i] == SYNC_CHAR) || (message[i] == ESCAPE_CHAR)) bytes++;
+    }
+    linkFree = now + (bytes * 10) / baudRate;
+    wireBytes += bytes;
+
+    static TelemetryFrame frame;
+    if ((destEid != RECEIVER_EID) || (mctp_message_type != MCTP_TYPE_PLDM) || (!telemetry_decodeFrame(message, length, &frame))) {
+        printf("  frame %lu is misaddressed or did not decode\n", frames);
+        errors++;
+        return 1;
+    }
+    if ((frame.sequence != nextSequence) || (frame.sensorCount != sensorCount)) {
+        printf("  frame %lu has sequence %d, sensor count %d\n", frames, frame.sequence, frame.sensorCount);
+        errors++;
+    }
+    nextSequence = frame.sequence + 1;
+    for (unsigned char row = 0; row < frame.rowCount; row++) {
+        unsigned int sample = frame.firstSample + row;
+        if ((sample >= RUN_CYCLES) || (memcmp(frame.values[row], truth[sample], sensorCount*sizeof(int32_t)))) {
+            printf("  frame %lu row %d (sample %u) does not match\n", frames, row, sample);
+            errors++;
+        }
+    }
+    frames++;
+    rows += frame.rowCount;
+    return 1;
+}
+
+//*******************************************************************
+// updateSensors()
+//
+// move the simulated sensors on by one control cycle.  The stepper
+// runs a trapezoid move at up to 12 steps per cycle and back again,
+// the analog input sits near 2.5V with a slow ripple and a little
+// noise, and the state sensor changes every 1000 cycles.
+static void updateSensors(unsigned long cycle) {
+    static int32_t velocity = 0;
+    static uint32_t noise = 1;
+    unsigned long phase = cycle % 8000;
+    if (phase < 1200) velocity = phase / 100;
+    else if (phase < 4000) velocity = 12;
+    else if (phase < 5200) velocity = -(int32_t)((phase - 4000) / 100);
+    else if (phase < 8000) velocity = -12;
+    position += velocity;
+
+    noise = noise * 1103515245 + 12345;
+    int32_t ripple = ((cycle % 400) < 200) ? (cycle % 200) / 20 : 10 - (cycle % 200) / 20;
+    voltage = 640 + ripple + (int32_t)((noise >> 16) % 5) - 2;
+
+    if ((cycle % 1000) == 0) state = (state == 1) ? 2 : 1;
+}
+
+//*******************************************************************
+// runStream()
+//
+// stream the first count sensors for a run and report the result.
+//
+// returns:
+//    1 if every frame decoded to the values that were sampled
+static int runStream(unsigned char count, unsigned int decimation, unsigned char encoding, double baud) {
+    const TelemetrySource sources[] = {
+        { &position, 4 },
+        { &voltage, 4 },
+        { &state, 1 }
+    };
+    baudRate = baud;
+    now = linkFree = 0;
+    frames = rows = wireBytes = errors = 0;
+    nextSequence = 0;
+    sensorCount = count;
+    position = 0;
+    state = 1;
+
+    telemetry_init();
+    telemetry_start(sources, count, decimation, 0, encoding, RECEIVER_EID);
+    unsigned long samples = 0;
+    for (unsigned long cycle = 0; cycle < RUN_CYCLES; cycle++) {
+        updateSensors(cycle);
+        if ((cycle % decimation) == decimation - 1) {
+            truth[samples][0] = position;
+            truth[samples][1] = voltage;
+            truth[samples][2] = state;
+            samples++;
+        }
+        telemetry_sample();
+        telemetry_update();
+        now += 1.0 / SAMPLE_RATE;
+    }
+    telemetry_stop();
+
+    double seconds = (double)RUN_CYCLES / SAMPLE_RATE;
+    printf("%6.0f baud %d sensor%s decimation %-3u %-5s: %5lu frames, %5.2f rows/frame, "
+        "%5.1f bytes/row, %6.0f of %5.0f rows/s%s\n",
+        baud, count, (count > 1) ? "s" : " ", decimation,
+        (encoding == TELEMETRY_ENCODING_DELTA) ? "delta" : "raw",
+        frames, frames ? (double)rows/frames : 0.0, rows ? (double)wireBytes/rows : 0.0,
+        rows/seconds, samples/seconds, errors ? " FAIL" : "");
+    return (errors == 0);
+}
+
+int main()
+{
+    static const double bauds[] = { 9600, 115200 };
+    static const struct { unsigned char count; unsigned int decimation; } streams[] = {
+        { 1, 1 }, { 3, 1 }, { 3, 10 }
+    };
+    int failures = 0;
+
+    for (unsigned int b = 0; b < sizeof(bauds)/sizeof(bauds[0]); b++) {
+        for (unsigned int s = 0; s < sizeof(streams)/sizeof(streams[0]); s++) {
+            for (unsigned char encoding = TELEMETRY_ENCODING_RAW; encoding <= TELEMETRY_ENCODING_DELTA; encoding++) {
+                if (!runStream(streams[s].count, streams[s].decimation, encoding, bauds[b])) failures++;
+            }
+        }
+    }
+    printf(failures ? "telemetry codec: FAIL\n" : "telemetry codec: PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+//    telemetry_decode.c
+//
+//    This file defines the host-side decoder for the telemetry frames
+//    streamed by the userver (see userver/telemetry.c).  A manager can
+//    use it to turn the PLDM body of a CMD_OEM_TELEMETRY_FRAME or
+//    CMD_OEM_TELEMETRY_DELTA_FRAME datagram back into sample rows.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include "pldm.h"
+#include "telemetry_decode.h"
+
+// the bytes ahead of the sample data: the PLDM header, sequence number,
+// first sample number, sensor count and row count
+#define FRAME_HEADER_SIZE 8
+
+//*******************************************************************
+// getVarint()
+//
+// read a zig-zag varint (see putVarint() in telemetry.c).
+//
+// parameters:
+//    data - the next byte to read, advanced past the value
+//    end - one past the last byte of the frame
+//    value - where to put the decoded value
+// returns:
+//    1 if a whole value was read, otherwise 0
+static int getVarint(const unsigned char **data, const unsigned char *end, int32_t *value) {
+    uint32_t zz = 0;
+    for (unsigned char shift = 0; shift < 35; shift += 7) {
+        if (*data == end) return 0;
+        unsigned char ch = *(*data)++;
+        zz |= ((uint32_t)(ch & 0x7f)) << shift;
+        if (!(ch & 0x80)) {
+            *value = (int32_t)((zz >> 1) ^ (0 - (zz & 1)));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//*******************************************************************
+// telemetry_decodeFrame()
+//
+// decode one telemetry frame.  Raw frames carry each value as a
+// little-endian 32-bit number.  The first row of a delta frame holds
+// the values themselves and each later row the difference from the
+// row before, all as zig-zag varints.
+//
+// parameters:
+//    message - the PLDM message, starting with the PLDM header
+//    length - the length of the message in bytes
+//    frame - where to put the decoded frame
+// returns:
+//    1 if the frame was decoded, 0 if it is not a telemetry frame or
+//    is malformed
+int telemetry_decodeFrame(const unsigned char *message, unsigned int length, TelemetryFrame *frame) {
+    if (length < FRAME_HEADER_SIZE) return 0;
+    if ((message[1] & 0x3f) != PLDM_TYPE_OEM) return 0;
+    if (message[2] == CMD_OEM_TELEMETRY_FRAME) frame->encoding = TELEMETRY_ENCODING_RAW;
+    else if (message[2] == CMD_OEM_TELEMETRY_DELTA_FRAME) frame->encoding = TELEMETRY_ENCODING_DELTA;
+    else return 0;
+
+    frame->sequence = message[3];
+    frame->firstSample = message[4] | (message[5] << 8);
+    frame->sensorCount = message[6];
+    frame->rowCount = message[7];
+    if ((frame->sensorCount == 0) || (frame->sensorCount > TELEMETRY_MAX_SENSORS)) return 0;
+    if (frame->rowCount > TELEMETRY_DECODE_MAX_ROWS) return 0;
+
+    const unsigned char *data = message + FRAME_HEADER_SIZE;
+    const unsigned char *end = message + length;
+    for (unsigned char row = 0; row < frame->rowCount; row++) {
+        for (unsigned char i = 0; i < frame->sensorCount; i++) {
+            int32_t value;
+            if (frame->encoding == TELEMETRY_ENCODING_RAW) {
+                if (end - data < 4) return 0;
+                value = (int32_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                    ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+                data += 4;
+            } else {
+                if (!getVarint(&data, end, &value)) return 0;
+                if (row) value = (int32_t)((uint32_t)frame->values[row-1][i] + (uint32_t)value);
+            }
+            frame->values[row][i] = value;
+        }
+    }
+    return (data == end);
+}
@@ -0,0 +1,42 @@
+//    telemetry_decode.h
+//
+//    This header file declares the host-side decoder for the telemetry
+//    frames streamed by the userver (see userver/telemetry.c).
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+#include <stdint.h>
+#include "telemetry.h"
+
+// the most rows a frame can carry (one single byte value per row)
+#define TELEMETRY_DECODE_MAX_ROWS 64
+
+// a decoded telemetry frame
+typedef struct {
+    unsigned char encoding;       // TELEMETRY_ENCODING_RAW or _DELTA
+    unsigned char sequence;       // frame sequence number
+    uint16_t      firstSample;    // sample number of the first row
+    unsigned char sensorCount;    // values per row
+    unsigned char rowCount;       // rows in the frame
+    int32_t       values[TELEMETRY_DECODE_MAX_ROWS][TELEMETRY_MAX_SENSORS];
+} TelemetryFrame;
+
+int telemetry_decodeFrame(const unsigned char *message, unsigned int length, TelemetryFrame *frame);
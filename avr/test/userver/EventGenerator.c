@@ -30,9 +30,6 @@
 #include "mctp.h"
 #include "pldm.h"
 
-#define MAX_TIMEOUT_COUNT (1*SAMPLE_RATE)
-#define MAX_ATTEMPTS      3
-
 //==============================================
 // MACRO DEFINITIONS FOR THE STATE MACHINE STATE
 //==============================================
@@ -53,8 +50,7 @@ void eventgenerator_init(EventGeneratorInstance *egi)
 {
     egi->eventOccurred = 0;
     egi->eventState    = DISABLED;
-    egi->priority      = -1;
-    egi->sendEvent     = 0;
+    egi->queueEvent    = 0;
 }
 
 //===================================================================
@@ -71,24 +67,27 @@ void eventgenerator_setEventOccuredFn(EventGeneratorInstance *egi, char (*fn)())
 }
 
 //===================================================================
-// eventgenerator_setSendEventFn()
+// eventgenerator_setQueueEventFn()
 //
-// set the function to be used to send an event.
+// set the function to be used to place an event in the node's event
+// queue.  The function captures the event data and returns true if
+// the event was queued.
 //
 // parameters:
 //    egi - a pointer to the event generator instance that will be
 //          evaluated.
-void eventgenerator_setSendEventFn(EventGeneratorInstance *egi,void (*fn)(PldmRequestHeader*,unsigned char))
+void eventgenerator_setQueueEventFn(EventGeneratorInstance *egi,char (*fn)())
 {
-    egi->sendEvent = fn;
+    egi->queueEvent = fn;
 }
 
 //===================================================================
 // eventgenerator_isEventPending()
 //
 // this function returns true if the sensor has an event that is 
-// pending that has not been sent to the PDLM Event Receiver.  
-// This corresponds to the PENDING finite state machine state. 
+// pending that has not yet been placed in the event queue (because
+// the queue was full).  This corresponds to the PENDING finite state
+// machine state. 
 //
 // parameters:
 //    egi - a pointer to the event generator instance that will be
@@ -101,9 +100,9 @@ char eventgenerator_isEventPending(EventGeneratorInstance* egi)
 //===================================================================
 // eventgenerator_isEventSending()
 //
-// this function returns true if the sensor has initiated an event 
-// message with the PLDM Event Receiver but the event has not yet 
-// been acknowledged.
+// this function returns true if the sensor's event has been placed
+// in the event queue but has not yet been acknowledged by the PLDM
+// Event Receiver.
 //
 // parameters:
 //    egi - a pointer to the event generator instance that will be
@@ -146,31 +145,12 @@ void eventgenerator_setEnableEvents(EventGeneratorInstance* egi, unsigned char e
     }
 }
 
-//===================================================================
-// eventgenerator_startSending()
-//
-// When the sensors’s state machine is in the PENDING state, this 
-// function will cause it to transition to SENDING so that on the 
-// next call to updateEventStateMachine(), event transmission will 
-// begin.  This function has no effect when the state machine is in 
-// any other state.
-// 
-// parameters:
-//    egi - a pointer to the event generator instance that will be
-//          operated on.
-void eventgenerator_startSending(EventGeneratorInstance* egi, PldmRequestHeader *rxHeader, unsigned char more)
-{
-    if (egi->eventState == PENDING) {
-        egi->eventState = SENT;
-        egi->sendEvent(rxHeader,more);
-    }
-}
-
 //===================================================================
 // eventgenerator_acknowledge()
 //
-// acknowledge the event for this sensor.  Clear the fifo priority
-// and transition back to the ENABLED state.
+// acknowledge the event for this sensor.  This is called by the node
+// when the event is removed from the event queue and transitions the
+// state machine back to the ENABLED state.
 // 
 // parameters:
 //    egi - a pointer to the event generator instance that will be
@@ -179,7 +159,6 @@ void eventgenerator_acknowledge(EventGeneratorInstance* egi)
 {
     if (egi->eventState == SENT) {
         egi->eventState = ENABLED;
-        egi->priority = -1;
     }
 }
 
@@ -189,7 +168,8 @@ void eventgenerator_acknowledge(EventGeneratorInstance* egi)
 // this function updates the event state machine for the sensor.  
 // This function should be called at regular intervals by the main 
 // program code to maintain event generation functionality for the 
-// sensor. 
+// sensor.  Events are queued as soon as they occur so that the event
+// data reflects the sensor at that time.
 //
 // parameters:
 //    egi - a pointer to the event generator instance that will be
@@ -201,13 +181,16 @@ void eventgenerator_updateEventStateMachine(EventGeneratorInstance* egi)
             // do nothing - just wait to be enabled
             break;
         case ENABLED:
-            if (egi->eventOccurred()) egi->eventState = PENDING;
-            break;
+            if (!egi->eventOccurred()) break;
+            egi->eventState = PENDING;
+            // fall through - queue the event right away
         case PENDING:
-            // do nothing - just wait for start sending command
+            // the event stays pending while the queue is full
+            if (egi->queueEvent()) egi->eventState = SENT;
             break;
         case SENT:
-            // do nothing - just wait for acknowledge
+            // do nothing - wait for the event to be pushed to the event
+            // receiver or polled, and then acknowledged
             break;
         default:
             egi->eventState = DISABLED;
@@ -31,20 +31,18 @@
 
 typedef struct {
     unsigned char eventState;   // the current state of the event generator
-    char priority;              // fifo priority
     char (*eventOccurred)();    // pointer to child's implmentation eventOccured()
-    void (*sendEvent)(PldmRequestHeader *, unsigned char); // pointer to child's implmentation of sendEvent()
+    char (*queueEvent)();       // pointer to child's implmentation of queueEvent()
 
 } EventGeneratorInstance;
 
 void eventgenerator_init(EventGeneratorInstance *egi);
 void eventgenerator_setEventOccurredFn(EventGeneratorInstance *egi,char (*)());
-void eventgenerator_setSendEventFn(EventGeneratorInstance *egi,void (*)(PldmRequestHeader *, unsigned char));
+void eventgenerator_setQueueEventFn(EventGeneratorInstance *egi,char (*)());
 char eventgenerator_isEventPending(EventGeneratorInstance* egi);
 char eventgenerator_isEventSent(EventGeneratorInstance* egi);
 char eventgenerator_isEnabled(EventGeneratorInstance* egi);
 void eventgenerator_setEnableEvents(EventGeneratorInstance* egi, unsigned char enable);
-void eventgenerator_startSending(EventGeneratorInstance* egi, PldmRequestHeader *rxHeader, unsigned char more);
 void eventgenerator_updateEventStateMachine(EventGeneratorInstance* egi);
 void eventgenerator_acknowledge(EventGeneratorInstance* egi);
 
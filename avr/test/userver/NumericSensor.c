@@ -55,6 +55,23 @@
 #define STATE_UPPERCRITICAL  9
 #define STATE_UPPERFATAL    10
 
+//===================================================================
+// clearStatistics()
+// 
+// empty a statistics accumulator.  The minimum and maximum start at
+// the extremes so that the first sample replaces both of them.
+//
+// parameters:
+//    stats - a pointer to the statistics to clear.
+// returns: nothing
+static void clearStatistics(NumericSensorStatistics *stats)
+{
+    stats->min = 0x7fffffffL;
+    stats->max = -0x7fffffffL - 1;
+    stats->sum = 0;
+    stats->count = 0;
+}
+
 //===================================================================
 // numericsensor_init()
 // 
@@ -69,15 +86,20 @@ void numericsensor_init(NumericSensorInstance *inst)
     inst->previousState = 0;           
     inst->eventState = 0;         
     eventgenerator_init(&(inst->eventGen));
-    inst->eventGen.sendEvent = 0;
+    inst->eventGen.queueEvent = 0;
     inst->eventGen.eventOccurred = 0;
+    inst->statisticsEnabled = 0;
+    inst->statisticsWindow = 0;
+    clearStatistics(&(inst->statistics));
+    clearStatistics(&(inst->lastWindow));
 }
 
 //===================================================================
 // numericsensor_setValue()
 //
 // set the value read from the channel.  This function should have no 
-// action if the sensor operational state is set to “disabled”.
+// action if the sensor operational state is set to “disabled”.  If
+// statistics are enabled for the sensor, the value is added to them.
 //
 // This function should be called from the high priority loop only.
 //
@@ -87,6 +109,21 @@ void numericsensor_init(NumericSensorInstance *inst)
 void numericsensor_setValue(NumericSensorInstance *inst, FIXEDPOINT_24_8 val)
 {
     inst->value = val;
+    if (!inst->statisticsEnabled) return;
+
+    // accumulate the statistics, moving them to the last window once
+    // the window is full.  Without a window, the statistics stop
+    // accumulating when the count is about to overflow.
+    NumericSensorStatistics *stats = &(inst->statistics);
+    if (stats->count == 0xffff) return;
+    if (val < stats->min) stats->min = val;
+    if (val > stats->max) stats->max = val;
+    stats->sum += val;
+    stats->count++;
+    if (stats->count == inst->statisticsWindow) {
+        inst->lastWindow = *stats;
+        clearStatistics(stats);
+    }
 }
 
 //===================================================================
@@ -564,3 +601,101 @@ unsigned char   numericsensor_setThresholds(NumericSensorInstance *inst,FIXEDPOI
     SREG = sreg;
     return 1;
 }
+
+//===================================================================
+// numericsensor_writeSnapshot()
+//
+// write the bulk snapshot entry for the sensor: the sensor id, the
+// operational, present, previous and event states, and then the
+// reading as a little-endian FIXEDPOINT_24_8 value.
+//
+// This is called from the control isr while it captures a snapshot.
+//
+// parameters:
+//    inst - a pointer to the instance data for the sensor.
+//    sensorId - the PLDM sensor id of the sensor
+//    buffer - where to write the entry
+// returns: the size of the entry (NUMERICSENSOR_SNAPSHOT_SIZE)
+unsigned char numericsensor_writeSnapshot(NumericSensorInstance *inst, unsigned int sensorId, unsigned char *buffer)
+{
+    buffer[0] = sensorId & 0xff;
+    buffer[1] = sensorId >> 8;
+    buffer[2] = numericsensor_getOperationalState(inst);
+    buffer[3] = numericsensor_getPresentState(inst);
+    buffer[4] = numericsensor_getSensorPreviousState(inst);
+    buffer[5] = numericsensor_getEventState(inst);
+    *((FIXEDPOINT_24_8*)&buffer[6]) = inst->value;
+    return NUMERICSENSOR_SNAPSHOT_SIZE;
+}
+
+//===================================================================
+// numericsensor_setStatisticsWindow()
+//
+// enable or disable the statistics for the sensor and set the number
+// of samples in each window.  With a window of 0, the statistics
+// accumulate until they are read with a reset (and stop at 65535
+// samples).  Any statistics that have been gathered are
+// discarded.
+//
+// parameters:
+//    inst - a pointer to the instance data for the sensor.
+//    enable - 1 to gather statistics, 0 to stop
+//    window - the number of samples in each window
+// returns: nothing
+void numericsensor_setStatisticsWindow(NumericSensorInstance *inst, unsigned char enable, unsigned int window)
+{
+    // the statistics are updated from the control isr
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+
+    inst->statisticsEnabled = enable;
+    inst->statisticsWindow = window;
+    clearStatistics(&(inst->statistics));
+    clearStatistics(&(inst->lastWindow));
+
+    // restore interrupts to priovious state
+    SREG = sreg;
+}
+
+//===================================================================
+// numericsensor_writeStatistics()
+//
+// write the statistics for the sensor: the enable, the window size,
+// then the sample count, minimum, maximum (FIXEDPOINT_24_8) and the
+// 64-bit sum of the samples, all little-endian.  The mean is the sum
+// divided by the count.  When a window size is set, the most recently
+// completed window is reported, otherwise the samples taken so far.
+//
+// parameters:
+//    inst - a pointer to the instance data for the sensor.
+//    reset - 1 to start a new accumulation once the statistics are read
+//    buffer - where to write the statistics
+// returns: the size of the statistics (NUMERICSENSOR_STATISTICS_SIZE)
+unsigned char numericsensor_writeStatistics(NumericSensorInstance *inst, unsigned char reset, unsigned char *buffer)
+{
+    NumericSensorStatistics stats;
+
+    // the statistics are updated from the control isr
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+
+    if (inst->statisticsWindow) stats = inst->lastWindow;
+    else stats = inst->statistics;
+    if (reset) {
+        clearStatistics(&(inst->statistics));
+        clearStatistics(&(inst->lastWindow));
+    }
+
+    // restore interrupts to priovious state
+    SREG = sreg;
+
+    buffer[0] = inst->statisticsEnabled;
+    buffer[1] = inst->statisticsWindow & 0xff;
+    buffer[2] = inst->statisticsWindow >> 8;
+    buffer[3] = stats.count & 0xff;
+    buffer[4] = stats.count >> 8;
+    *((FIXEDPOINT_24_8*)&buffer[5]) = stats.min;
+    *((FIXEDPOINT_24_8*)&buffer[9]) = stats.max;
+    *((long long*)&buffer[13]) = stats.sum;
+    return NUMERICSENSOR_STATISTICS_SIZE;
+}
@@ -29,6 +29,20 @@
 #include "node.h"
 #include "EventGenerator.h"
 
+// the size of a numeric sensor entry within a bulk sensor snapshot
+#define NUMERICSENSOR_SNAPSHOT_SIZE 10
+
+// the size of the statistics written by numericsensor_writeStatistics()
+#define NUMERICSENSOR_STATISTICS_SIZE 21
+
+// the minimum, maximum and sum of the values set over a number of samples
+typedef struct {
+    FIXEDPOINT_24_8 min;
+    FIXEDPOINT_24_8 max;
+    long long       sum;
+    unsigned int    count;
+} NumericSensorStatistics;
+
 typedef struct {
     FIXEDPOINT_24_8 value;           // the current value read from the channel
     unsigned char operationalState;  // the operational state of the sensor
@@ -44,6 +58,10 @@ typedef struct {
     FIXEDPOINT_24_8 hysteresisValue;
     unsigned char   thresholdEnables;
     FIXEDPOINT_24_8 valueOffset;    
+    unsigned char   statisticsEnabled;
+    unsigned int    statisticsWindow;      // samples per window, or 0 to accumulate until reset
+    NumericSensorStatistics statistics;    // the window being accumulated
+    NumericSensorStatistics lastWindow;    // the most recently completed window
 } NumericSensorInstance;
 
 void            numericsensor_init(NumericSensorInstance *inst);
@@ -69,6 +87,9 @@ FIXEDPOINT_24_8 numericsensor_getFatalHighThreshold(NumericSensorInstance *inst)
 FIXEDPOINT_24_8 numericsensor_getWarningLowThreshold(NumericSensorInstance *inst);
 FIXEDPOINT_24_8 numericsensor_getCriticalLowThreshold(NumericSensorInstance *inst);
 FIXEDPOINT_24_8 numericsensor_getFatalLowThreshold(NumericSensorInstance *inst);
+unsigned char   numericsensor_writeSnapshot(NumericSensorInstance *inst, unsigned int sensorId, unsigned char *buffer);
+void            numericsensor_setStatisticsWindow(NumericSensorInstance *inst, unsigned char enable, unsigned int window);
+unsigned char   numericsensor_writeStatistics(NumericSensorInstance *inst, unsigned char reset, unsigned char *buffer);
 unsigned char   numericsensor_setThresholds(NumericSensorInstance *inst,
                     FIXEDPOINT_24_8 fh,FIXEDPOINT_24_8 crh,FIXEDPOINT_24_8 wh,
                     FIXEDPOINT_24_8 wl,FIXEDPOINT_24_8 crl,FIXEDPOINT_24_8 fl);
@@ -119,7 +119,7 @@ unsigned char stateeffecter_isEnabled(StateEffecterInstance *inst)
 // returns: 1 on success, 0 on failure
 unsigned char stateeffecter_setPresentState(StateEffecterInstance *inst, unsigned char state)
 {
-    if (inst->allowedStatesMask & (1<<(state-1))) {
+    if (stateeffecter_isStateAllowed(inst, state)) {
         inst->state = state;
         return 1;
     }
@@ -158,4 +158,83 @@ unsigned char stateeffecter_getPresentState(StateEffecterInstance *inst)
     return inst->state;
 }
 
+//===================================================================
+// stateeffecter_isStateAllowed()
+//
+// returns true if the given state is one of the effecter's allowed
+// states.  State 0 (unknown) is never allowed.
+//
+// parameters:
+//    inst - a pointer to the instance data for the effecter.
+//    state - the state to check
+// returns: 1 if the state is allowed, otherwise 0
+unsigned char stateeffecter_isStateAllowed(StateEffecterInstance *inst, unsigned char state)
+{
+    if ((state == 0) || (state > 8)) return 0;
+    return (inst->allowedStatesMask & (1<<(state-1))) != 0;
+}
+
+//===================================================================
+// stateeffecter_setCompositeStates()
+//
+// apply the field list of a SetStateEffecterStates request to the
+// effecters that make up a (possibly composite) state effecter.  Field
+// i of the request is applied to effecters[i].  Every requested state
+// is checked before any is applied so that a bad field leaves all of
+// the effecters unchanged.
+//
+// parameters:
+//    effecters - the effecter instances, one per composite state
+//    count - the composite effecter count of the effecter
+//    request - a pointer to the compositeEffecterCount field of the
+//       request, followed by {setRequest, effecterState} pairs
+// returns: a PLDM completion code
+unsigned char stateeffecter_setCompositeStates(StateEffecterInstance **effecters, unsigned char count, unsigned char *request)
+{
+    unsigned char fields = request[0];
+    if ((fields == 0) || (fields > count)) return RESPONSE_ERROR_INVALID_DATA;
 
+    // validate all the fields first
+    unsigned char *field = request + 1;
+    for (unsigned char i = 0; i < fields; i++, field += 2) {
+        if (field[0] > 1) return RESPONSE_ERROR_INVALID_DATA;
+        if ((field[0]) && (!stateeffecter_isStateAllowed(effecters[i], field[1]))) {
+            return RESPONSE_UNSUPPORTED_EFFECTERSTATE;
+        }
+    }
+
+    // now update the states (only where setRequest is requestSet)
+    field = request + 1;
+    for (unsigned char i = 0; i < fields; i++, field += 2) {
+        if (field[0]) stateeffecter_setPresentState(effecters[i], field[1]);
+    }
+    return RESPONSE_SUCCESS;
+}
+
+//===================================================================
+// stateeffecter_getCompositeStates()
+//
+// fill in the body of a GetStateEffecterStates response for a
+// (possibly composite) state effecter.  The body holds the composite
+// count followed by {operationalState, pendingState, presentState}
+// for each effecter.  Effecter states change immediately, so the
+// pending state always matches the present state.
+//
+// parameters:
+//    effecters - the effecter instances, one per composite state
+//    count - the composite effecter count of the effecter
+//    responseBody - the buffer for the response body
+//    size - receives the size of the response body
+// returns: a PLDM completion code
+unsigned char stateeffecter_getCompositeStates(StateEffecterInstance **effecters, unsigned char count, unsigned char *responseBody, unsigned char *size)
+{
+    unsigned char *field = responseBody + 1;
+    responseBody[0] = count;
+    for (unsigned char i = 0; i < count; i++, field += 3) {
+        field[0] = stateeffecter_getOperationalState(effecters[i]);
+        field[1] = stateeffecter_getPresentState(effecters[i]);
+        field[2] = stateeffecter_getPresentState(effecters[i]);
+    }
+    *size = 1 + 3*count;
+    return RESPONSE_SUCCESS;
+}
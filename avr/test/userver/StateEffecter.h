@@ -28,6 +28,9 @@
 #define STATEEFFECTER_H_INCLUDED
 #include "node.h"
 
+// the largest composite effecter count allowed by PLDM
+#define STATEEFFECTER_MAX_COMPOSITE 8
+
 typedef struct {
     unsigned char state;             // the current state of the effecter
     unsigned char operationalState;  // the operational state of the sensor
@@ -44,5 +47,8 @@ unsigned char stateeffecter_setPresentState(StateEffecterInstance *inst, unsigne
 unsigned char stateeffecter_getOperationalState(StateEffecterInstance *inst);
 unsigned char stateeffecter_isEnabled(StateEffecterInstance *inst);
 unsigned char stateeffecter_getPresentState(StateEffecterInstance *inst);
+unsigned char stateeffecter_isStateAllowed(StateEffecterInstance *inst, unsigned char state);
+unsigned char stateeffecter_setCompositeStates(StateEffecterInstance **effecters, unsigned char count, unsigned char *request);
+unsigned char stateeffecter_getCompositeStates(StateEffecterInstance **effecters, unsigned char count, unsigned char *responseBody, unsigned char *size);
 
 #endif // STATEEFFECTER_H_INCLUDED
\ No newline at end of file
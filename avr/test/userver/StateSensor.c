@@ -48,7 +48,7 @@ void statesensor_init(StateSensorInstance *inst)
     inst->previousState = 0;           
     inst->eventState = 0;         
     eventgenerator_init(&(inst->eventGen));
-    inst->eventGen.sendEvent = 0;
+    inst->eventGen.queueEvent = 0;
     inst->eventGen.eventOccurred = 0;
 }
 
@@ -274,3 +274,64 @@ void statesensor_setValueFromChannelBit(StateSensorInstance *inst, unsigned char
     inst->value = inst->stateWhenLow;
     if (bit) inst->value = inst->stateWhenHigh; 
 }
+
+//===================================================================
+// statesensor_getCompositeReadings()
+//
+// fill in the body of a GetStateSensorReadings response for a
+// (possibly composite) state sensor.  The body holds the composite
+// count followed by {operationalState, presentState, previousState,
+// eventState} for each sensor.  Sensors whose bit is set in the
+// rearm field are rearmed once they have been read.
+//
+// parameters:
+//    sensors - the sensor instances, one per composite state
+//    count - the composite sensor count of the sensor
+//    rearm - the sensorRearm bit field from the request
+//    responseBody - the buffer for the response body
+//    size - receives the size of the response body
+// returns: a PLDM completion code
+unsigned char statesensor_getCompositeReadings(StateSensorInstance **sensors, unsigned char count, unsigned char rearm, unsigned char *responseBody, unsigned char *size)
+{
+    // rearm bits beyond the composite count refer to sensors that do not exist
+    if ((count < 8) && (rearm >> count)) {
+        *size = 0;
+        return RESPONSE_ERROR_INVALID_DATA;
+    }
+
+    unsigned char *field = responseBody + 1;
+    responseBody[0] = count;
+    for (unsigned char i = 0; i < count; i++, field += 4) {
+        field[0] = statesensor_getOperationalState(sensors[i]);
+        field[1] = statesensor_getPresentState(sensors[i]);
+        field[2] = statesensor_getSensorPreviousState(sensors[i]);
+        field[3] = statesensor_getEventState(sensors[i]);
+        if (rearm & (1<<i)) statesensor_sensorRearm(sensors[i]);
+    }
+    *size = 1 + 4*count;
+    return RESPONSE_SUCCESS;
+}
+
+//===================================================================
+// statesensor_writeSnapshot()
+//
+// write the bulk snapshot entry for the sensor: the sensor id followed
+// by the operational, present, previous and event states.
+//
+// This is called from the control isr while it captures a snapshot.
+//
+// parameters:
+//    inst - a pointer to the instance data for the sensor.
+//    sensorId - the PLDM sensor id of the sensor
+//    buffer - where to write the entry
+// returns: the size of the entry (STATESENSOR_SNAPSHOT_SIZE)
+unsigned char statesensor_writeSnapshot(StateSensorInstance *inst, unsigned int sensorId, unsigned char *buffer)
+{
+    buffer[0] = sensorId & 0xff;
+    buffer[1] = sensorId >> 8;
+    buffer[2] = statesensor_getOperationalState(inst);
+    buffer[3] = statesensor_getPresentState(inst);
+    buffer[4] = statesensor_getSensorPreviousState(inst);
+    buffer[5] = statesensor_getEventState(inst);
+    return STATESENSOR_SNAPSHOT_SIZE;
+}
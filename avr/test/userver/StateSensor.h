@@ -29,6 +29,12 @@
 #include "node.h"
 #include "EventGenerator.h"
 
+// the largest composite sensor count allowed by PLDM
+#define STATESENSOR_MAX_COMPOSITE 8
+
+// the size of a state sensor entry within a bulk sensor snapshot
+#define STATESENSOR_SNAPSHOT_SIZE 6
+
 typedef struct {
     unsigned char value;             // the current raw value read from the channel
     unsigned char operationalState;  // the operational state of the sensor
@@ -53,5 +59,7 @@ unsigned char statesensor_getOperationalState(StateSensorInstance *inst);
 unsigned char statesensor_getPresentState(StateSensorInstance *inst);
 unsigned char statesensor_getEventState(StateSensorInstance *inst);
 unsigned char statesensor_getSensorPreviousState(StateSensorInstance *inst);
+unsigned char statesensor_writeSnapshot(StateSensorInstance *inst, unsigned int sensorId, unsigned char *buffer);
+unsigned char statesensor_getCompositeReadings(StateSensorInstance **sensors, unsigned char count, unsigned char rearm, unsigned char *responseBody, unsigned char *size);
 
 #endif // STATESENSOR_H_INCLUDED
\ No newline at end of file
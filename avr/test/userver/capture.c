@@ -0,0 +1,266 @@
+//    capture.c
+//
+//    This file defines functions related to triggered capture of
+//    control loop values as part of the PICMG reference code for IoT.
+//    Selected values are recorded by the control isr into a ring
+//    buffer until a trigger condition is met and the post-trigger rows
+//    have been recorded.  The manager then reads the capture back with
+//    a multipart transfer.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__ 
+#define __AVR_ATmega328P__
+#endif
+
+#include <avr/io.h>
+#include "capture.h"
+
+#ifdef CAPTURE
+
+// capture settings
+static TelemetrySource channels[CAPTURE_MAX_CHANNELS];
+static unsigned char   channelCount;
+static unsigned char   rowSize;
+static unsigned int    rowCapacity;
+static unsigned int    decimation;
+static unsigned int    postTrigger;       // rows recorded from the trigger onward
+static unsigned char   condition;
+static unsigned char   triggerChannel;
+static long            threshold;
+static volatile unsigned char state = CAPTURE_STATE_IDLE;
+
+// capture ring - written by the control isr until the capture is done
+static unsigned char   buffer[CAPTURE_BUFFER_SIZE];
+static unsigned int    head;
+static unsigned int    rowCount;
+static unsigned int    remaining;
+static unsigned int    decimationCount;
+static long            lastValue;
+static unsigned char   primed;            // lastValue holds a previous sample
+
+//*******************************************************************
+// capture_init()
+//
+// initialize the capture engine.  Nothing is recorded until the
+// manager arms a capture.
+//
+// parameters: none
+// returns: nothing
+void capture_init() {
+    state = CAPTURE_STATE_IDLE;
+    rowCount = 0;
+}
+
+//*******************************************************************
+// capture_arm()
+//
+// arm a capture of the given channels, discarding any previous
+// capture.  A row is recorded every decimation control cycles.  Up to
+// preTrigger rows recorded before the trigger are kept and the rest of
+// the buffer is filled with the rows that follow it.
+//
+// parameters:
+//    sources - the values to record
+//    count - the number of channels (1 to CAPTURE_MAX_CHANNELS)
+//    decim - the number of control cycles between rows
+//    preTrigger - the number of rows to keep from before the trigger
+//    cond - the trigger condition (CAPTURE_TRIGGER_xxx)
+//    trigChannel - the channel that the trigger condition tests
+//    thresh - the threshold for rising and falling triggers
+// returns:
+//    the number of rows that the buffer holds, or 0 if the settings
+//    are not valid
+unsigned int capture_arm(const TelemetrySource *sources, unsigned char count, unsigned int decim, unsigned int preTrigger, unsigned char cond, unsigned char trigChannel, long thresh) {
+    if ((count == 0) || (count > CAPTURE_MAX_CHANNELS) || (decim == 0)) return 0;
+    if ((cond > CAPTURE_TRIGGER_CHANGE) || (trigChannel >= count)) return 0;
+
+    unsigned char size = 0;
+    for (unsigned char i = 0; i < count; i++) size += sources[i].size;
+    unsigned int capacity = CAPTURE_BUFFER_SIZE / size;
+    if (preTrigger >= capacity) return 0;
+
+    // the isr ignores the settings while the capture is idle
+    state = CAPTURE_STATE_IDLE;
+    for (unsigned char i = 0; i < count; i++) channels[i] = sources[i];
+    channelCount = count;
+    rowSize = size;
+    rowCapacity = capacity;
+    decimation = decim;
+    decimationCount = decim;
+    postTrigger = capacity - preTrigger;
+    condition = cond;
+    triggerChannel = trigChannel;
+    threshold = thresh;
+    head = 0;
+    rowCount = 0;
+    primed = 0;
+    state = CAPTURE_STATE_ARMED;
+    return capacity;
+}
+
+//*******************************************************************
+// capture_stop()
+//
+// abandon the current capture and discard its rows.
+//
+// parameters: none
+// returns: nothing
+void capture_stop() {
+    state = CAPTURE_STATE_IDLE;
+    rowCount = 0;
+}
+
+#pragma GCC push_options
+#pragma GCC optimize "-O3"
+//*******************************************************************
+// capture_sample()
+//
+// record a row if one is due and test the trigger condition.  This is
+// called from the control isr after the entities have updated their
+// values.  The trigger row is the first of the post-trigger rows and
+// the capture is done once all of them have been recorded.
+//
+// parameters: none
+// returns: nothing
+void capture_sample() {
+    if ((state != CAPTURE_STATE_ARMED) && (state != CAPTURE_STATE_TRIGGERED)) return;
+    if (--decimationCount) return;
+    decimationCount = decimation;
+
+    unsigned char *row = &buffer[head * rowSize];
+    long triggerValue = 0;
+    for (unsigned char i = 0; i < channelCount; i++) {
+        long value;
+        if (channels[i].size == 1) {
+            value = *((const volatile unsigned char*)channels[i].value);
+            *row++ = value;
+        } else {
+            value = *((const volatile long*)channels[i].value);
+            *((long*)row) = value;
+            row += 4;
+        }
+        if (i == triggerChannel) triggerValue = value;
+    }
+    if (++head == rowCapacity) head = 0;
+    if (rowCount < rowCapacity) rowCount++;
+
+    if (state == CAPTURE_STATE_ARMED) {
+        unsigned char fire = 0;
+        switch (condition) {
+        case CAPTURE_TRIGGER_IMMEDIATE:
+            fire = 1;
+            break;
+        case CAPTURE_TRIGGER_RISING:
+            fire = primed && (lastValue < threshold) && (triggerValue >= threshold);
+            break;
+        case CAPTURE_TRIGGER_FALLING:
+            fire = primed && (lastValue > threshold) && (triggerValue <= threshold);
+            break;
+        case CAPTURE_TRIGGER_CHANGE:
+            fire = primed && (lastValue != triggerValue);
+            break;
+        }
+        lastValue = triggerValue;
+        primed = 1;
+        if (!fire) return;
+        remaining = postTrigger;
+        state = CAPTURE_STATE_TRIGGERED;
+    }
+    if (--remaining == 0) state = CAPTURE_STATE_DONE;
+}
+#pragma GCC pop_options
+
+//*******************************************************************
+// capture_writeStatus()
+//
+// write the capture status: the state, the channel count, the row
+// size, the number of rows recorded and the index of the trigger row
+// within them (valid once the capture is done).
+//
+// parameters:
+//    buf - where to write the status (CAPTURE_STATUS_SIZE bytes)
+// returns:
+//    the number of bytes written
+unsigned char capture_writeStatus(unsigned char *buf) {
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+    unsigned char current = state;
+    unsigned int rows = rowCount;
+    SREG = sreg;
+
+    unsigned int triggerRow = (current == CAPTURE_STATE_DONE) ? rows - postTrigger : 0;
+    buf[0] = current;
+    buf[1] = channelCount;
+    buf[2] = rowSize;
+    buf[3] = rows & 0xff;
+    buf[4] = rows >> 8;
+    buf[5] = triggerRow & 0xff;
+    buf[6] = triggerRow >> 8;
+    return CAPTURE_STATUS_SIZE;
+}
+
+//*******************************************************************
+// capture_getSize()
+//
+// return the size of the completed capture in bytes.
+//
+// parameters: none
+// returns:
+//    the number of bytes that can be read, or 0 if the capture is not
+//    done
+unsigned int capture_getSize() {
+    if (state != CAPTURE_STATE_DONE) return 0;
+    return rowCount * rowSize;
+}
+
+//*******************************************************************
+// capture_read()
+//
+// copy part of the completed capture, oldest row first.  The isr does
+// not write to the buffer once the capture is done so no locking is
+// needed.
+//
+// parameters:
+//    offset - the byte offset within the capture
+//    buf - where to copy the data
+//    count - the most bytes to copy
+// returns:
+//    the number of bytes copied
+unsigned char capture_read(unsigned int offset, unsigned char *buf, unsigned char count) {
+    unsigned int size = capture_getSize();
+    if (offset >= size) return 0;
+    if (size - offset < count) count = size - offset;
+
+    // the oldest row follows the newest one once the ring has wrapped
+    unsigned int row = head + rowCapacity - rowCount + offset / rowSize;
+    if (row >= rowCapacity) row -= rowCapacity;
+    unsigned char column = offset % rowSize;
+    for (unsigned char i = 0; i < count; i++) {
+        buf[i] = buffer[row * rowSize + column];
+        if (++column == rowSize) {
+            column = 0;
+            if (++row == rowCapacity) row = 0;
+        }
+    }
+    return count;
+}
+
+#endif
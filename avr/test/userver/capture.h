@@ -0,0 +1,63 @@
+//    capture.h
+//
+//    This header file declares functions related to triggered capture
+//    of control loop values as part of the PICMG reference code for IoT.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+#include "telemetry.h"
+
+// The triggered capture is only compiled in when the firmware is built
+// with -DCAPTURE.  It holds about 300 bytes of sram (mostly the capture
+// buffer), which the stack gets back when the capture is left out.
+
+// the most channels that a single capture may record
+#define CAPTURE_MAX_CHANNELS 4
+
+// the size of the capture buffer in bytes.  Each row holds one value per
+// channel (one byte for state values, four for numeric values) so the
+// number of rows depends on the channels that are recorded.
+#define CAPTURE_BUFFER_SIZE 256
+
+// trigger conditions (tested against the trigger channel)
+#define CAPTURE_TRIGGER_IMMEDIATE 0   // trigger on the first row
+#define CAPTURE_TRIGGER_RISING    1   // value rises to or above the threshold
+#define CAPTURE_TRIGGER_FALLING   2   // value falls to or below the threshold
+#define CAPTURE_TRIGGER_CHANGE    3   // value changes (e.g. trigger input or motion state)
+
+// capture states
+#define CAPTURE_STATE_IDLE      0
+#define CAPTURE_STATE_ARMED     1     // recording pre-trigger rows, waiting for the trigger
+#define CAPTURE_STATE_TRIGGERED 2     // recording post-trigger rows
+#define CAPTURE_STATE_DONE      3     // capture complete, ready to be read
+
+// the size of the capture status written by capture_writeStatus()
+#define CAPTURE_STATUS_SIZE 7
+
+#ifdef CAPTURE
+void          capture_init();
+unsigned int  capture_arm(const TelemetrySource *sources, unsigned char count, unsigned int decimation, unsigned int preTrigger, unsigned char condition, unsigned char triggerChannel, long threshold);
+void          capture_stop();
+void          capture_sample();
+unsigned char capture_writeStatus(unsigned char *buffer);
+unsigned int  capture_getSize();
+unsigned char capture_read(unsigned int offset, unsigned char *buffer, unsigned char count);
+#endif
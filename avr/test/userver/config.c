@@ -47,6 +47,21 @@ PDR_BYTE_TYPE __pdr_data[] PDR_DATA_ATTRIBUTES = {
    0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x43, 0x00, 0x01, 0x03
 };
 
+PDR_INDEX_TYPE __pdr_index[] PDR_INDEX_ATTRIBUTES = { 
+   // offset, size, crc8
+   {   0,  19, 0x61},   // Terminus Locator PDR
+   {  19,  20, 0xdd},   // FRU Record Set
+   {  39,  26, 0xcb},   // Entity Association
+   {  65,  38, 0xc7},   // OEM Entity ID
+   { 103, 106, 0x8d},   // OEM State Set
+   { 209,  27, 0x34},   // State Sensor GlobalInterlockSensor
+   { 236,  29, 0x97},   // State Effecter GlobalInterlockEffecter
+   { 265,  27, 0x94},   // State Sensor TriggerSensor
+   { 292,  29, 0x46},   // State Effecter TriggerEffecter
+   { 321, 105, 0x53},   // Numeric Sensor Sensor1
+   { 426,  27, 0xc9}    // State Sensor Sensor2
+};
+
 FRU_BYTE_TYPE __fru_data[] FRU_DATA_ATTRIBUTES = {
    // FRU Record 1
    0x01, 0x00, 0x01, 0x01, 0x02, 0x07, 0x05, 0x50, 0x49, 0x43, 0x4d, 0x47
@@ -35,12 +35,23 @@
 typedef signed long FIXEDPOINT_24_8;
 
 #define PDR_BYTE_TYPE const unsigned char
+#define PDR_INDEX_TYPE const PdrIndexEntry
 #define FRU_BYTE_TYPE const unsigned char
 #define LINTABLE_TYPE const long
 #define PDR_DATA_ATTRIBUTES PROGMEM
+#define PDR_INDEX_ATTRIBUTES PROGMEM
 #define FRU_DATA_ATTRIBUTES PROGMEM
 #define LINTABLE_DATA_ATTRIBUTES PROGMEM
 
+// one entry per pdr record, in repository order.  Offset is the byte
+// offset of the record within __pdr_data, size is the total record size
+// (including the common header) and crc8 is the crc of the whole record.
+typedef struct {
+    unsigned int  offset;
+    unsigned int  size;
+    unsigned char crc8;
+} PdrIndexEntry;
+
 //====================
 // Module-Related Macros
 #define ATMEGA328PB
@@ -48,6 +59,7 @@ typedef signed long FIXEDPOINT_24_8;
 //====================
 // PDR-Related Macros
 extern PDR_BYTE_TYPE __pdr_data[] PDR_DATA_ATTRIBUTES;
+extern PDR_INDEX_TYPE __pdr_index[] PDR_INDEX_ATTRIBUTES;
 #define PDR_TOTAL_SIZE 343
 #define PDR_NUMBER_OF_RECORDS 11
 #define PDR_MAX_RECORD_SIZE 96
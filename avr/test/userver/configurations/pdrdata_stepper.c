@@ -93,7 +93,35 @@ PDR_BYTE_TYPE __pdr_data[] PDR_DATA_ATTRIBUTES = {
    0x01, 0x05, 0x00, 0x40, 0x9c, 0x3d, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6f, 0x12, 
    0x83, 0x39, 0x6f, 0x12, 0x83, 0x39, 0xff, 0xff, 0xff, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 
    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00
+   0x00, 0x00, 0x00, 0x00, 
+   // State Sensor Status
+   0x14, 0x00, 0x00, 0x00, 0x01, 0x04, 0x01, 0x00, 0x21, 0x00, 0x01, 0x00, 0x0a, 0x00, 0x00, 0x60, 
+   0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x60, 0x00, 0x01, 0x03, 0x00, 0x80, 0x01, 0x03, 0x01, 
+   0x80, 0x01, 0x7f, 0x43, 0x00, 0x01, 0x03, 0x43, 0x00, 0x01, 0x03
+};
+
+PDR_INDEX_TYPE __pdr_index[] PDR_INDEX_ATTRIBUTES = { 
+   // offset, size, crc8
+   {   0,  19, 0x61},   // Terminus Locator PDR
+   {  19,  20, 0xdd},   // FRU Record Set
+   {  39,  26, 0xcb},   // Entity Association
+   {  65,  42, 0x92},   // OEM Entity ID
+   { 107, 106, 0x8d},   // OEM State Set
+   { 213, 184, 0x31},   // OEM State Set
+   { 397,  72, 0xc6},   // OEM State Set
+   { 469,  29, 0x25},   // State Effecter GlobalInterlockEffecter
+   { 498,  27, 0x2c},   // State Sensor GlobalInterlockSensor
+   { 525,  29, 0x37},   // State Effecter TriggerEffecter
+   { 554,  27, 0xd6},   // State Sensor TriggerSensor
+   { 581, 105, 0x05},   // Numeric Sensor Position
+   { 686,  27, 0x26},   // State Sensor PositiveLimit
+   { 713,  27, 0xd1},   // State Sensor NegativeLimit
+   { 740,  29, 0x9a},   // State Effecter Command
+   { 769,  27, 0x5a},   // State Sensor motionState
+   { 796,  84, 0x6c},   // Numeric Effecter Pfinal
+   { 880,  84, 0x8e},   // Numeric Effecter Vprofile
+   { 964,  84, 0x74},   // Numeric Effecter Aprofile
+   {1048,  43, 0x8a}    // State Sensor Status
 };
 
 FRU_BYTE_TYPE __fru_data[] FRU_DATA_ATTRIBUTES = {
@@ -39,12 +39,23 @@ extern "C" {
 typedef signed long FIXEDPOINT_24_8;
 
 #define PDR_BYTE_TYPE const unsigned char
+#define PDR_INDEX_TYPE const PdrIndexEntry
 #define FRU_BYTE_TYPE const unsigned char
 #define LINTABLE_TYPE const long
 #define PDR_DATA_ATTRIBUTES PROGMEM
+#define PDR_INDEX_ATTRIBUTES PROGMEM
 #define FRU_DATA_ATTRIBUTES PROGMEM
 #define LINTABLE_DATA_ATTRIBUTES PROGMEM
 
+// one entry per pdr record, in repository order.  Offset is the byte
+// offset of the record within __pdr_data, size is the total record size
+// (including the common header) and crc8 is the crc of the whole record.
+typedef struct {
+    unsigned int  offset;
+    unsigned int  size;
+    unsigned char crc8;
+} PdrIndexEntry;
+
 //extern PDR_BYTE_TYPE __pdr_data[] PDR_DATA_ATTRIBUTES;
 //extern unsigned int __pdr_total_size;
 //extern unsigned int __pdr_number_of_records;
@@ -62,9 +73,10 @@ typedef signed long FIXEDPOINT_24_8;
 //====================
 // PDR-Related Macros
 extern PDR_BYTE_TYPE __pdr_data[] PDR_DATA_ATTRIBUTES;
-#define PDR_TOTAL_SIZE 858
-#define PDR_NUMBER_OF_RECORDS 19
-#define PDR_MAX_RECORD_SIZE 174
+extern PDR_INDEX_TYPE __pdr_index[] PDR_INDEX_ATTRIBUTES;
+#define PDR_TOTAL_SIZE 1091
+#define PDR_NUMBER_OF_RECORDS 20
+#define PDR_MAX_RECORD_SIZE 184
 
 //====================
 // FRU-Related Macros
@@ -153,6 +165,9 @@ extern LINTABLE_TYPE __lintable_step_dir_out1[] LINTABLE_DATA_ATTRIBUTES;
 #define ENTITY_STEPPER1_MOTIONSTATE
 #define ENTITY_STEPPER1_MOTIONSTATE_BINDINGTYPE_STATESENSOR
 #define ENTITY_STEPPER1_MOTIONSTATE_SENSORID 3
+#define ENTITY_STEPPER1_STATUS
+#define ENTITY_STEPPER1_STATUS_BINDINGTYPE_STATESENSOR
+#define ENTITY_STEPPER1_STATUS_SENSORID 10
 #define ENTITY_STEPPER1_PFINAL
 #define ENTITY_STEPPER1_PFINAL_BINDINGTYPE_NUMERICEFFECTER
 #define ENTITY_STEPPER1_PFINAL_EFFECTERID 4
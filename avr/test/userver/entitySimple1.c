@@ -41,6 +41,7 @@
     #include "channels.h"
     #include "adc.h"
     #include "node.h"
+    #include "telemetry.h"
     #include "vprofiler.h"
     #include "stepdir_out.h"
     #include "interpolator.h"
@@ -73,28 +74,31 @@
     // Sensor-Specific Code
     //===============================================================
     static StateSensorInstance globalInterlockSensorInst; 
-    static void globalInterlockSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+    static char globalInterlockSensor_queueEvent()
     {
-        node_sendStateSensorEvent(rxHeader, more, &(globalInterlockSensorInst.eventGen),
+        return node_queueStateSensorEvent(&(globalInterlockSensorInst.eventGen),
             ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID,
+            statesensor_getEventState(&globalInterlockSensorInst),
             statesensor_getSensorPreviousState(&globalInterlockSensorInst));
     }
 
     static StateSensorInstance triggerSensorInst; 
-    static void triggerSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+    static char triggerSensor_queueEvent()
     {
-        node_sendStateSensorEvent(rxHeader, more, &(triggerSensorInst.eventGen),
+        return node_queueStateSensorEvent(&(triggerSensorInst.eventGen),
             ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID,
+            statesensor_getEventState(&triggerSensorInst),
             statesensor_getSensorPreviousState(&triggerSensorInst));
     }
 
     // numeric sensor
     #ifdef ENTITY_SIMPLE1_SENSOR1
         static NumericSensorInstance sensor1SensorInst;
-        static void sensor1Sensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+        static char sensor1Sensor_queueEvent()
         {
-            node_sendNumericSensorEvent(rxHeader, more, &(sensor1SensorInst.eventGen),
+            return node_queueNumericSensorEvent(&(sensor1SensorInst.eventGen),
                 ENTITY_SIMPLE1_SENSOR1_SENSORID,
+                numericsensor_getEventState(&sensor1SensorInst),
                 numericsensor_getSensorPreviousState(&sensor1SensorInst),
                 sensor1SensorInst.value
             );
@@ -104,10 +108,11 @@
     // state sensor
     #ifdef ENTITY_SIMPLE1_SENSOR2
         static StateSensorInstance sensor2SensorInst; 
-        static void sensor2Sensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+        static char sensor2Sensor_queueEvent()
         {
-            node_sendStateSensorEvent(rxHeader, more, &(sensor2SensorInst.eventGen),
+            return node_queueStateSensorEvent(&(sensor2SensorInst.eventGen),
                 ENTITY_SIMPLE1_SENSOR2_SENSORID,
+                statesensor_getEventState(&sensor2SensorInst),
                 statesensor_getSensorPreviousState(&sensor2SensorInst)
             );
         } 
@@ -154,110 +159,21 @@
     }
 
     //===============================================================
-    // entitySimple1_UpdateEvents()
-    //
-    // this function updates the event state for each sensor that is
-    // not currently in the "SENT" state.
-    void entitySimple1_updateEvents(char *fifoInsertId) {
-        if (!eventgenerator_isEventSent(&(globalInterlockSensorInst.eventGen))) {
-            eventgenerator_updateEventStateMachine(&(globalInterlockSensorInst.eventGen));
-            if (eventgenerator_isEventPending(&(globalInterlockSensorInst.eventGen)) && 
-               (globalInterlockSensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                globalInterlockSensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        }
-        
-        if (!eventgenerator_isEventSent(&(triggerSensorInst.eventGen))) {
-            eventgenerator_updateEventStateMachine(&(triggerSensorInst.eventGen));
-            if (eventgenerator_isEventPending(&(triggerSensorInst.eventGen)) && 
-               (triggerSensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                triggerSensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        }
-        
-        #ifdef ENTITY_SIMPLE1_SENSOR1_BOUNDCHANNEL
-            if (!eventgenerator_isEventSent(&(sensor1SensorInst.eventGen))) {
-                eventgenerator_updateEventStateMachine(&(sensor1SensorInst.eventGen));
-            }
-            if (eventgenerator_isEventPending(&(sensor1SensorInst.eventGen)) && 
-               (sensor1SensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                sensor1SensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        #endif
-
-        #ifdef ENTITY_SIMPLE1_SENSOR2_BOUNDCHANNEL
-            if (!eventgenerator_isEventSent(&(sensor2SensorInst.eventGen))) {
-                eventgenerator_updateEventStateMachine(&(sensor2SensorInst.eventGen));
-            }
-            if (eventgenerator_isEventPending(&(sensor2SensorInst.eventGen)) && 
-               (sensor2SensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                sensor2SensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        #endif
-    }
-
-    //===============================================================
-    // entitySimple1_acknowledgeEvent()
+    // entitySimple1_updateEvents()
     //
-    // this function acknowledges the event for each sensor that is
-    // currently in the "SENT" state.
-    void entitySimple1_acknowledgeEvent() {
-        if (eventgenerator_isEventSent(&(globalInterlockSensorInst.eventGen))) {
-            eventgenerator_acknowledge(&(globalInterlockSensorInst.eventGen));
-        }
-        
-        if (eventgenerator_isEventSent(&(triggerSensorInst.eventGen))) {
-            eventgenerator_acknowledge(&(triggerSensorInst.eventGen));
-        }
-        
-        #ifdef ENTITY_SIMPLE1_SENSOR1_BOUNDCHANNEL
-            if (eventgenerator_isEventSent(&(sensor1SensorInst.eventGen))) {
-                eventgenerator_acknowledge(&(sensor1SensorInst.eventGen));
-            }
-        #endif
-
-        #ifdef ENTITY_SIMPLE1_SENSOR2_BOUNDCHANNEL
-            if (eventgenerator_isEventSent(&(sensor2SensorInst.eventGen))) {
-                eventgenerator_acknowledge(&(sensor2SensorInst.eventGen));
-            }
-        #endif
-    }
+    // this function updates the event state machine for each sensor.
+    // Events are placed in the node's event queue as they occur and
+    // are acknowledged by the node when the manager has received them.
+    void entitySimple1_updateEvents() {
+        eventgenerator_updateEventStateMachine(&(globalInterlockSensorInst.eventGen));
+        eventgenerator_updateEventStateMachine(&(triggerSensorInst.eventGen));
 
-    //===============================================================
-    // entitySimple1_respondToPollEvent()
-    //
-    // this function responds to a poll event request by sending the 
-    // event response from the proper sensor.
-    void entitySimple1_respondToPollEvent(PldmRequestHeader *rxHeader, char fifoInsertId, char fifoExtractId) {
-        unsigned char moreEvents = 1;
-        if (((fifoExtractId+1)&0x0f)==fifoInsertId) moreEvents = 0;
-        
-        if (globalInterlockSensorInst.eventGen.priority==fifoExtractId) {
-            eventgenerator_startSending(&(globalInterlockSensorInst.eventGen),rxHeader,moreEvents);
-        }
-        
-        if (triggerSensorInst.eventGen.priority==fifoExtractId) {
-            eventgenerator_startSending(&(triggerSensorInst.eventGen),rxHeader,moreEvents);
-        }
-        
         #ifdef ENTITY_SIMPLE1_SENSOR1_BOUNDCHANNEL
-            if (sensor1SensorInst.eventGen.priority==fifoExtractId) {
-                eventgenerator_startSending(&(sensor1SensorInst.eventGen),rxHeader,moreEvents);
-            }
+            eventgenerator_updateEventStateMachine(&(sensor1SensorInst.eventGen));
         #endif
 
         #ifdef ENTITY_SIMPLE1_SENSOR2_BOUNDCHANNEL
-            if (sensor1SensorInst.eventGen.priority==fifoExtractId) {
-                eventgenerator_startSending(&(sensor2SensorInst.eventGen),rxHeader,moreEvents);
-            }
+            eventgenerator_updateEventStateMachine(&(sensor2SensorInst.eventGen));
         #endif
     }
 
@@ -280,13 +196,13 @@
         statesensor_init(&globalInterlockSensorInst);
         globalInterlockSensorInst.stateWhenHigh = ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_STATEWHENHIGH;
         globalInterlockSensorInst.stateWhenLow = ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_STATEWHENLOW;
-        globalInterlockSensorInst.eventGen.sendEvent = globalInterlockSensor_sendEvent;
+        globalInterlockSensorInst.eventGen.queueEvent = globalInterlockSensor_queueEvent;
  
         // initialize the triggerSensor
         statesensor_init(&triggerSensorInst);
         triggerSensorInst.stateWhenHigh = ENTITY_SIMPLE1_TRIGGERSENSOR_STATEWHENHIGH;
         triggerSensorInst.stateWhenLow = ENTITY_SIMPLE1_TRIGGERSENSOR_STATEWHENLOW;
-        triggerSensorInst.eventGen.sendEvent = triggerSensor_sendEvent;
+        triggerSensorInst.eventGen.queueEvent = triggerSensor_queueEvent;
 
         // numeric sensor
         #ifdef ENTITY_SIMPLE1_SENSOR1 
@@ -299,7 +215,7 @@
                 ENTITY_SIMPLE1_SENSOR1_LOWERTHRESHOLDWARNING,
                 ENTITY_SIMPLE1_SENSOR1_LOWERTHRESHOLDCRITICAL,
                 ENTITY_SIMPLE1_SENSOR1_LOWERTHRESHOLDFATAL);
-            sensor1SensorInst.eventGen.sendEvent = sensor1Sensor_sendEvent;
+            sensor1SensorInst.eventGen.queueEvent = sensor1Sensor_queueEvent;
         #endif
 
         // state sensor
@@ -307,7 +223,7 @@
             statesensor_init(&sensor2SensorInst);
             sensor2SensorInst.stateWhenHigh = ENTITY_SIMPLE1_SENSOR2_STATEWHENHIGH;
             sensor2SensorInst.stateWhenLow  = ENTITY_SIMPLE1_SENSOR2_STATEWHENLOW;
-            sensor2SensorInst.eventGen.sendEvent = sensor2Sensor_sendEvent;
+            sensor2SensorInst.eventGen.queueEvent = sensor2Sensor_queueEvent;
         #endif
 
         // initialize the global interlock effecter
@@ -348,64 +264,91 @@
     }
 
     //*******************************************************************
-    // setStateEfffecterStates()
+    // getStateEffecters()
     //
-    // set the value of a numeric state effecter if it exists.
+    // look up the state effecter instances that make up the given
+    // effecter id, one per composite state in PDR order.
     //
     // parameters:
-    //    rxHeader - a pointer to the request header
+    //    effecter_id - the PLDM effecter id
+    //    effecters - receives up to STATEEFFECTER_MAX_COMPOSITE instances
     // returns:
-    //    void
-    // changes:
-    //    the contents of the transmit buffer
-    unsigned char entitySimple1_setStateEffecterStates(PldmRequestHeader* rxHeader) {
-        // extract the information from the body
-        unsigned int  effecter_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
-        unsigned char effecter_count = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2);
-
-        // if the user is trying to set more than one state, return with an error
-        if (effecter_count != 1) return RESPONSE_INVALID_STATE_VALUE; 
-
-        unsigned char action = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2 + 1);
-        unsigned char req_state = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2 + 1 + 1);
-        unsigned char response = RESPONSE_SUCCESS;
-
+    //    the composite effecter count, or 0 if there is no such effecter
+    static unsigned char getStateEffecters(unsigned int effecter_id, StateEffecterInstance **effecters) {
         switch (effecter_id) {
         #ifdef ENTITY_SIMPLE1_TRIGGEREFFECTER_EFFECTERID
             case ENTITY_SIMPLE1_TRIGGEREFFECTER_EFFECTERID:
-                // only try to update the state if action is requestSet
-                if (action) {
-                    if (!stateeffecter_setPresentState(&triggerEffecterInst,req_state)) { 
-                        response = RESPONSE_UNSUPPORTED_EFFECTERSTATE;
-                    }
-                }
-                break;
+                effecters[0] = &triggerEffecterInst;
+                return 1;
         #endif
         #ifdef ENTITY_SIMPLE1_GLOBALINTERLOCKEFFECTER_EFFECTERID
             case ENTITY_SIMPLE1_GLOBALINTERLOCKEFFECTER_EFFECTERID:
-                // only try to update the state if action is requestSet
-                if (action) {
-                    if (!stateeffecter_setPresentState(&globalInterlockEffecterInst,req_state)) { 
-                        response = RESPONSE_UNSUPPORTED_EFFECTERSTATE;
-                    }
-                }
-                break;
+                effecters[0] = &globalInterlockEffecterInst;
+                return 1;
         #endif
         #ifdef ENTITY_SIMPLE1_EFFECTER2_EFFECTERID
-        case ENTITY_SIMPLE1_EFFECTER2_EFFECTERID:
-            // only try to update the state if action is requestSet
-            if (action) {
-                if (!stateeffecter_setPresentState(&effecter2EffecterInst,req_state)) { 
-                    response = RESPONSE_UNSUPPORTED_EFFECTERSTATE;
-                }
-            }
-            break;
+            case ENTITY_SIMPLE1_EFFECTER2_EFFECTERID:
+                effecters[0] = &effecter2EffecterInst;
+                return 1;
         #endif
         default:
-            response = RESPONSE_INVALID_EFFECTER_ID; 
-            break;
+            return 0;
         }
-        return response;
+    }
+
+    //*******************************************************************
+    // getStateSensors()
+    //
+    // look up the state sensor instances that make up the given sensor
+    // id, one per composite state in PDR order.
+    //
+    // parameters:
+    //    sensor_id - the PLDM sensor id
+    //    sensors - receives up to STATESENSOR_MAX_COMPOSITE instances
+    // returns:
+    //    the composite sensor count, or 0 if there is no such sensor
+    static unsigned char getStateSensors(unsigned int sensor_id, StateSensorInstance **sensors) {
+        switch (sensor_id) {
+        #ifdef ENTITY_SIMPLE1_SENSOR2_SENSORID
+            case ENTITY_SIMPLE1_SENSOR2_SENSORID:
+                sensors[0] = &sensor2SensorInst;
+                return 1;
+        #endif
+        #ifdef ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID
+            case ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID:
+                sensors[0] = &triggerSensorInst;
+                return 1;
+        #endif
+        #ifdef ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID
+            case ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID:
+                sensors[0] = &globalInterlockSensorInst;
+                return 1;
+        #endif
+        default:
+            return 0;
+        }
+    }
+
+    //*******************************************************************
+    // setStateEfffecterStates()
+    //
+    // set the states of a (possibly composite) state effecter if it
+    // exists.  The caller has already checked that the request holds
+    // a field for each composite state being set.
+    //
+    // parameters:
+    //    rxHeader - a pointer to the request header
+    // returns:
+    //    the PLDM completion code
+    unsigned char entitySimple1_setStateEffecterStates(PldmRequestHeader* rxHeader) {
+        // extract the information from the body
+        unsigned int  effecter_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
+        StateEffecterInstance *effecters[STATEEFFECTER_MAX_COMPOSITE];
+
+        unsigned char count = getStateEffecters(effecter_id, effecters);
+        if (!count) return RESPONSE_INVALID_EFFECTER_ID;
+        return stateeffecter_setCompositeStates(effecters, count,
+            ((unsigned char*)rxHeader)+sizeof(PldmRequestHeader)+2);
     } 
 
     //*******************************************************************
@@ -474,40 +417,15 @@
     unsigned char entitySimple1_getStateSensorReading(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
         // extract the information from the body
         unsigned int  sensor_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
+        unsigned char rearm = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2);
+        StateSensorInstance *sensors[STATESENSOR_MAX_COMPOSITE];
 
-        // set a few default values
-        unsigned char response = RESPONSE_SUCCESS; 
-        responseBody[0] = 1;    // the number of sensor states
-        *size = 4;              // the size of the body (not including the response code)
-
-        switch (sensor_id) {
-        #ifdef ENTITY_SIMPLE1_SENSOR2_SENSORID
-            case ENTITY_SIMPLE1_SENSOR2_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&sensor2SensorInst);   
-                responseBody[2] = statesensor_getPresentState(&sensor2SensorInst);
-                responseBody[3] = statesensor_getPresentState(&sensor2SensorInst);
-                break;
-        #endif
-        #ifdef ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID
-            case ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&triggerSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&triggerSensorInst);
-                responseBody[3] = statesensor_getPresentState(&triggerSensorInst);
-                break;
-        #endif
-        #ifdef ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID
-            case ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&globalInterlockSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&globalInterlockSensorInst);
-                responseBody[3] = statesensor_getPresentState(&globalInterlockSensorInst);
-                break;
-        #endif
-        default:
-            response = RESPONSE_INVALID_EFFECTER_ID; 
+        unsigned char count = getStateSensors(sensor_id, sensors);
+        if (!count) {
             *size = 0;
-            break;
+            return RESPONSE_INVALID_SENSOR_ID;
         }
-        return response;
+        return statesensor_getCompositeReadings(sensors, count, rearm, responseBody, size);
     } 
 
     //*******************************************************************
@@ -570,40 +488,14 @@
     unsigned char entitySimple1_getStateEffecterStates(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
         // extract the information from the body
         unsigned int  effecter_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
+        StateEffecterInstance *effecters[STATEEFFECTER_MAX_COMPOSITE];
 
-        // set a few default values;
-        unsigned char response = RESPONSE_SUCCESS;
-        *size = 4;              // size of the body (not including the response code)
-        responseBody[0] = 1;    
-
-        switch (effecter_id) {
-        #ifdef ENTITY_SIMPLE1_EFFECTER2_EFFECTERID
-            case ENTITY_SIMPLE1_EFFECTER2_EFFECTERID:
-                responseBody[1] = stateeffecter_getOperationalState(&effecter2EffecterInst);   
-                responseBody[2] = stateeffecter_getPresentState(&effecter2EffecterInst);
-                responseBody[3] = stateeffecter_getPresentState(&effecter2EffecterInst);
-                break;
-        #endif
-        #ifdef ENTITY_SIMPLE1_TRIGGEREFFECTER_EFFECTERID
-            case ENTITY_SIMPLE1_TRIGGEREFFECTER_EFFECTERID:
-                responseBody[1] = stateeffecter_getOperationalState(&triggerEffecterInst);   
-                responseBody[2] = stateeffecter_getPresentState(&triggerEffecterInst);
-                responseBody[3] = stateeffecter_getPresentState(&triggerEffecterInst);
-                break;
-        #endif
-        #ifdef ENTITY_SIMPLE1_GLOBALINTERLOCKEFFECTER_EFFECTERID
-            case ENTITY_SIMPLE1_GLOBALINTERLOCKEFFECTER_EFFECTERID:
-                responseBody[1] = stateeffecter_getOperationalState(&globalInterlockEffecterInst);   
-                responseBody[2] = stateeffecter_getPresentState(&globalInterlockEffecterInst);
-                responseBody[3] = stateeffecter_getPresentState(&globalInterlockEffecterInst);
-                break;
-        #endif
-        default:
-            response = RESPONSE_INVALID_EFFECTER_ID;
-            *size = 0; 
-            break;
+        unsigned char count = getStateEffecters(effecter_id, effecters);
+        if (!count) {
+            *size = 0;
+            return RESPONSE_INVALID_EFFECTER_ID;
         }
-        return response;
+        return stateeffecter_getCompositeStates(effecters, count, responseBody, size);
     } 
 
     //*******************************************************************
@@ -789,6 +681,190 @@
         return response;
     } 
 
+    //*******************************************************************
+    // getNumericSensor()
+    //
+    // look up the instance of a numeric sensor.
+    //
+    // parameters:
+    //    sensor_id - the PLDM sensor id
+    // returns:
+    //    a pointer to the sensor instance, or 0 if there is no such sensor
+    static NumericSensorInstance *getNumericSensor(unsigned int sensor_id) {
+        switch (sensor_id) {
+        #ifdef ENTITY_SIMPLE1_SENSOR1_SENSORID
+            case ENTITY_SIMPLE1_SENSOR1_SENSORID:
+                return &sensor1SensorInst;
+        #endif
+        default:
+            return 0;
+        }
+    }
+
+    //*******************************************************************
+    // entitySimple1_setSensorStatistics()
+    //
+    // enable or disable the windowed statistics of a numeric sensor and
+    // set the window size (see numericsensor_setStatisticsWindow()).
+    //
+    // parameters:
+    //    rxHeader - a pointer to the request header
+    // returns:
+    //    the completion code for the response
+    unsigned char entitySimple1_setSensorStatistics(PldmRequestHeader* rxHeader) {
+        // extract the information from the body
+        unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+        unsigned int  sensor_id = *((unsigned int*)&body[0]);
+        unsigned char enable    = body[2];
+        unsigned int  window    = *((unsigned int*)&body[3]);
+
+        NumericSensorInstance *inst = getNumericSensor(sensor_id);
+        if (!inst) return RESPONSE_INVALID_SENSOR_ID;
+        if (enable > 1) return RESPONSE_ERROR_INVALID_DATA;
+        numericsensor_setStatisticsWindow(inst, enable, window);
+        return RESPONSE_SUCCESS;
+    }
+
+    //*******************************************************************
+    // entitySimple1_getSensorStatistics()
+    //
+    // return the windowed statistics of a numeric sensor, optionally
+    // resetting them (see numericsensor_writeStatistics()).
+    //
+    // parameters:
+    //    rxHeader - a pointer to the request header
+    //    responseBody - where to write the statistics
+    //    size - receives the size of the response body
+    // returns:
+    //    the completion code for the response
+    unsigned char entitySimple1_getSensorStatistics(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
+        // extract the information from the body
+        unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+        unsigned int  sensor_id = *((unsigned int*)&body[0]);
+        unsigned char reset     = body[2];
+
+        *size = 0;
+        NumericSensorInstance *inst = getNumericSensor(sensor_id);
+        if (!inst) return RESPONSE_INVALID_SENSOR_ID;
+        if (reset > 1) return RESPONSE_ERROR_INVALID_DATA;
+        *size = numericsensor_writeStatistics(inst, reset, responseBody);
+        return RESPONSE_SUCCESS;
+    }
+
+    //*******************************************************************
+    // entitySimple1_getTelemetrySource()
+    //
+    // look up the value that the control isr samples when the given
+    // sensor is streamed as telemetry.
+    //
+    // parameters:
+    //    sensorId - the PLDM sensor id
+    //    source - receives the location and size of the sensor value
+    // returns:
+    //    1 if the sensor exists, otherwise 0
+    unsigned char entitySimple1_getTelemetrySource(unsigned int sensorId, TelemetrySource *source) {
+        switch (sensorId) {
+        #ifdef ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID
+            case ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID:
+                source->value = &globalInterlockSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID
+            case ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID:
+                source->value = &triggerSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_SIMPLE1_SENSOR1_SENSORID
+            case ENTITY_SIMPLE1_SENSOR1_SENSORID:
+                source->value = &sensor1SensorInst.value;
+                source->size = 4;
+                return 1;
+        #endif
+        // the numeric sensor is streamed if both sensors share an id
+        #if defined(ENTITY_SIMPLE1_SENSOR2_SENSORID) && (ENTITY_SIMPLE1_SENSOR2_SENSORID != ENTITY_SIMPLE1_SENSOR1_SENSORID)
+            case ENTITY_SIMPLE1_SENSOR2_SENSORID:
+                source->value = &sensor2SensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        default:
+            return 0;
+        }
+    }
+
+    //*******************************************************************
+    // sensor snapshot
+    //
+    // a bulk snapshot is requested from the main loop by pointing
+    // snapshotBuffer at the response body.  The control isr fills the
+    // buffer at the end of its next cycle and then clears the pointer,
+    // so every reading in the snapshot comes from the same sample.
+    static unsigned char * volatile snapshotBuffer = 0;
+    static volatile unsigned char snapshotSize;
+
+    //*******************************************************************
+    // captureSnapshot()
+    //
+    // write the entry count and an entry for each enabled sensor into
+    // the snapshot buffer.  This is called from the control isr.
+    //
+    // parameters: none
+    // returns: nothing
+    static void captureSnapshot() {
+        unsigned char *buffer = snapshotBuffer;
+        unsigned char *entry = buffer + 1;
+
+        buffer[0] = 0;
+        if (statesensor_isEnabled(&globalInterlockSensorInst)) {
+            entry += statesensor_writeSnapshot(&globalInterlockSensorInst, ENTITY_SIMPLE1_GLOBALINTERLOCKSENSOR_SENSORID, entry);
+            buffer[0]++;
+        }
+        if (statesensor_isEnabled(&triggerSensorInst)) {
+            entry += statesensor_writeSnapshot(&triggerSensorInst, ENTITY_SIMPLE1_TRIGGERSENSOR_SENSORID, entry);
+            buffer[0]++;
+        }
+        #ifdef ENTITY_SIMPLE1_SENSOR1
+            if (numericsensor_isEnabled(&sensor1SensorInst)) {
+                entry += numericsensor_writeSnapshot(&sensor1SensorInst, ENTITY_SIMPLE1_SENSOR1_SENSORID, entry);
+                buffer[0]++;
+            }
+        #endif
+        #ifdef ENTITY_SIMPLE1_SENSOR2
+            if (statesensor_isEnabled(&sensor2SensorInst)) {
+                entry += statesensor_writeSnapshot(&sensor2SensorInst, ENTITY_SIMPLE1_SENSOR2_SENSORID, entry);
+                buffer[0]++;
+            }
+        #endif
+        snapshotSize = entry - buffer;
+    }
+
+    //*******************************************************************
+    // entitySimple1_getSensorSnapshot()
+    //
+    // capture a snapshot of every enabled sensor.  The capture is done by
+    // the control isr, so this waits (for at most one control cycle) for
+    // the isr to fill in the buffer.  If interrupts are disabled the
+    // snapshot is captured directly.
+    //
+    // parameters:
+    //    responseBody - the buffer for the snapshot (SENSOR_SNAPSHOT_MAX_SIZE bytes)
+    //    size - receives the size of the snapshot
+    // returns:
+    //    the PLDM completion code
+    unsigned char entitySimple1_getSensorSnapshot(unsigned char *responseBody, unsigned char *size) {
+        snapshotBuffer = responseBody;
+        if (SREG & (1<<SREG_I)) {
+            while (snapshotBuffer);
+        } else {
+            captureSnapshot();
+            snapshotBuffer = 0;
+        }
+        *size = snapshotSize;
+        return RESPONSE_SUCCESS;
+    }
+
 //**********************************************************************************************
 //**********************************************************************************************
 // CODE BELOW THIS POINT IS ON THE HIGH-PRIORITY LOOP - it needs to be optimized for speed
@@ -820,6 +896,12 @@ void entitySimple1_updateControl() {
     
     // read new values for all the sensors
     entitySimple1_readChannels();
+
+    // capture a sensor snapshot if the main loop has asked for one
+    if (snapshotBuffer) {
+        captureSnapshot();
+        snapshotBuffer = 0;
+    }
 }
 #pragma GCC pop_options
 
@@ -26,13 +26,12 @@
 //
 #pragma once
 #include "pldm.h"
+#include "telemetry.h"
 
  void entitySimple1_init();
  void entitySimple1_readChannels();
  void entitySimple1_writeChannels();
- void entitySimple1_updateEvents(char *eventFifoInsertId);
- void entitySimple1_acknowledgeEvent(char fifoId);
- void entitySimple1_respondToPollEvent(PldmRequestHeader *rxHeader, char fifoInsertId, char fifoExtractId);
+ void entitySimple1_updateEvents();
 
  unsigned char entitySimple1_setStateEffecterStates(PldmRequestHeader* rxHeader);
  unsigned char entitySimple1_setStateEffecterEnables(PldmRequestHeader* rxHeader);
@@ -43,6 +42,10 @@
 
  unsigned char entitySimple1_getSensorReading(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
  unsigned char entitySimple1_setNumericSensorEnable(PldmRequestHeader* rxHeader);
+ unsigned char entitySimple1_getSensorSnapshot(unsigned char *responseBody, unsigned char *size);
+ unsigned char entitySimple1_setSensorStatistics(PldmRequestHeader* rxHeader);
+ unsigned char entitySimple1_getSensorStatistics(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
+ unsigned char entitySimple1_getTelemetrySource(unsigned int sensorId, TelemetrySource *source);
 
  unsigned char entitySimple1_setNumericEffecterValue(PldmRequestHeader* rxHeader);
  unsigned char entitySimple1_getNumericEffecterValue(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
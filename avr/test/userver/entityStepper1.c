@@ -40,6 +40,7 @@
     #include "NumericEffecter.h"
     #include "channels.h"
     #include "node.h"
+    #include "telemetry.h"
     #include "vprofiler.h"
     #include "stepdir_out.h"
 
@@ -81,6 +82,14 @@
     #define SWITCH_STATE_PRESSED_ON   0x01
     #define SWITCH_STATE_RELEASED_OFF 0x02
 
+    // ids of the control loop values that may be streamed or captured
+    // along with the sensors.  These are outside the range of the pdr
+    // sensor ids.  The velocity is a fixed point value with 16 fractional
+    // bits.
+    #define ENTITY_STEPPER1_VELOCITY_CHANNELID 0xFF00
+    #define ENTITY_STEPPER1_STATE_CHANNELID    0xFF01
+    #define ENTITY_STEPPER1_FLAGS_CHANNELID    0xFF02
+
     unsigned char servo_cmd   = MOTOR_CMD_NONE;
     unsigned char servo_mode  = MOTOR_MODE_NOWAIT;
     unsigned char servo_flags = 0x00;
@@ -92,8 +101,7 @@
     //FP16 requested_kffa;
     static char mode_scurve    = 0;
     static unsigned char state = STATE_IDLE;
-    static int deltax_t0           = 0;  // the position steps that will be made this frame
-    static int deltax_t1           = 0;  // the position steps that were made last frame;
+    static int deltax_t0           = 0;  // the position steps that were made last frame
 
     static FP16 vel = TO_FP16(0);
 
@@ -101,45 +109,50 @@
     // Sensor-Specific Code
     //===============================================================
     static StateSensorInstance globalInterlockSensorInst; 
-    static void globalInterlockSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+    static char globalInterlockSensor_queueEvent()
     {
-        node_sendStateSensorEvent(rxHeader,more,&(globalInterlockSensorInst.eventGen),
+        return node_queueStateSensorEvent(&(globalInterlockSensorInst.eventGen),
             ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID,
+            statesensor_getEventState(&globalInterlockSensorInst),
             statesensor_getSensorPreviousState(&globalInterlockSensorInst));
     }
 
     static StateSensorInstance triggerSensorInst; 
-    static void triggerSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+    static char triggerSensor_queueEvent()
     {
-        node_sendStateSensorEvent(rxHeader,more,&(triggerSensorInst.eventGen),
+        return node_queueStateSensorEvent(&(triggerSensorInst.eventGen),
             ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID,
+            statesensor_getEventState(&triggerSensorInst),
             statesensor_getSensorPreviousState(&triggerSensorInst));
     }
 
     static StateSensorInstance motionStateSensorInst; 
-    static void motionStateSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+    static char motionStateSensor_queueEvent()
     {
-        node_sendStateSensorEvent(rxHeader,more,&(motionStateSensorInst.eventGen),
+        return node_queueStateSensorEvent(&(motionStateSensorInst.eventGen),
             ENTITY_STEPPER1_MOTIONSTATE_SENSORID,
+            statesensor_getEventState(&motionStateSensorInst),
             statesensor_getSensorPreviousState(&motionStateSensorInst));
     }
 
     #ifdef ENTITY_STEPPER1_POSITIVELIMIT
         static StateSensorInstance positiveLimitSensorInst; 
-        static void positiveLimitSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+        static char positiveLimitSensor_queueEvent()
         {
-            node_sendStateSensorEvent(rxHeader,more,&(positiveLimitSensorInst.eventGen),
+            return node_queueStateSensorEvent(&(positiveLimitSensorInst.eventGen),
                 ENTITY_STEPPER1_POSITIVELIMIT_SENSORID,
+                statesensor_getEventState(&positiveLimitSensorInst),
                 statesensor_getSensorPreviousState(&positiveLimitSensorInst));
         }
     #endif
 
     #ifdef ENTITY_STEPPER1_NEGATIVELIMIT
         static StateSensorInstance negativeLimitSensorInst; 
-        static void negativeLimitSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+        static char negativeLimitSensor_queueEvent()
         {
-            node_sendStateSensorEvent(rxHeader,more,&(negativeLimitSensorInst.eventGen),
+            return node_queueStateSensorEvent(&(negativeLimitSensorInst.eventGen),
                 ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID,
+                statesensor_getEventState(&negativeLimitSensorInst),
                 statesensor_getSensorPreviousState(&negativeLimitSensorInst)
             );
         } 
@@ -147,10 +160,11 @@
 
     #ifdef ENTITY_STEPPER1_POSITION
         static NumericSensorInstance positionSensorInst;
-        static void positionSensor_sendEvent(PldmRequestHeader *rxHeader, unsigned char more)
+        static char positionSensor_queueEvent()
         {
-            node_sendNumericSensorEvent(rxHeader,more,&(positionSensorInst.eventGen),
+            return node_queueNumericSensorEvent(&(positionSensorInst.eventGen),
                 ENTITY_STEPPER1_POSITION_SENSORID,
+                numericsensor_getEventState(&positionSensorInst),
                 numericsensor_getSensorPreviousState(&positionSensorInst),
                 positionSensorInst.value
             );
@@ -191,30 +205,30 @@
         statesensor_init(&globalInterlockSensorInst);
         globalInterlockSensorInst.stateWhenHigh = ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_STATEWHENHIGH;
         globalInterlockSensorInst.stateWhenLow = ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_STATEWHENLOW;
-        globalInterlockSensorInst.eventGen.sendEvent = globalInterlockSensor_sendEvent;
+        globalInterlockSensorInst.eventGen.queueEvent = globalInterlockSensor_queueEvent;
  
         // initialize the triggerSensor
         statesensor_init(&triggerSensorInst);
         triggerSensorInst.stateWhenHigh = ENTITY_STEPPER1_TRIGGERSENSOR_STATEWHENHIGH;
         triggerSensorInst.stateWhenLow = ENTITY_STEPPER1_TRIGGERSENSOR_STATEWHENLOW;
-        triggerSensorInst.eventGen.sendEvent = triggerSensor_sendEvent;
+        triggerSensorInst.eventGen.queueEvent = triggerSensor_queueEvent;
 
         // initialize the motionStateSensor
         statesensor_init(&motionStateSensorInst);
-        motionStateSensorInst.eventGen.sendEvent = motionStateSensor_sendEvent;
+        motionStateSensorInst.eventGen.queueEvent = motionStateSensor_queueEvent;
 
         #ifdef ENTITY_STEPPER1_POSITIVELIMIT
             statesensor_init(&positiveLimitSensorInst);
             positiveLimitSensorInst.stateWhenHigh = ENTITY_STEPPER1_POSITIVELIMIT_STATEWHENHIGH;
             positiveLimitSensorInst.stateWhenLow  = ENTITY_STEPPER1_POSITIVELIMIT_STATEWHENLOW;
-            positiveLimitSensorInst.eventGen.sendEvent = positiveLimitSensor_sendEvent;
+            positiveLimitSensorInst.eventGen.queueEvent = positiveLimitSensor_queueEvent;
         #endif
 
         #ifdef ENTITY_STEPPER1_NEGATIVELIMIT
             statesensor_init(&negativeLimitSensorInst);
             negativeLimitSensorInst.stateWhenHigh = ENTITY_STEPPER1_NEGATIVELIMIT_STATEWHENHIGH;
             negativeLimitSensorInst.stateWhenLow  = ENTITY_STEPPER1_NEGATIVELIMIT_STATEWHENLOW;
-            negativeLimitSensorInst.eventGen.sendEvent = negativeLimitSensor_sendEvent;
+            negativeLimitSensorInst.eventGen.queueEvent = negativeLimitSensor_queueEvent;
         #endif
 
         // initialize the global interlock effecter
@@ -269,7 +283,7 @@
                 ENTITY_STEPPER1_POSITION_LOWERTHRESHOLDWARNING,
                 ENTITY_STEPPER1_POSITION_LOWERTHRESHOLDCRITICAL,
                 ENTITY_STEPPER1_POSITION_LOWERTHRESHOLDFATAL);
-            positionSensorInst.eventGen.sendEvent = positionSensor_sendEvent;
+            positionSensorInst.eventGen.queueEvent = positionSensor_queueEvent;
         #endif 
 
         // initialize the output effecter
@@ -340,214 +354,148 @@
             // read the position sensor's channel
             CALL_CHANNEL_FUNCTION(ENTITY_STEPPER1_POSITION_BOUNDCHANNEL,_sample);
         #else
-            positionSensorInst.value += deltax_t1;
+            numericsensor_setValue(&positionSensorInst, positionSensorInst.value + deltax_t0);
         #endif
     }
 
     //===============================================================
     // entityStepper1_updateEvents()
     //
-    // this function updates the event state for each sensor that is
-    // not currently in the "SENT" state.
-    void entityStepper1_updateEvents(char *fifoInsertId) {
-        if (!eventgenerator_isEventSent(&(globalInterlockSensorInst.eventGen))) {
-            eventgenerator_updateEventStateMachine(&(globalInterlockSensorInst.eventGen));
-            if (eventgenerator_isEventPending(&(globalInterlockSensorInst.eventGen)) && 
-               (globalInterlockSensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                globalInterlockSensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        }
-        
-        if (!eventgenerator_isEventSent(&(triggerSensorInst.eventGen))) {
-            eventgenerator_updateEventStateMachine(&(triggerSensorInst.eventGen));
-            if (eventgenerator_isEventPending(&(triggerSensorInst.eventGen)) && 
-               (triggerSensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                triggerSensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        }
-        
+    // this function updates the event state machine for each sensor.
+    // Events are placed in the node's event queue as they occur and
+    // are acknowledged by the node when the manager has received them.
+    void entityStepper1_updateEvents() {
+        eventgenerator_updateEventStateMachine(&(globalInterlockSensorInst.eventGen));
+        eventgenerator_updateEventStateMachine(&(triggerSensorInst.eventGen));
+
         #ifdef ENTITY_STEPPER1_POSITIVELIMIT_BOUNDCHANNEL
-            if (!eventgenerator_isEventSent(&(positiveLimitSensorInst.eventGen))) {
-                eventgenerator_updateEventStateMachine(&(positiveLimitSensorInst.eventGen));
-                if (eventgenerator_isEventPending(&(positiveLimitSensorInst.eventGen)) && 
-                (positiveLimitSensorInst.eventGen.priority < 0)) {
-                    // this event has not yet been placed in the fifo
-                    positiveLimitSensorInst.eventGen.priority = *fifoInsertId;
-                    *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-                }
-            }
+            eventgenerator_updateEventStateMachine(&(positiveLimitSensorInst.eventGen));
         #endif
 
         #ifdef ENTITY_STEPPER1_NEGATIVELIMIT_BOUNDCHANNEL
-            if (!eventgenerator_isEventSent(&(negativeLimitSensorInst.eventGen))) {
-                eventgenerator_updateEventStateMachine(&(negativeLimitSensorInst.eventGen));
-                if (eventgenerator_isEventPending(&(negativeLimitSensorInst.eventGen)) && 
-                (negativeLimitSensorInst.eventGen.priority < 0)) {
-                    // this event has not yet been placed in the fifo
-                    negativeLimitSensorInst.eventGen.priority = *fifoInsertId;
-                    *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-                }
-            }
+            eventgenerator_updateEventStateMachine(&(negativeLimitSensorInst.eventGen));
         #endif
 
-        if (!eventgenerator_isEventSent(&(motionStateSensorInst.eventGen))) {
-            eventgenerator_updateEventStateMachine(&(motionStateSensorInst.eventGen));
-            if (eventgenerator_isEventPending(&(motionStateSensorInst.eventGen)) && 
-            (motionStateSensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                motionStateSensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        }
-
-        if (!eventgenerator_isEventSent(&(positionSensorInst.eventGen))) {
-            eventgenerator_updateEventStateMachine(&(positionSensorInst.eventGen));
-            if (eventgenerator_isEventPending(&(positionSensorInst.eventGen)) && 
-            (positionSensorInst.eventGen.priority < 0)) {
-                // this event has not yet been placed in the fifo
-                positionSensorInst.eventGen.priority = *fifoInsertId;
-                *fifoInsertId = ((*fifoInsertId)+1)&0xF;
-            }
-        }
+        eventgenerator_updateEventStateMachine(&(motionStateSensorInst.eventGen));
+        eventgenerator_updateEventStateMachine(&(positionSensorInst.eventGen));
     }
 
-    //===============================================================
-    // entityStepper1_acknowledgeEvent()
+
+    //*******************************************************************
+    // getStateEffecters()
     //
-    // this function acknowledges the event for each sensor that is
-    // currently in the "SENT" state.
-    void entityStepper1_acknowledgeEvent() {
-        if (eventgenerator_isEventSent(&(globalInterlockSensorInst.eventGen))) {
-            eventgenerator_acknowledge(&(globalInterlockSensorInst.eventGen));
-        }
-        
-        if (eventgenerator_isEventSent(&(triggerSensorInst.eventGen))) {
-            eventgenerator_acknowledge(&(triggerSensorInst.eventGen));
-        }
-        
-       #ifdef ENTITY_STEPPER1_POSITIVELIMIT_BOUNDCHANNEL
-            if (eventgenerator_isEventSent(&(positiveLimitSensorInst.eventGen))) {
-                eventgenerator_acknowledge(&(positiveLimitSensorInst.eventGen));
-            }
+    // look up the state effecter instances that make up the given
+    // effecter id, one per composite state in PDR order.
+    //
+    // parameters:
+    //    effecter_id - the PLDM effecter id
+    //    effecters - receives up to STATEEFFECTER_MAX_COMPOSITE instances
+    // returns:
+    //    the composite effecter count, or 0 if there is no such effecter
+    static unsigned char getStateEffecters(unsigned int effecter_id, StateEffecterInstance **effecters) {
+        switch (effecter_id) {
+        #ifdef ENTITY_STEPPER1_COMMAND_EFFECTERID
+            case ENTITY_STEPPER1_COMMAND_EFFECTERID:
+                effecters[0] = &commandEffecterInst;
+                return 1;
         #endif
-
-        #ifdef ENTITY_STEPPER1_NEGATIVELIMIT_BOUNDCHANNEL
-            if (eventgenerator_isEventSent(&(negativeLimitSensorInst.eventGen))) {
-                eventgenerator_acknowledge(&(negativeLimitSensorInst.eventGen));
-            }
+        #ifdef ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID
+            case ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID:
+                effecters[0] = &triggerEffecterInst;
+                return 1;
         #endif
-
-        if (eventgenerator_isEventSent(&(motionStateSensorInst.eventGen))) {
-            eventgenerator_acknowledge(&(motionStateSensorInst.eventGen));
-        }
-
-        if (eventgenerator_isEventSent(&(positionSensorInst.eventGen))) {
-            eventgenerator_acknowledge(&(positionSensorInst.eventGen));
+        #ifdef ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID
+            case ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID:
+                effecters[0] = &globalInterlockEffecterInst;
+                return 1;
+        #endif
+        default:
+            return 0;
         }
     }
 
-    //===============================================================
-    // entityStepper1_respondToPollEvent()
+    //*******************************************************************
+    // getStateSensors()
     //
-    // this function responds to a poll event request by sending the 
-    // event response from the proper sensor.
-    void entityStepper1_respondToPollEvent(PldmRequestHeader *rxHeader, char fifoInsertId, char fifoExtractId) {
-        unsigned char moreEvents = 1;
-        if (((fifoExtractId+1)&0x0f)==fifoInsertId) moreEvents = 0;
-        
-        if (globalInterlockSensorInst.eventGen.priority==fifoExtractId) {
-            eventgenerator_startSending(&(globalInterlockSensorInst.eventGen),rxHeader,moreEvents);
-        }
-        
-        if (triggerSensorInst.eventGen.priority==fifoExtractId) {
-            eventgenerator_startSending(&(triggerSensorInst.eventGen),rxHeader,moreEvents);
-        }
-        
-        #ifdef ENTITY_STEPPER1_POSITIVELIMIT_BOUNDCHANNEL
-            if (positiveLimitSensorInst.eventGen.priority==fifoExtractId) {
-                eventgenerator_startSending(&(positiveLimitSensorInst.eventGen),rxHeader,moreEvents);
-            }
+    // look up the state sensor instances that make up the given sensor
+    // id, one per composite state in PDR order.  The status sensor is a
+    // composite of the interlock, trigger, motion state and limit
+    // sensors so that the whole stepper status can be polled at once.
+    //
+    // parameters:
+    //    sensor_id - the PLDM sensor id
+    //    sensors - receives up to STATESENSOR_MAX_COMPOSITE instances
+    // returns:
+    //    the composite sensor count, or 0 if there is no such sensor
+    static unsigned char getStateSensors(unsigned int sensor_id, StateSensorInstance **sensors) {
+        switch (sensor_id) {
+        #ifdef ENTITY_STEPPER1_MOTIONSTATE_SENSORID
+            case ENTITY_STEPPER1_MOTIONSTATE_SENSORID:
+                sensors[0] = &motionStateSensorInst;
+                return 1;
         #endif
-
-        #ifdef ENTITY_STEPPER1_NEGATIVELIMIT_BOUNDCHANNEL
-            if (negativeLimitSensorInst.eventGen.priority==fifoExtractId) {
-                eventgenerator_startSending(&(negativeLimitSensorInst.eventGen),rxHeader,moreEvents);
+        #ifdef ENTITY_STEPPER1_POSITIVELIMIT_SENSORID
+            case ENTITY_STEPPER1_POSITIVELIMIT_SENSORID:
+                sensors[0] = &positiveLimitSensorInst;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID
+            case ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID:
+                sensors[0] = &negativeLimitSensorInst;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID
+            case ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID:
+                sensors[0] = &triggerSensorInst;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID
+            case ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID:
+                sensors[0] = &globalInterlockSensorInst;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_STATUS_SENSORID
+            case ENTITY_STEPPER1_STATUS_SENSORID:
+            {
+                // the order here must match the state sets in the status pdr
+                unsigned char count = 0;
+                sensors[count++] = &globalInterlockSensorInst;
+                sensors[count++] = &triggerSensorInst;
+                sensors[count++] = &motionStateSensorInst;
+                #ifdef ENTITY_STEPPER1_POSITIVELIMIT
+                    sensors[count++] = &positiveLimitSensorInst;
+                #endif
+                #ifdef ENTITY_STEPPER1_NEGATIVELIMIT
+                    sensors[count++] = &negativeLimitSensorInst;
+                #endif
+                return count;
             }
         #endif
-
-        if (motionStateSensorInst.eventGen.priority==fifoExtractId) {
-            eventgenerator_startSending(&(motionStateSensorInst.eventGen),rxHeader,moreEvents);
-        }
-
-        if (positionSensorInst.eventGen.priority==fifoExtractId) {
-            eventgenerator_startSending(&(positionSensorInst.eventGen),rxHeader,moreEvents);
+        default:
+            return 0;
         }
     }
 
-
     //*******************************************************************
     // setStateEfffecterStates()
     //
-    // set the value of a numeric state effecter if it exists.
+    // set the states of a (possibly composite) state effecter if it
+    // exists.  The caller has already checked that the request holds
+    // a field for each composite state being set.
     //
     // parameters:
     //    rxHeader - a pointer to the request header
     // returns:
-    //    void
-    // changes:
-    //    the contents of the transmit buffer
+    //    the PLDM completion code
     unsigned char entityStepper1_setStateEffecterStates(PldmRequestHeader* rxHeader) {
         // extract the information from the body
         unsigned int  effecter_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
-        unsigned char effecter_count = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2);
-
-        // if the user is trying to set more than one state, return with an error
-        if (effecter_count != 1) return RESPONSE_INVALID_STATE_VALUE; 
+        StateEffecterInstance *effecters[STATEEFFECTER_MAX_COMPOSITE];
 
-
-        unsigned char action = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2 + 1);
-        unsigned char req_state = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2 + 1 + 1);
-        unsigned char response = RESPONSE_SUCCESS;
-        switch (effecter_id) {
-        #ifdef ENTITY_STEPPER1_COMMAND_EFFECTERID
-        case ENTITY_STEPPER1_COMMAND_EFFECTERID:
-            // only try to update the state if action is requestSet
-            if (action) {
-                if (!stateeffecter_setPresentState(&commandEffecterInst,req_state)) { 
-                    response = RESPONSE_UNSUPPORTED_EFFECTERSTATE;
-                }
-            }
-            break;
-        #endif
-        #ifdef ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID
-            case ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID:
-                // only try to update the state if action is requestSet
-                if (action) {
-                    if (!stateeffecter_setPresentState(&triggerEffecterInst,req_state)) { 
-                        response = RESPONSE_UNSUPPORTED_EFFECTERSTATE;
-                    }
-                }
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID
-            case ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID:
-                // only try to update the state if action is requestSet
-                if (action) {
-                    if (!stateeffecter_setPresentState(&globalInterlockEffecterInst,req_state)) { 
-                        response = RESPONSE_UNSUPPORTED_EFFECTERSTATE;
-                    }
-                }
-                break;
-        #endif
-        default:
-            response = RESPONSE_INVALID_EFFECTER_ID; 
-            break;
-        }
-        return response;
+        unsigned char count = getStateEffecters(effecter_id, effecters);
+        if (!count) return RESPONSE_INVALID_EFFECTER_ID;
+        return stateeffecter_setCompositeStates(effecters, count,
+            ((unsigned char*)rxHeader)+sizeof(PldmRequestHeader)+2);
     } 
 
     //*******************************************************************
@@ -616,54 +564,15 @@
     unsigned char entityStepper1_getStateSensorReading(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
         // extract the information from the body
         unsigned int  sensor_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
+        unsigned char rearm = *(((char*)rxHeader)+sizeof(PldmRequestHeader)+2);
+        StateSensorInstance *sensors[STATESENSOR_MAX_COMPOSITE];
 
-        // set a few default values
-        unsigned char response = RESPONSE_SUCCESS; 
-        responseBody[0] = 1;    // the number of sensor states
-        *size = 4;              // the size of the body (not including the response code)
-
-        switch (sensor_id) {
-        #ifdef ENTITY_STEPPER1_MOTIONSTATE_SENSORID
-            case ENTITY_STEPPER1_MOTIONSTATE_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&motionStateSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&motionStateSensorInst);
-                responseBody[3] = statesensor_getPresentState(&motionStateSensorInst);
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_POSITIVELIMIT_SENSORID
-            case ENTITY_STEPPER1_POSITIVELIMIT_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&positiveLimitSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&positiveLimitSensorInst);
-                responseBody[3] = statesensor_getPresentState(&positiveLimitSensorInst);
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID
-            case ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&negativeLimitSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&negativeLimitSensorInst);
-                responseBody[3] = statesensor_getPresentState(&negativeLimitSensorInst);
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID
-            case ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&triggerSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&triggerSensorInst);
-                responseBody[3] = statesensor_getPresentState(&triggerSensorInst);
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID
-            case ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID:
-                responseBody[1] = statesensor_getOperationalState(&globalInterlockSensorInst);   
-                responseBody[2] = statesensor_getPresentState(&globalInterlockSensorInst);
-                responseBody[3] = statesensor_getPresentState(&globalInterlockSensorInst);
-                break;
-        #endif
-        default:
-            response = RESPONSE_INVALID_EFFECTER_ID; 
+        unsigned char count = getStateSensors(sensor_id, sensors);
+        if (!count) {
             *size = 0;
-            break;
+            return RESPONSE_INVALID_SENSOR_ID;
         }
-        return response;
+        return statesensor_getCompositeReadings(sensors, count, rearm, responseBody, size);
     } 
 
     //*******************************************************************
@@ -736,40 +645,14 @@
     unsigned char entityStepper1_getStateEffecterStates(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
         // extract the information from the body
         unsigned int  effecter_id  = *((int*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
+        StateEffecterInstance *effecters[STATEEFFECTER_MAX_COMPOSITE];
 
-        // set a few default values;
-        unsigned char response = RESPONSE_SUCCESS;
-        *size = 4;              // size of the body (not including the response code)
-        responseBody[0] = 1;    
-
-        switch (effecter_id) {
-        #ifdef ENTITY_STEPPER1_COMMAND_EFFECTERID
-            case ENTITY_STEPPER1_COMMAND_EFFECTERID:
-                responseBody[1] = stateeffecter_getOperationalState(&commandEffecterInst);   
-                responseBody[2] = stateeffecter_getPresentState(&commandEffecterInst);
-                responseBody[3] = stateeffecter_getPresentState(&commandEffecterInst);
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID
-            case ENTITY_STEPPER1_TRIGGEREFFECTER_EFFECTERID:
-                responseBody[1] = stateeffecter_getOperationalState(&triggerEffecterInst);   
-                responseBody[2] = stateeffecter_getPresentState(&triggerEffecterInst);
-                responseBody[3] = stateeffecter_getPresentState(&triggerEffecterInst);
-                break;
-        #endif
-        #ifdef ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID
-            case ENTITY_STEPPER1_GLOBALINTERLOCKEFFECTER_EFFECTERID:
-                responseBody[1] = stateeffecter_getOperationalState(&globalInterlockEffecterInst);   
-                responseBody[2] = stateeffecter_getPresentState(&globalInterlockEffecterInst);
-                responseBody[3] = stateeffecter_getPresentState(&globalInterlockEffecterInst);
-                break;
-        #endif
-        default:
-            response = RESPONSE_INVALID_EFFECTER_ID;
-            *size = 0; 
-            break;
+        unsigned char count = getStateEffecters(effecter_id, effecters);
+        if (!count) {
+            *size = 0;
+            return RESPONSE_INVALID_EFFECTER_ID;
         }
-        return response;
+        return stateeffecter_getCompositeStates(effecters, count, responseBody, size);
     } 
 
     //*******************************************************************
@@ -1007,6 +890,264 @@
     } 
 
 
+    //*******************************************************************
+    // getNumericSensor()
+    //
+    // look up the instance of a numeric sensor.
+    //
+    // parameters:
+    //    sensor_id - the PLDM sensor id
+    // returns:
+    //    a pointer to the sensor instance, or 0 if there is no such sensor
+    static NumericSensorInstance *getNumericSensor(unsigned int sensor_id) {
+        switch (sensor_id) {
+        #ifdef ENTITY_STEPPER1_POSITION_SENSORID
+            case ENTITY_STEPPER1_POSITION_SENSORID:
+                return &positionSensorInst;
+        #endif
+        default:
+            return 0;
+        }
+    }
+
+    //*******************************************************************
+    // entityStepper1_setSensorStatistics()
+    //
+    // enable or disable the windowed statistics of a numeric sensor and
+    // set the window size (see numericsensor_setStatisticsWindow()).
+    //
+    // parameters:
+    //    rxHeader - a pointer to the request header
+    // returns:
+    //    the completion code for the response
+    unsigned char entityStepper1_setSensorStatistics(PldmRequestHeader* rxHeader) {
+        // extract the information from the body
+        unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+        unsigned int  sensor_id = *((unsigned int*)&body[0]);
+        unsigned char enable    = body[2];
+        unsigned int  window    = *((unsigned int*)&body[3]);
+
+        NumericSensorInstance *inst = getNumericSensor(sensor_id);
+        if (!inst) return RESPONSE_INVALID_SENSOR_ID;
+        if (enable > 1) return RESPONSE_ERROR_INVALID_DATA;
+        numericsensor_setStatisticsWindow(inst, enable, window);
+        return RESPONSE_SUCCESS;
+    }
+
+    //*******************************************************************
+    // entityStepper1_getSensorStatistics()
+    //
+    // return the windowed statistics of a numeric sensor, optionally
+    // resetting them (see numericsensor_writeStatistics()).
+    //
+    // parameters:
+    //    rxHeader - a pointer to the request header
+    //    responseBody - where to write the statistics
+    //    size - receives the size of the response body
+    // returns:
+    //    the completion code for the response
+    unsigned char entityStepper1_getSensorStatistics(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
+        // extract the information from the body
+        unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+        unsigned int  sensor_id = *((unsigned int*)&body[0]);
+        unsigned char reset     = body[2];
+
+        *size = 0;
+        NumericSensorInstance *inst = getNumericSensor(sensor_id);
+        if (!inst) return RESPONSE_INVALID_SENSOR_ID;
+        if (reset > 1) return RESPONSE_ERROR_INVALID_DATA;
+        *size = numericsensor_writeStatistics(inst, reset, responseBody);
+        return RESPONSE_SUCCESS;
+    }
+
+    //*******************************************************************
+    // entityStepper1_queueMove()
+    //
+    // add a move to the queued path.  The request holds the final
+    // position, the plateau velocity and the acceleration (both 15.16
+    // fixed point).  Positions are relative to the end of the queued path,
+    // or to the present position when no path is queued or running.  The
+    // path is followed when the Command effecter is set to run (or wait).
+    //
+    // parameters:
+    //    rxHeader - a pointer to the request header
+    //    responseBody - receives the number of free queue entries
+    //    size - receives the size of the response body
+    // returns:
+    //    the completion code for the response
+    unsigned char entityStepper1_queueMove(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size) {
+        static long queueEndPosition = 0;
+
+        // extract the information from the body
+        unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+        long position     = *((long*)&body[0]);
+        FP16 velocity     = *((long*)&body[4]);
+        FP16 acceleration = *((long*)&body[8]);
+
+        *size = 0;
+        if ((velocity <= 0) || (acceleration <= 0)) return RESPONSE_ERROR_INVALID_DATA;
+        if ((!vprofiler_isQueueActive()) && (!vprofiler_getQueueCount())) {
+            queueEndPosition = positionSensorInst.value;
+        }
+        if (!vprofiler_queueMove(position - queueEndPosition, velocity, acceleration)) {
+            return RESPONSE_ERROR_NOT_READY;
+        }
+        queueEndPosition = position;
+
+        responseBody[0] = VPROFILER_QUEUE_SIZE - vprofiler_getQueueCount();
+        *size = 1;
+        return RESPONSE_SUCCESS;
+    }
+
+    //*******************************************************************
+    // entityStepper1_getTelemetrySource()
+    //
+    // look up the value that the control isr samples when the given
+    // sensor is streamed as telemetry or captured.  The internal control
+    // loop values (velocity, motion state and flags) may also be
+    // selected using their channel ids.
+    //
+    // parameters:
+    //    sensorId - the PLDM sensor id or control loop channel id
+    //    source - receives the location and size of the sensor value
+    // returns:
+    //    1 if the sensor exists, otherwise 0
+    unsigned char entityStepper1_getTelemetrySource(unsigned int sensorId, TelemetrySource *source) {
+        switch (sensorId) {
+        #ifdef ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID
+            case ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID:
+                source->value = &globalInterlockSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID
+            case ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID:
+                source->value = &triggerSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_MOTIONSTATE_SENSORID
+            case ENTITY_STEPPER1_MOTIONSTATE_SENSORID:
+                source->value = &motionStateSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_POSITIVELIMIT_SENSORID
+            case ENTITY_STEPPER1_POSITIVELIMIT_SENSORID:
+                source->value = &positiveLimitSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID
+            case ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID:
+                source->value = &negativeLimitSensorInst.value;
+                source->size = 1;
+                return 1;
+        #endif
+        #ifdef ENTITY_STEPPER1_POSITION_SENSORID
+            case ENTITY_STEPPER1_POSITION_SENSORID:
+                source->value = &positionSensorInst.value;
+                source->size = 4;
+                return 1;
+        #endif
+        case ENTITY_STEPPER1_VELOCITY_CHANNELID:
+            source->value = &current_velocity;
+            source->size = 4;
+            return 1;
+        case ENTITY_STEPPER1_STATE_CHANNELID:
+            source->value = &state;
+            source->size = 1;
+            return 1;
+        case ENTITY_STEPPER1_FLAGS_CHANNELID:
+            source->value = &servo_flags;
+            source->size = 1;
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    //*******************************************************************
+    // sensor snapshot
+    //
+    // a bulk snapshot is requested from the main loop by pointing
+    // snapshotBuffer at the response body.  The control isr fills the
+    // buffer at the end of its next cycle and then clears the pointer,
+    // so every reading in the snapshot comes from the same sample.
+    static unsigned char * volatile snapshotBuffer = 0;
+    static volatile unsigned char snapshotSize;
+
+    //*******************************************************************
+    // captureSnapshot()
+    //
+    // write the entry count and an entry for each enabled sensor into
+    // the snapshot buffer.  This is called from the control isr.
+    //
+    // parameters: none
+    // returns: nothing
+    static void captureSnapshot() {
+        unsigned char *buffer = snapshotBuffer;
+        unsigned char *entry = buffer + 1;
+
+        buffer[0] = 0;
+        if (statesensor_isEnabled(&globalInterlockSensorInst)) {
+            entry += statesensor_writeSnapshot(&globalInterlockSensorInst, ENTITY_STEPPER1_GLOBALINTERLOCKSENSOR_SENSORID, entry);
+            buffer[0]++;
+        }
+        if (statesensor_isEnabled(&triggerSensorInst)) {
+            entry += statesensor_writeSnapshot(&triggerSensorInst, ENTITY_STEPPER1_TRIGGERSENSOR_SENSORID, entry);
+            buffer[0]++;
+        }
+        if (statesensor_isEnabled(&motionStateSensorInst)) {
+            entry += statesensor_writeSnapshot(&motionStateSensorInst, ENTITY_STEPPER1_MOTIONSTATE_SENSORID, entry);
+            buffer[0]++;
+        }
+        #ifdef ENTITY_STEPPER1_POSITIVELIMIT
+            if (statesensor_isEnabled(&positiveLimitSensorInst)) {
+                entry += statesensor_writeSnapshot(&positiveLimitSensorInst, ENTITY_STEPPER1_POSITIVELIMIT_SENSORID, entry);
+                buffer[0]++;
+            }
+        #endif
+        #ifdef ENTITY_STEPPER1_NEGATIVELIMIT
+            if (statesensor_isEnabled(&negativeLimitSensorInst)) {
+                entry += statesensor_writeSnapshot(&negativeLimitSensorInst, ENTITY_STEPPER1_NEGATIVELIMIT_SENSORID, entry);
+                buffer[0]++;
+            }
+        #endif
+        #ifdef ENTITY_STEPPER1_POSITION
+            if (numericsensor_isEnabled(&positionSensorInst)) {
+                entry += numericsensor_writeSnapshot(&positionSensorInst, ENTITY_STEPPER1_POSITION_SENSORID, entry);
+                buffer[0]++;
+            }
+        #endif
+        snapshotSize = entry - buffer;
+    }
+
+    //*******************************************************************
+    // entityStepper1_getSensorSnapshot()
+    //
+    // capture a snapshot of every enabled sensor.  The capture is done by
+    // the control isr, so this waits (for at most one control cycle) for
+    // the isr to fill in the buffer.  If interrupts are disabled the
+    // snapshot is captured directly.
+    //
+    // parameters:
+    //    responseBody - the buffer for the snapshot (SENSOR_SNAPSHOT_MAX_SIZE bytes)
+    //    size - receives the size of the snapshot
+    // returns:
+    //    the PLDM completion code
+    unsigned char entityStepper1_getSensorSnapshot(unsigned char *responseBody, unsigned char *size) {
+        snapshotBuffer = responseBody;
+        if (SREG & (1<<SREG_I)) {
+            while (snapshotBuffer);
+        } else {
+            captureSnapshot();
+            snapshotBuffer = 0;
+        }
+        *size = snapshotSize;
+        return RESPONSE_SUCCESS;
+    }
+
 
 /////////////////////////////////////////////////////////////////////////////
 // THIS IS WORK IN PROGRESS AND NEEDS TO BE CLEANED UP
@@ -1041,7 +1182,6 @@ void entityStepper1_updateControl() {
     else
         CALL_CHANNEL_FUNCTION(ENTITY_STEPPER1_TRIGGEREFFECTER_BOUNDCHANNEL,_disable());
     CALL_CHANNEL_FUNCTION(ENTITY_STEPPER1_TRIGGEREFFECTER_BOUNDCHANNEL,_setOutput(stateeffecter_getOutput(&triggerEffecterInst)));
-    deltax_t1 = deltax_t0; 
     deltax_t0 = step_dir_out1_setOutput(current_velocity);
     
     // read new values for all the sensors
@@ -1133,6 +1273,30 @@ void entityStepper1_updateControl() {
 
             state = STATE_ERROR;
         }
+        else if ((servo_cmd == MOTOR_CMD_RUN) && (vprofiler_getQueueCount())) {
+            // follow the queued path.  Each queued move carries its own
+            // velocity and acceleration so the profile effecters are not
+            // used.
+            servo_flags = 0;
+            vprofiler_startQueue();
+            if (servo_mode != MOTOR_MODE_NOWAIT) {
+                // transition to the waiting state
+                state = STATE_WAITING;
+            } else {
+                // disable the brake if it is set
+                #ifdef ENTITY_STEPPER1_BRAKEEFFECTER
+                    stateeffecter_setPresentState(&brakeEffecterInst, brakeEffecterInst.stateWhenLow);
+                #endif
+
+                // enable the motor if it is disabled
+                #ifdef ENTITY_STEPPER1_OUTPUTENABLE
+                    stateeffecter_setPresentState(&outputEnableEffecterInst, outputEnableEffecterInst.stateWhenHigh);
+                #endif
+
+                // transition to the running state
+                state = STATE_RUNNING;
+            }
+        }
         else if ((servo_cmd == MOTOR_CMD_RUN)&&(servo_mode != MOTOR_MODE_NOWAIT)) {
             // check to see if all the required effecters are enabled
             if (!numericeffecter_isEnabled(&vprofileEffecterInst)) break;
@@ -1151,6 +1315,15 @@ void entityStepper1_updateControl() {
                 if (current_velocity<0) servo_flags |= MOTOR_FLAGS_REVERSE;
                 vprofiler_setParameters(vprofileEffecterInst.value, vprofileEffecterInst.value, aprofileEffecterInst.value, mode_scurve);
             }
+
+            // plan the profile while waiting for the trigger so that the
+            // motion can begin as soon as the trigger is released
+            if (servo_flags & MOTOR_FLAGS_VMODE) {
+                vprofiler_startv();
+            } else {
+                vprofiler_start();
+            }
+
             // transition to the waiting state
             state = STATE_WAITING;
         }
@@ -1200,6 +1373,11 @@ void entityStepper1_updateControl() {
         // update the velocity profiler position - running is the only mode
         // in which this happens
         vprofiler_update();
+
+        // a queued path may change direction between moves
+        if (current_velocity<0) servo_flags |= MOTOR_FLAGS_REVERSE;
+        else if (current_velocity>0) servo_flags &= (~MOTOR_FLAGS_REVERSE);
+
         if (servo_flags & MOTOR_FLAGS_ERROR) {
             // perform actions for entry to error state
             // error condition has priority over any other state
@@ -1455,11 +1633,10 @@ void entityStepper1_updateControl() {
                 stateeffecter_setPresentState(&outputEnableEffecterInst, outputEnableEffecterInst.stateWhenHigh);
             #endif
 
+            // the profile was requested on entry to the waiting state
             if (servo_flags & MOTOR_FLAGS_VMODE) {
-                vprofiler_startv();
                 state = STATE_RUNNINGV;
             } else {    
-                vprofiler_start();
                 state = STATE_RUNNING;
             }
         }
@@ -1616,6 +1793,15 @@ void entityStepper1_updateControl() {
     }
     servo_cmd = MOTOR_CMD_NONE; 
     motionStateSensorInst.value = state&0xF;      
+
+    // abandon a queued path once the axis has left the running states
+    if ((state != STATE_RUNNING) && (state != STATE_WAITING)) vprofiler_stopQueue();
+
+    // capture a sensor snapshot if the main loop has asked for one
+    if (snapshotBuffer) {
+        captureSnapshot();
+        snapshotBuffer = 0;
+    }
 }
 
 #endif // ENTITY_STEPPER1
@@ -25,13 +25,12 @@
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 //
 #pragma once
+#include "telemetry.h"
 
  void entityStepper1_init();
  void entityStepper1_readChannels();
  void entityStepper1_writeChannels();
- void entityStepper1_updateEvents(char *eventFifoInsertId);
- void entityStepper1_acknowledgeEvent(char fifoId);
- void entityStepper1_respondToPollEvent(PldmRequestHeader *rxHeader, char fifoInsertId, char fifoExtractId);
+ void entityStepper1_updateEvents();
  
  unsigned char entityStepper1_setStateEffecterStates(PldmRequestHeader* rxHeader);
  unsigned char entityStepper1_setStateEffecterEnables(PldmRequestHeader* rxHeader);
@@ -42,6 +41,11 @@
 
  unsigned char entityStepper1_getSensorReading(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
  unsigned char entityStepper1_setNumericSensorEnable(PldmRequestHeader* rxHeader);
+ unsigned char entityStepper1_getSensorSnapshot(unsigned char *responseBody, unsigned char *size);
+ unsigned char entityStepper1_setSensorStatistics(PldmRequestHeader* rxHeader);
+ unsigned char entityStepper1_getSensorStatistics(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
+ unsigned char entityStepper1_queueMove(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
+ unsigned char entityStepper1_getTelemetrySource(unsigned int sensorId, TelemetrySource *source);
 
  unsigned char entityStepper1_setNumericEffecterValue(PldmRequestHeader* rxHeader);
  unsigned char entityStepper1_getNumericEffecterValue(PldmRequestHeader* rxHeader, unsigned char *responseBody, unsigned char *size);
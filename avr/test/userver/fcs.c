@@ -32,8 +32,18 @@
 
 #include "fcs.h"
 
+#if (FCS_IMPLEMENTATION == FCS_IMPL_SRAM_TABLE) || (FCS_IMPLEMENTATION == FCS_IMPL_FLASH_TABLE)
+#if FCS_IMPLEMENTATION == FCS_IMPL_FLASH_TABLE
+#include <avr/pgmspace.h>
+#define FCS_TABLE_ATTRIBUTES PROGMEM
+#define FCS_TABLE_READ(idx) pgm_read_word(&fcstab[idx])
+#else
+#define FCS_TABLE_ATTRIBUTES
+#define FCS_TABLE_READ(idx) fcstab[idx]
+#endif
+
 //frame check sequence table from RFC 1662
-static unsigned int fcstab[256] = {
+static const unsigned int fcstab[256] FCS_TABLE_ATTRIBUTES = {
    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
@@ -67,6 +77,28 @@ static unsigned int fcstab[256] = {
    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
 };
+#elif FCS_IMPLEMENTATION == FCS_IMPL_NIBBLE_TABLE
+#include <avr/pgmspace.h>
+
+//frame check sequence table for a single nibble (x^16 + x^12 + x^5 + 1,
+//bit reversed).  Each byte is processed as two 4-bit lookups.
+static const unsigned int fcstab_nibble[16] PROGMEM = {
+   0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+   0x8408, 0x9489, 0xa50a, 0xb58b, 0xc60c, 0xd68d, 0xe70e, 0xf78f
+};
+#else
+#error "unknown FCS_IMPLEMENTATION selected"
+#endif
+
+#if FCS_IMPLEMENTATION == FCS_IMPL_NIBBLE_TABLE
+#define FCS_STEP(fcs, ch) \
+	fcs ^= (ch); \
+	fcs = (fcs >> 4) ^ pgm_read_word(&fcstab_nibble[fcs & 0x0f]); \
+	fcs = (fcs >> 4) ^ pgm_read_word(&fcstab_nibble[fcs & 0x0f]);
+#else
+#define FCS_STEP(fcs, ch) \
+	fcs = 0xffff&((fcs >> 8) ^ FCS_TABLE_READ((fcs ^ (ch)) & 0xff));
+#endif
 
 //*******************************************************************
 // fcs_calcFcs()
@@ -82,7 +114,27 @@ static unsigned int fcstab[256] = {
 //    fcs - updated value for the frame check sequence
 unsigned int fcs_calcFcs(unsigned int fcs, unsigned char* cp, unsigned int len)
 {
-	while (len--)
-		fcs = 0xffff&((fcs >> 8) ^ fcstab[(fcs ^ *cp++) & 0xff]);
-	return (fcs);
+	while (len--) {
+		FCS_STEP(fcs, *cp++);
+	}
+	return (fcs & 0xffff);
+}
+
+//*******************************************************************
+// fcs_updateFcs()
+//
+// This function updates the frame check sequence with a single byte
+// and returns the updated value.  It is used by code that produces
+// frame data one byte at a time and would otherwise need to call
+// fcs_calcFcs() with a length of one.
+//
+// parameters:
+//	  fcs - the origninal value for the frame check sequence
+//   ch - the byte to add to the frame check sequence
+// returns:
+//    fcs - updated value for the frame check sequence
+unsigned int fcs_updateFcs(unsigned int fcs, unsigned char ch)
+{
+	FCS_STEP(fcs, ch);
+	return (fcs & 0xffff);
 }
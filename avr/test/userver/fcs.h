@@ -30,10 +30,27 @@
 //
 #pragma once
 
+//FCS implementation selection.  Build with -DFCS_IMPLEMENTATION=<one of
+//the values below> to override the default.
+//   FCS_IMPL_SRAM_TABLE   - 256 entry table in SRAM.  Fastest, but uses
+//                           512 bytes of SRAM.
+//   FCS_IMPL_FLASH_TABLE  - the same table placed in program memory.  One
+//                           extra lpm per byte and no SRAM cost (default).
+//   FCS_IMPL_NIBBLE_TABLE - 16 entry table in program memory, two lookups
+//                           per byte.  Smallest flash footprint.
+#define FCS_IMPL_SRAM_TABLE   0
+#define FCS_IMPL_FLASH_TABLE  1
+#define FCS_IMPL_NIBBLE_TABLE 2
+
+#ifndef FCS_IMPLEMENTATION
+#define FCS_IMPLEMENTATION FCS_IMPL_FLASH_TABLE
+#endif
+
 //constant values used as checks by the FCS
 #define  INITFCS 0xffff
 #define  GOODFCS 0xf0b8
 
 //FCS value generator
 unsigned int fcs_calcFcs(unsigned int fcs, unsigned char* cp, unsigned int len);
+unsigned int fcs_updateFcs(unsigned int fcs, unsigned char ch);
 
@@ -0,0 +1,186 @@
+//    isrprofile.c
+//
+//    This file defines functions related to measuring the execution
+//    time of the interrupt service routines as part of the PICMG
+//    reference code for IoT.  Timer 0 runs free from the cpu clock and
+//    gives the time exactly modulo 256 clocks.  The frame timer (timer 2)
+//    gives it to within 32 clocks, so together they give the exact time
+//    for anything shorter than the frame counter can wrap.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__ 
+#define __AVR_ATmega328P__
+#endif
+
+#include <avr/io.h>
+#include "isrprofile.h"
+
+#ifdef ISR_PROFILE
+
+// the frame length in cpu clocks - timer 2 counts from 0 to OCR2A at
+// 32 clocks per count
+#define FRAME_CLOCKS ((((unsigned int)OCR2A)+1)<<5)
+
+// running statistics for one source - updated by the isrs
+typedef struct {
+    unsigned int  minimum;
+    unsigned int  maximum;
+    unsigned long total;
+    unsigned int  count;
+    unsigned int  overruns;
+} IsrProfileSource;
+
+static IsrProfileSource sources[ISRPROFILE_SOURCES];
+static unsigned char    frames;
+
+//*******************************************************************
+// takeStamp()
+//
+// record the current time.  If the frame timer has restarted but the
+// frame interrupt has not run yet, the new frame is counted here.  The
+// flag is checked again after a low count in case the timer restarted
+// while it was being read.
+//
+// parameters:
+//    now - the time stamp to fill in
+// returns: nothing
+static void takeStamp(IsrProfileStamp *now) {
+    now->clocks = TCNT0;
+    unsigned char pending = TIFR2 & (1<<OCF2A);
+    now->ticks = TCNT2;
+    if ((!pending) && (now->ticks < 64)) pending = TIFR2 & (1<<OCF2A);
+    now->frame = frames;
+    if (pending) now->frame++;
+}
+
+//*******************************************************************
+// isrprofile_init()
+//
+// start timer 0 running free from the cpu clock and clear the
+// statistics.  Timer 0 is not used for anything else.
+//
+// parameters: none
+// returns: nothing
+void isrprofile_init() {
+    // normal mode, outputs disconnected, no interrupts, prescaler of 1
+    TCCR0A = 0x00;
+    TCCR0B = 0x01;
+    TIMSK0 = 0x00;
+    isrprofile_clear();
+}
+
+//*******************************************************************
+// isrprofile_enter()
+//
+// mark the start of a measured source.  Called from the isrs through
+// ISRPROFILE_ENTER().
+//
+// parameters:
+//    source - the source being measured (ISRPROFILE_xxx)
+//    start - where to keep the start time until isrprofile_exit()
+// returns: nothing
+void isrprofile_enter(unsigned char source, IsrProfileStamp *start) {
+    if (source == ISRPROFILE_FRAME) frames++;
+    takeStamp(start);
+}
+
+//*******************************************************************
+// isrprofile_exit()
+//
+// mark the end of a measured source and add the time taken to its
+// statistics.  If the frame interrupt is pending on the way out, the
+// source either ran past the end of the frame or held off the frame
+// interrupt, and an overrun is counted.
+//
+// parameters:
+//    source - the source being measured (ISRPROFILE_xxx)
+//    start - the time recorded by isrprofile_enter()
+// returns: nothing
+void isrprofile_exit(unsigned char source, const IsrProfileStamp *start) {
+    IsrProfileStamp end;
+    takeStamp(&end);
+
+    // the frame timer gives the time taken to within 32 clocks.  Timer 0
+    // corrects it to the exact clock.
+    unsigned int coarse = (unsigned char)(end.frame - start->frame) * FRAME_CLOCKS + 
+        ((int)end.ticks - (int)start->ticks) * 32;
+    unsigned int elapsed = coarse + 
+        (signed char)((unsigned char)(end.clocks - start->clocks) - (unsigned char)coarse);
+
+    IsrProfileSource *s = &sources[source];
+    if (elapsed < s->minimum) s->minimum = elapsed;
+    if (elapsed > s->maximum) s->maximum = elapsed;
+    if (TIFR2 & (1<<OCF2A)) s->overruns++;
+
+    // once the count is full, halve the totals so that the mean keeps
+    // following recent behaviour
+    if (s->count == 0xFFFF) {
+        s->count >>= 1;
+        s->total >>= 1;
+    }
+    s->count++;
+    s->total += elapsed;
+}
+
+//*******************************************************************
+// isrprofile_getStats()
+//
+// read the statistics of every source.
+//
+// parameters:
+//    stats - an array of ISRPROFILE_SOURCES entries to fill in
+// returns: nothing
+void isrprofile_getStats(isrprofile_stats *stats) {
+    for (unsigned char i = 0; i < ISRPROFILE_SOURCES; i++) {
+        unsigned char sreg = SREG;
+        __builtin_avr_cli();
+        IsrProfileSource s = sources[i];
+        SREG = sreg;
+
+        stats[i].minimum = (s.count) ? s.minimum : 0;
+        stats[i].maximum = s.maximum;
+        stats[i].mean = (s.count) ? s.total / s.count : 0;
+        stats[i].count = s.count;
+        stats[i].overruns = s.overruns;
+    }
+}
+
+//*******************************************************************
+// isrprofile_clear()
+//
+// clear the statistics of every source.
+//
+// parameters: none
+// returns: nothing
+void isrprofile_clear() {
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+    for (unsigned char i = 0; i < ISRPROFILE_SOURCES; i++) {
+        sources[i].minimum = 0xFFFF;
+        sources[i].maximum = 0;
+        sources[i].total = 0;
+        sources[i].count = 0;
+        sources[i].overruns = 0;
+    }
+    SREG = sreg;
+}
+
+#endif
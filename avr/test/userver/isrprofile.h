@@ -0,0 +1,72 @@
+//    isrprofile.h
+//
+//    This header file declares functions related to measuring the
+//    execution time of the interrupt service routines as part of the
+//    PICMG reference code for IoT.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+// The instrumentation is only compiled in when the firmware is built
+// with -DISR_PROFILE.  Otherwise the ISRPROFILE_ENTER()/ISRPROFILE_EXIT()
+// markers are empty and timer 0 is left untouched.  Times are measured
+// in cpu clocks between the two markers, so they do not include the
+// register saves and restores that the compiler adds to each isr.
+
+// the measured sources
+#define ISRPROFILE_FRAME      0   // TIMER2_COMPA_vect - the whole control frame
+#define ISRPROFILE_CONTROL    1   // the entity *_updateControl() calls
+#define ISRPROFILE_SAMPLE     2   // telemetry and capture sampling (if built)
+#define ISRPROFILE_USART_RX   3   // USART_RX_vect
+#define ISRPROFILE_USART_UDRE 4   // USART_UDRE_vect
+#define ISRPROFILE_SOURCES    5
+
+// the statistics of one source.  These are sent as-is by the
+// GetIsrProfile command since the structure has no padding and the
+// fields are already little-endian.
+typedef struct {
+    unsigned int minimum;         // shortest time (cpu clocks)
+    unsigned int maximum;         // longest time (cpu clocks)
+    unsigned int mean;            // mean time (cpu clocks)
+    unsigned int count;           // number of times in the mean
+    unsigned int overruns;        // times the frame interrupt fell due while it ran
+} isrprofile_stats;
+
+#ifdef ISR_PROFILE
+// a point in time as seen by the profiler
+typedef struct {
+    unsigned char clocks;         // timer 0 count (cpu clocks modulo 256)
+    unsigned char ticks;          // timer 2 count (32 cpu clocks each)
+    unsigned char frame;          // control frames seen by the profiler
+} IsrProfileStamp;
+
+void isrprofile_init();
+void isrprofile_enter(unsigned char source, IsrProfileStamp *start);
+void isrprofile_exit(unsigned char source, const IsrProfileStamp *start);
+void isrprofile_getStats(isrprofile_stats *stats);
+void isrprofile_clear();
+
+#define ISRPROFILE_ENTER(source) IsrProfileStamp isrprofile_##source; isrprofile_enter(source, &isrprofile_##source)
+#define ISRPROFILE_EXIT(source)  isrprofile_exit(source, &isrprofile_##source)
+#else
+#define ISRPROFILE_ENTER(source)
+#define ISRPROFILE_EXIT(source)
+#endif
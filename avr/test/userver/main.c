@@ -29,6 +29,9 @@
 #include "uart.h"
 #include "mctp.h"
 #include "node.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "isrprofile.h"
 #include "vprofiler.h"
 #include "systemtimer.h"
 #include "channels.h"
@@ -39,7 +42,7 @@
 
 int main(void)
 {
-  unsigned char mctp_discovery_msg[] = {0,CMD_DISCOVERY_NOTIFY};
+  unsigned char mctp_discovery_msg[] = {0x80,CMD_DISCOVERY_NOTIFY};  // request
 
   // enable global interrupts
   SREG |= (1<<SREG_I);
@@ -50,12 +53,23 @@ int main(void)
   // initialize the global tick timer for 4000Khz rate timeout
   systemtimer_init();
 
+  // start measuring the isr execution times
+  #ifdef ISR_PROFILE
+    isrprofile_init();
+  #endif
+
   // initilaize the uart
   uart_init();
 
   // initialize mctp socket
   mctp_init();
   node_init();
+  #ifdef TELEMETRY
+    telemetry_init();
+  #endif
+  #ifdef CAPTURE
+    capture_init();
+  #endif
 
   // initialize all channels based on configuration paramters
   channels_init();
@@ -78,6 +92,9 @@ int main(void)
   delay_set(0,1000);
   //mctp_sendNoWait(1,mctp_discovery_msg,0);
   while (1) {
+    // calculate any motion profile requested by the control loop
+    vprofiler_plan();
+
     // if the discovery notify has timed out and no response has been received, 
     // send another discovery notify message
     if ((!mctp_context.discovered)&&(delay_isDone(0))) {
@@ -89,6 +106,11 @@ int main(void)
 
       // update sensor event states
       node_updateEvents();
+
+      // push any streamed sensor values
+      #ifdef TELEMETRY
+        telemetry_update();
+      #endif
     }
   }
   return 0;
@@ -38,10 +38,50 @@
 #include <string.h>
 #include <stdlib.h>
 #include "avr/io.h"
+#include <avr/pgmspace.h>
 
 // context for the MCTP Interface
 mctp_struct mctp_context;
 
+// transmit serializer phases
+#define TXPHASE_IDLE     0
+#define TXPHASE_HEADER   1
+#define TXPHASE_BODY     2
+#define TXPHASE_ESCAPE   3
+#define TXPHASE_FCS_MSB  4
+#define TXPHASE_FCS_LSB  5
+#define TXPHASE_ENDSYNC  6
+
+// transmit frame queue.  Frames are queued by the main loop and sent by
+// the uart transmit interrupt.  The head and tail are free-running
+// counters - head is only written by the main loop and tail is only
+// written by the interrupt.
+static mctp_txframe txFrames[MCTP_TX_FRAMES];
+static volatile unsigned char txFrameHead = 0;
+static volatile unsigned char txFrameTail = 0;
+
+// the tag of the last request originated by this endpoint.  Each new
+// request takes the next tag, with the tag owner bit set.
+static unsigned char txRequestTag = 0;
+
+// serializer state - only accessed from the uart transmit interrupt
+static unsigned char txPhase = TXPHASE_IDLE;
+static unsigned char txIdx;
+static unsigned char txSeq;
+static unsigned char txHeaderLength;
+static unsigned char txPacketRemaining;
+static unsigned int  txMessageRemaining;
+static unsigned char txSegment;
+static unsigned char txEscaped;
+static unsigned int  txRemaining;
+static unsigned int  txFcs;
+static const mctp_segment *txSeg;
+static const unsigned char *txPtr;
+static unsigned long txValue;
+
+static unsigned char mctp_txNextByte(unsigned char *ch);
+static void mctp_rxByte(unsigned char ch);
+
 //*******************************************************************
 // mctp_init()
 //
@@ -54,9 +94,18 @@ mctp_struct mctp_context;
 // returns:
 //    none
 void mctp_init(){
-	mctp_context.mctp_packet_ready=0;
+	mctp_context.rxHead = 0;
+	mctp_context.rxTail = 0;
+	memset(&mctp_context.stats, 0, sizeof(mctp_context.stats));
 	mctp_context.discovered = 0;
+	mctp_context.eid = MCTP_NULL_EID;
+	mctp_context.peerEid = MCTP_NULL_EID;
+	mctp_context.txTag = MCTP_TO;
 	mctp_context.last_msg_type = 0;
+	uart_setTxSource(mctp_txNextByte);
+#ifdef MCTP_RX_IN_ISR
+	uart_setRxSink(mctp_rxByte);
+#endif
 }
 
 //*******************************************************************
@@ -71,83 +120,229 @@ void mctp_init(){
 //    whether or not the packet was sent successfully
 unsigned char mctp_sendNoWait(unsigned int length, unsigned char* msg, unsigned char mctp_message_type){
 	// send packet
-	mctp_transmitFrameStart(length+5,mctp_message_type);
-	mctp_transmitFrameData(msg,length);
-	mctp_transmitFrameEnd();
-	return 1;
+	mctp_segment segment = MCTP_SEGMENT_RAM(msg, length);
+	return mctp_transmitFrame(mctp_message_type, &segment, 1);
 }
 
 //*******************************************************************
 // mctp_isPacketAvailable()
 //
 // This is a helper function that checks whether there is
-// a packet available in the buffer
+// a packet available in the receive pool.  Control messages are
+// handled by the mctp layer and are never reported.
 //
-// parameters:
-//	  vars - a data struct used for all mctp functions
 // returns:
 //    cbool - whether there is a packet available
-unsigned char  mctp_isPacketAvailable(mctp_struct* vars) {
-	return mctp_context.mctp_packet_ready;
+unsigned char  mctp_isPacketAvailable() {
+	if (mctp_context.rxHead == mctp_context.rxTail) return 0;
+	return mctp_context.rxPackets[mctp_context.rxTail & (MCTP_RX_PACKETS-1)].type != MCTP_TYPE_CONTROL;
 }
 
 //*******************************************************************
 // mctp_getPacket()
 //
-// returns a packet from the buffer
+// returns the oldest packet in the receive pool.  The packet remains
+// valid until mctp_releasePacket() is called.  Frames transmitted from
+// then on are responses addressed to the sender of the packet.
+//
+// returns:
+//    a pointer to the packet contents, or 0 if no packet is available
+unsigned char* mctp_getPacket() {
+	if (mctp_context.rxHead == mctp_context.rxTail) return 0;
+	mctp_packet *packet = &mctp_context.rxPackets[mctp_context.rxTail & (MCTP_RX_PACKETS-1)];
+	mctp_context.peerEid = packet->sourceEid;
+	mctp_context.txTag = packet->tag & MCTP_TAG_MASK;
+	return packet->data;
+}
+
+//*******************************************************************
+// mctp_getPacketSource()
+//
+// returns the endpoint ID of the sender of the oldest packet in the
+// receive pool.
+//
+// returns:
+//    the source endpoint ID, or MCTP_NULL_EID if no packet is available
+unsigned char mctp_getPacketSource() {
+	if (mctp_context.rxHead == mctp_context.rxTail) return MCTP_NULL_EID;
+	return mctp_context.rxPackets[mctp_context.rxTail & (MCTP_RX_PACKETS-1)].sourceEid;
+}
+
+//*******************************************************************
+// mctp_getPacketLength()
+//
+// returns the length of the oldest packet in the receive pool.
+//
+// returns:
+//    the number of valid bytes in the packet, or 0 if no packet is
+//    available
+unsigned char mctp_getPacketLength() {
+	if (mctp_context.rxHead == mctp_context.rxTail) return 0;
+	return mctp_context.rxPackets[mctp_context.rxTail & (MCTP_RX_PACKETS-1)].length;
+}
+
+//*******************************************************************
+// mctp_releasePacket()
+//
+// returns the oldest packet buffer to the receive pool so that the
+// framer may reuse it.  Frames transmitted from then on are sent as
+// new messages rather than responses.
+//
+// returns:
+//    void
+void mctp_releasePacket() {
+	if (mctp_context.rxHead != mctp_context.rxTail) mctp_context.rxTail++;
+	mctp_context.txTag = MCTP_TO;
+}
+
+//*******************************************************************
+// transmitControlResponse()
+//
+// This is a helper function that sends a response to a control message
+// request.
 //
 // parameters:
-//	  vars - a data struct used for all mctp functions
+//    request - the request message body
+//    code - the completion code for the response
+//    body - the response data following the completion code
+//    size - the size of the response data in bytes
 // returns:
-//    rxBuffer - the buffer's contents, usually a MCTP packet
-unsigned char* mctp_getPacket(mctp_struct* vars) {
-	mctp_context.mctp_packet_ready = 0;
-	return mctp_context.rxBuffer;
+//    void
+static void transmitControlResponse(unsigned char *request, unsigned char code, const unsigned char *body, unsigned char size)
+{
+	unsigned char hdr[] = { request[0] & 0x7f, request[1], code };
+	mctp_segment segments[] = {
+		MCTP_SEGMENT_RAM(hdr, sizeof(hdr)),
+		MCTP_SEGMENT_RAM(body, size)
+	};
+	mctp_transmitFrame(MCTP_TYPE_CONTROL, segments, 2);
 }
 
 //*******************************************************************
 // mctp_processControlMessage()
 //
 // This is a helper function that processess any MCTP control messages
-// that are received.
-static void mctp_processControlMessage(mctp_struct* vars)
+// that are received.  Requests are answered; of the responses, only the
+// one to a discovery notify is of interest.
+//
+// parameters:
+//    packet - the received control message
+// returns:
+//    void
+static void mctp_processControlMessage(mctp_packet *packet)
 {
-	switch (mctp_context.rxBuffer[1]) {
+	unsigned char *msg = packet->data;
+
+	if (packet->length < 2) return;
+
+	// discovery notify is only sent by an endpoint, so whatever comes
+	// back from the bus owner means this endpoint has been discovered
+	if (msg[1] == CMD_DISCOVERY_NOTIFY) {
+		mctp_context.discovered = 1;
+		return;
+	}
+
+	// no response is needed to a response
+	if (!(msg[0] & 0x80)) return;
+
+	switch (msg[1]) {
 		case CMD_SET_ENDPOINT_ID:
+		{
+			// eid status (accepted, no pool), eid setting, eid pool size
+			unsigned char body[] = { 0x00, mctp_context.eid, 0x00 };
+			if (packet->length < 4) {
+				transmitControlResponse(msg, MCTP_CC_ERROR_INVALID_LENGTH, 0, 0);
+				break;
+			}
+			switch (msg[2] & 0x03) {
+				case 0:   // set eid
+				case 1:   // force eid
+					// the framer never escapes the header, so an eid that
+					// looks like a sync or escape character cannot be used
+					if ((msg[3] <= MCTP_RESERVED_EID_LAST) || (msg[3] == MCTP_BROADCAST_EID) ||
+						(msg[3] == SYNC_CHAR) || (msg[3] == ESCAPE_CHAR)) {
+						transmitControlResponse(msg, MCTP_CC_ERROR_INVALID_DATA, 0, 0);
+						return;
+					}
+					mctp_context.eid = msg[3];
+					body[1] = msg[3];
+					break;
+				case 2:   // reset eid - there is no static eid to reset to
+					transmitControlResponse(msg, MCTP_CC_ERROR_INVALID_DATA, 0, 0);
+					return;
+				default:  // set discovered flag
+					break;
+			}
+			mctp_context.discovered = 1;
+			transmitControlResponse(msg, MCTP_CC_SUCCESS, body, sizeof(body));
 			break;
+		}
 		case CMD_GET_ENDPOINT_ID:
+		{
+			// eid, endpoint type (simple endpoint, dynamic eid), medium specific
+			unsigned char body[] = { mctp_context.eid, 0x00, 0x00 };
+			transmitControlResponse(msg, MCTP_CC_SUCCESS, body, sizeof(body));
 			break;
+		}
 		case CMD_GET_MCTP_VERSION_SUPPORT:
+		{
+			// one version entry - 1.3.1 for the base specification and
+			// control messages, 1.0.0 for pldm over mctp
+			unsigned char body[] = { 1, 0xF1, 0xF3, 0xF1, 0x00 };
+			if (packet->length < 3) {
+				transmitControlResponse(msg, MCTP_CC_ERROR_INVALID_LENGTH, 0, 0);
+				break;
+			}
+			if (msg[2] == MCTP_TYPE_PLDM) {
+				body[2] = 0xF0;
+				body[3] = 0xF0;
+			} else if ((msg[2] != 0xFF) && (msg[2] != MCTP_TYPE_CONTROL)) {
+				transmitControlResponse(msg, MCTP_CC_MESSAGE_TYPE_NOT_SUPPORTED, 0, 0);
+				break;
+			}
+			transmitControlResponse(msg, MCTP_CC_SUCCESS, body, sizeof(body));
 			break;
+		}
 		case CMD_GET_MESSAGE_TYPE_SUPPORT:
+		{
+			// the control message type is implied; pldm is listed
+			unsigned char body[] = { 1, MCTP_TYPE_PLDM };
+			transmitControlResponse(msg, MCTP_CC_SUCCESS, body, sizeof(body));
 			break;
-		case CMD_DISCOVERY_NOTIFY:
-			mctp_context.discovered = 1;
-			break;
+		}
 		default:
+			transmitControlResponse(msg, MCTP_CC_ERROR_UNSUPPORTED_CMD, 0, 0);
 			break;
 	}
 }
 
+#pragma GCC push_options
+#pragma GCC optimize "-O3"
 //*******************************************************************
-// mctp_updateRxFSM()
+// mctp_rxByte()
 //
-// This is a finite state machine takes in chars from the serial port
-// and builds them into a MCTP packet and validates the packet.
+// This is a finite state machine takes in a single char from the serial
+// port and builds them into a MCTP packet and validates the packet.
+// Messages sent as several packets are reassembled into a single packet
+// buffer, which is only handed on once the end of message packet has
+// been received.  A packet that is missing, out of sequence or bad
+// abandons the message.
+// Depending on MCTP_RX_IN_ISR, this is called either from the main loop
+// or directly from the uart receive interrupt.
 //
 // parameters:
-//	  vars - a data struct used for all mctp functions
+//    ch - the character received
 // returns:
 //    void
-void  mctp_updateRxFSM(mctp_struct* vars) {
+static void mctp_rxByte(unsigned char ch) {
 	static unsigned char mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 	static unsigned int byte_count = 0;
 	static unsigned int fcs_msg = 0;
-
-    // reading in char from serial port
-	unsigned char ch;
-
-	if (uart_readCh((char*)&ch)==0) return;
+	static mctp_packet *packet;
+	static unsigned char source;
+	static unsigned char flags;
+	static unsigned char assembling = 0;   // a message is partly received
+	static unsigned char nextSeq;
 
     //building packet FSM
 	switch (mctp_serial_state) {
@@ -155,17 +350,17 @@ void  mctp_updateRxFSM(mctp_struct* vars) {
     // checking sync char for start of packet
 		if (ch == SYNC_CHAR) {
 			mctp_serial_state = MCTPSER_GETTING_REV;
-			mctp_context.fcs = fcs_calcFcs(INITFCS, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(INITFCS, ch);
 		}
 		break;
 	case MCTPSER_GETTING_REV:
     // checking revision number. This is currently set to 0x01
 		if (ch == MCTP_SERIAL_REV) {
 			mctp_serial_state = MCTPSER_BYTECOUNT;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		} 
 		else if (ch == SYNC_CHAR) {
-			mctp_context.fcs = fcs_calcFcs(INITFCS, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(INITFCS, ch);
 		}
 		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		break;
@@ -173,10 +368,15 @@ void  mctp_updateRxFSM(mctp_struct* vars) {
     // checking bytecount. This number should be the data 
 	// payload size plus 5 bytes
 		if (ch > 0x4) {
+			if (ch - 5 > MCTP_BUFFER_SIZE) {
+				// body would not fit in a packet buffer - drop the frame
+				mctp_context.stats.lengthOverruns++;
+				mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+				break;
+			}
 			byte_count = ch - 5;
 			mctp_serial_state = MCTPSER_VERSION;
-			mctp_context.rxInsertionIdx = 0;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		}
 		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		break;
@@ -184,40 +384,74 @@ void  mctp_updateRxFSM(mctp_struct* vars) {
     // checking version. This is currently set to 0x01
 		if (ch == 0x1) {
 			mctp_serial_state = MCTPSER_DESTID;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		}
 		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		break;
 	case MCTPSER_DESTID:
-    // checking destination number. This is by default set to 0x00
-		if (ch == 0) {
-			mctp_serial_state = MCTPSER_SOURCEID;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+    // checking destination number. Frames for other endpoints are
+	// dropped here, before a packet buffer is claimed.
+		if ((ch != mctp_context.eid) && (ch != MCTP_NULL_EID) && (ch != MCTP_BROADCAST_EID)) {
+			mctp_context.stats.framesIgnored++;
+			mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+			break;
 		}
-		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+		if ((unsigned char)(mctp_context.rxHead - mctp_context.rxTail) >= MCTP_RX_PACKETS) {
+			// no free packet buffer - drop the frame
+			mctp_context.stats.packetsDropped++;
+			mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+			break;
+		}
+		packet = &mctp_context.rxPackets[mctp_context.rxHead & (MCTP_RX_PACKETS-1)];
+		mctp_serial_state = MCTPSER_SOURCEID;
+		mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		break;
 	case MCTPSER_SOURCEID:
-    // checking source number. This is by default set to 0x00
-		if (ch == 0) {
-			mctp_serial_state = MCTPSER_FLAGS;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
-		}
-		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+    // source number - recorded so that responses can be addressed
+		source = ch;
+		mctp_serial_state = MCTPSER_FLAGS;
+		mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		break;
 	case MCTPSER_FLAGS:
     // Checking flags. Refer to base specification for details. 
-	// These flags should be set to 0xC8
-		if (ch == 0xC8) {
+	// The first packet of a message starts a new message.  Later
+	// packets must come from the same source, with the same tag and
+	// the next sequence number, and carry no message type.
+		flags = ch;
+		if (ch & MCTP_SOM) {
+			packet->sourceEid = source;
+			packet->tag = ch & (MCTP_TO | MCTP_TAG_MASK);
+			mctp_context.rxInsertionIdx = 0;
 			mctp_serial_state = MCTPSER_CMD;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
 		}
-		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+		else if ((assembling) && (source == packet->sourceEid) &&
+			((ch & (MCTP_TO | MCTP_TAG_MASK)) == packet->tag) &&
+			(((ch >> MCTP_SEQ_SHIFT) & 0x03) == nextSeq)) {
+			byte_count++;
+			mctp_serial_state = (byte_count) ? MCTPSER_BODY : MCTPSER_FCS_MSB;
+		}
+		else {
+			mctp_context.stats.sequenceErrors++;
+			assembling = 0;
+			mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+			break;
+		}
+		// the message is only resumed if this packet is good
+		assembling = 0;
+		if (mctp_context.rxInsertionIdx + byte_count > MCTP_BUFFER_SIZE) {
+			mctp_context.stats.lengthOverruns++;
+			mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
+			break;
+		}
+		nextSeq = ((ch >> MCTP_SEQ_SHIFT) + 1) & 0x03;
+		mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		break;
 	case MCTPSER_CMD:
 		if ((ch & 0xFE)==0) {
-			mctp_serial_state = MCTPSER_BODY;
+			// a frame with no body goes straight to the fcs
+			mctp_serial_state = (byte_count) ? MCTPSER_BODY : MCTPSER_FCS_MSB;
 			mctp_context.last_msg_type = ch;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 		}
 		else mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		break;
@@ -227,12 +461,14 @@ void  mctp_updateRxFSM(mctp_struct* vars) {
 			mctp_serial_state = MCTPSER_ESCAPE;
 		}
 		else if (ch == SYNC_CHAR) {
+			// frame ended before the byte count was reached
+			mctp_context.stats.framingErrors++;
 			mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		} else {
 			// insert the character in the buffer
-			mctp_context.rxBuffer[mctp_context.rxInsertionIdx] = ch;
+			packet->data[mctp_context.rxInsertionIdx] = ch;
 			mctp_context.rxInsertionIdx = mctp_context.rxInsertionIdx + 1;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 
 			// decrease the byte count
 			byte_count--;
@@ -245,15 +481,16 @@ void  mctp_updateRxFSM(mctp_struct* vars) {
 		if ((ch==ESCAPED_SYNC)||(ch==ESCAPED_ESCAPE)) {
 			// insert the character in the buffer
 			ch = ch+0x20;
-			mctp_context.rxBuffer[mctp_context.rxInsertionIdx] = ch;
+			packet->data[mctp_context.rxInsertionIdx] = ch;
 			mctp_context.rxInsertionIdx = mctp_context.rxInsertionIdx + 1;
-			mctp_context.fcs = fcs_calcFcs(mctp_context.fcs, &ch, 1);
+			mctp_context.fcs = fcs_updateFcs(mctp_context.fcs, ch);
 
 			// decrease the byte count
 			byte_count--;
 			mctp_serial_state = MCTPSER_BODY;
 			if (byte_count == 0) mctp_serial_state = MCTPSER_FCS_MSB;
 		} else {
+			mctp_context.stats.invalidEscapes++;
 			mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		}
 		break;
@@ -272,95 +509,383 @@ void  mctp_updateRxFSM(mctp_struct* vars) {
     	// declared ready. Otherwise, the packet is dropped.
 		if (ch == SYNC_CHAR) {
 			if (mctp_context.fcs==fcs_msg) {
-				// process MCTP control message (or response) if received
-				if (mctp_context.last_msg_type==0) {
-					mctp_processControlMessage(vars);
-				} 
-				else {
-					// otherwise, notifiy that a new packet is ready for PLDM
-					// interface
-					mctp_context.mctp_packet_ready = 1;
+				mctp_context.stats.framesOk++;
+				if (flags & MCTP_EOM) {
+					// hand the message on and move to the next free
+					// buffer.  Control messages are answered by the mctp
+					// layer from the main loop, never from here.
+					packet->length = mctp_context.rxInsertionIdx;
+					packet->type = mctp_context.last_msg_type;
+					mctp_context.rxHead++;
 				}
+				else assembling = 1;
 			}
+			else mctp_context.stats.fcsErrors++;
 		}
+		else mctp_context.stats.framingErrors++;
 		mctp_serial_state = MCTPSER_WAITING_FOR_SYNC;
 		break;
 	}
 }
+#pragma GCC pop_options
 
 //*******************************************************************
-// mctp_transmitFrameStart()
+// mctp_updateRxFSM()
+//
+// This function runs the receive state machine over every character
+// waiting in the uart receive buffer, so framing throughput does not
+// depend on how often it is called.  When framing is done in the uart
+// receive interrupt (MCTP_RX_IN_ISR) this step is skipped, since the
+// state machine must only run in one context.
+//
+// Control messages at the front of the receive pool are then answered,
+// as long as there is room to queue the responses.
+//
+// returns:
+//    void
+void  mctp_updateRxFSM() {
+#ifndef MCTP_RX_IN_ISR
+	unsigned char ch;
+	while (uart_readCh((char*)&ch)) mctp_rxByte(ch);
+#endif
+	while ((mctp_context.rxHead != mctp_context.rxTail) && (mctp_isTransmitReady())) {
+		mctp_packet *packet = &mctp_context.rxPackets[mctp_context.rxTail & (MCTP_RX_PACKETS-1)];
+		if (packet->type != MCTP_TYPE_CONTROL) break;
+		mctp_context.peerEid = packet->sourceEid;
+		mctp_context.txTag = packet->tag & MCTP_TAG_MASK;
+		mctp_processControlMessage(packet);
+		mctp_context.txTag = MCTP_TO;
+		mctp_context.rxTail++;
+	}
+}
+
+//*******************************************************************
+// buildFrameHeader()
 //
-// This function builds the MCTP packet header and puts it into the buffer.
+// This is a helper function that fills in the serial framing header, the
+// MCTP media-independent header and the message type.
 //
 // parameters:
-//	  vars - a data struct used for all mctp functions
+//    hdr - the 8 byte buffer to fill
 //	  totallength - the length of the message being transmitted (body + mctp serial header)
+//    destEid - the endpoint ID of the destination
+//    tag - the tag owner bit and message tag
+//    mctp_message_type - the MCTP message type (0 for control, 1 for PLDM)
 // returns:
 //    void
-void  mctp_transmitFrameStart(unsigned char totallength, unsigned char mctp_message_type) {
-	mctp_context.txfcs = INITFCS;
-	unsigned char ch = SYNC_CHAR;
-	uart_writeCh(ch);  // mctp synchronization character;
-	mctp_context.txfcs = fcs_calcFcs(mctp_context.txfcs, &ch, 1);
-    ch = 0x01;
-	uart_writeCh(ch);  // mctp version
-	mctp_context.txfcs = fcs_calcFcs(mctp_context.txfcs, &ch, 1);
-
-	// transmit the message length
-	uart_writeCh(totallength);
-	mctp_context.txfcs = fcs_calcFcs(mctp_context.txfcs, &totallength, 1);
-
-	// transmit the MCTP media-independent header
-	// header version = 1,,  destination/source ID = 0, SOM, EOM, TO
-	unsigned char hdr[] = { 0x01, 0x00, 0x00, 0xC8 };
-	uart_writeBuffer(hdr,4);
-	mctp_context.txfcs = fcs_calcFcs(mctp_context.txfcs, &hdr[0], 4);
-
-	// transmit the MCTP message type (0 for command message, 1 for PLDM)
-	uart_writeBuffer(&mctp_message_type,1);
-	mctp_context.txfcs = fcs_calcFcs(mctp_context.txfcs, &mctp_message_type, 1);
+static void buildFrameHeader(unsigned char *hdr, unsigned char totallength, unsigned char destEid, unsigned char tag, unsigned char mctp_message_type) {
+	hdr[0] = SYNC_CHAR;           // mctp synchronization character
+	hdr[1] = MCTP_SERIAL_REV;     // mctp serial revision
+	hdr[2] = totallength;
+	// header version = 1, destination/source ID, SOM, EOM, tag
+	hdr[3] = 0x01;
+	hdr[4] = destEid;
+	hdr[5] = mctp_context.eid;
+	hdr[6] = MCTP_SOM | MCTP_EOM | tag;
+	hdr[7] = mctp_message_type;
+}
+
+//*******************************************************************
+// mctp_isTransmitReady()
+//
+// returns non-zero if there is room to queue another frame with 
+// mctp_transmitFrame() without waiting.
+//
+// returns:
+//    true if a frame can be queued
+unsigned char mctp_isTransmitReady() {
+	return ((unsigned char)(txFrameHead - txFrameTail)) < MCTP_TX_FRAMES;
 }
 
 //*******************************************************************
-// mctp_transmitFrameData()
+// mctp_isTransmitIdle()
 //
-// This function builds the MCTP packet body and puts it into the buffer.
+// returns non-zero when all frames queued with mctp_transmitFrame()
+// have been handed to the uart.
+//
+// returns:
+//    true if no queued frames remain
+unsigned char mctp_isTransmitIdle() {
+	return txFrameHead == txFrameTail;
+}
+
+//*******************************************************************
+// queueFrame()
+//
+// This is a helper function that queues a complete MCTP message whose
+// body is described by a list of segments.  The message length is 
+// calculated from the segment sizes so the caller does not need to 
+// compute it.  Messages larger than the transmission unit are sent as
+// several packets.
+//
+// The message is serialized by the uart transmit interrupt, so this
+// function never waits for the data to be sent.  RAM segments are 
+// copied, while program memory segments are read directly by the
+// interrupt.
+//
+// parameters:
+//    destEid - the endpoint ID of the destination
+//    tag - the tag owner bit and message tag
+//    mctp_message_type - the MCTP message type (0 for control, 1 for PLDM)
+//    segments - the segments making up the message body
+//    count - the number of segments (at most MCTP_TX_SEGMENTS)
+// returns:
+//    1 if the message was queued, or 0 if the queue is full or the RAM
+//    segments do not fit in the staging area (MCTP_TX_STAGING)
+static unsigned char queueFrame(unsigned char destEid, unsigned char tag, unsigned char mctp_message_type, const mctp_segment *segments, unsigned char count) {
+	// body length and the amount of RAM data that must be staged
+	unsigned int length = 0;
+	unsigned int staged = 0;
+	for (unsigned char i = 0; i < count; i++) {
+		length += segments[i].size;
+		if (segments[i].type == MCTP_SEG_RAM) staged += segments[i].size;
+	}
+	if ((count > MCTP_TX_SEGMENTS) || (staged > MCTP_TX_STAGING)) return 0;
+	if (!mctp_isTransmitReady()) {
+		mctp_context.stats.txStalls++;
+		return 0;
+	}
+
+	// fill in the frame - this entry is not visible to the interrupt
+	// until the head is advanced.  The byte count is filled in for each
+	// packet as it is sent.
+	mctp_txframe *frame = &txFrames[txFrameHead & (MCTP_TX_FRAMES-1)];
+	buildFrameHeader(frame->header, 0, destEid, tag, mctp_message_type);
+	frame->length = length;
+	frame->count = count;
+	unsigned char *stage = frame->staging;
+	for (unsigned char i = 0; i < count; i++) {
+		frame->segments[i] = segments[i];
+		if (segments[i].type == MCTP_SEG_RAM) {
+			memcpy(stage, segments[i].data.ptr, segments[i].size);
+			frame->segments[i].data.ptr = stage;
+			stage += segments[i].size;
+		}
+	}
+	txFrameHead++;
+
+	// make sure the transmit interrupt is running
+	uart_startTx();
+	return 1;
+}
+
+//*******************************************************************
+// mctp_transmitFrame()
+//
+// This function sends a response to the packet taken with 
+// mctp_getPacket(), addressed to its sender and carrying its tag.  If
+// no packet is held, the message goes to the last peer as a new 
+// message with tag 0.  Messages that this endpoint originates are
+// sent with mctp_transmitRequest() instead.
+//
+// The message is queued (see queueFrame()), so this function never
+// waits for the data to be sent.  Callers that must not lose a message
+// check mctp_isTransmitReady() before building it.
 //
 // parameters:
-//    vars - a data struct used for all mctp functions
-//	  data -  the message being transmitted
-//    length - the length of the data in bytes
+//    mctp_message_type - the MCTP message type (0 for control, 1 for PLDM)
+//    segments - the segments making up the message body
+//    count - the number of segments (at most MCTP_TX_SEGMENTS)
+// returns:
+//    1 if the message was queued, otherwise 0
+unsigned char mctp_transmitFrame(unsigned char mctp_message_type, const mctp_segment *segments, unsigned char count) {
+	return queueFrame(mctp_context.peerEid, mctp_context.txTag, mctp_message_type, segments, count);
+}
+
+//*******************************************************************
+// mctp_transmitRequest()
+//
+// This function sends a message originated by this endpoint (a request
+// or a datagram).  The message gets a tag of its own with the tag owner
+// bit set, whether or not a received packet is being answered.
+//
+// parameters:
+//    destEid - the endpoint ID of the destination
+//    mctp_message_type - the MCTP message type (0 for control, 1 for PLDM)
+//    segments - the segments making up the message body
+//    count - the number of segments (at most MCTP_TX_SEGMENTS)
+// returns:
+//    1 if the message was queued, otherwise 0
+unsigned char mctp_transmitRequest(unsigned char destEid, unsigned char mctp_message_type, const mctp_segment *segments, unsigned char count) {
+	unsigned char tag = (txRequestTag + 1) & MCTP_TAG_MASK;
+	if (!queueFrame(destEid, MCTP_TO | tag, mctp_message_type, segments, count)) return 0;
+	txRequestTag = tag;
+	return 1;
+}
+
+#pragma GCC push_options
+#pragma GCC optimize "-O3"
+//*******************************************************************
+// startTxPacket()
+//
+// This is a helper function for the transmit interrupt that sets up the
+// next packet of a message: it sizes the packet, fills in the byte
+// count and flags of the header and starts sending the header.
+//
+// parameters:
+//    frame - the message being sent
 // returns:
 //    void
-void  mctp_transmitFrameData(unsigned char *data, unsigned int size) {
-	for (unsigned int i = 0; i < size; i++) {
-		// if the character is a sync or an escape, write the escape sequence
-		if ((data[i] == SYNC_CHAR) || (data[i] == ESCAPE_CHAR)) {
-			uart_writeCh(ESCAPE_CHAR);
-			uart_writeCh(data[i]-0x20);
-		} else {
-			// write the character
-			uart_writeCh(data[i]);
+static inline void startTxPacket(mctp_txframe *frame) {
+	// the first packet is the one with the message type in its header
+	unsigned char flags = (frame->header[6] & (MCTP_TO | MCTP_TAG_MASK)) | (txSeq << MCTP_SEQ_SHIFT);
+	if (txHeaderLength == sizeof(frame->header)) flags |= MCTP_SOM;
+	if (txPacketRemaining >= txMessageRemaining) {
+		txPacketRemaining = txMessageRemaining;
+		flags |= MCTP_EOM;
+	}
+	txMessageRemaining -= txPacketRemaining;
+
+	// byte count covers the transport header, message type and body
+	frame->header[2] = txPacketRemaining + txHeaderLength - 3;
+	frame->header[6] = flags;
+	txIdx = 0;
+	txFcs = INITFCS;
+	txPhase = TXPHASE_HEADER;
+}
+
+//*******************************************************************
+// mctp_txNextByte()
+//
+// This is the transmit source for the uart.  It is called from the uart
+// transmit interrupt and returns the next byte of the message at the
+// tail of the transmit queue, escaping body bytes and calculating the
+// frame check sequence as it goes.  Each packet of a message gets its
+// own serial frame.
+//
+// parameters:
+//    ch - a pointer to where the next byte will be stored
+// returns:
+//    non-zero if a byte was produced, 0 if there is nothing to send
+static unsigned char mctp_txNextByte(unsigned char *ch) {
+	mctp_txframe *frame = &txFrames[txFrameTail & (MCTP_TX_FRAMES-1)];
+	unsigned char byte;
+
+	switch (txPhase) {
+	case TXPHASE_IDLE:
+		// start the next frame if there is one
+		if (txFrameHead == txFrameTail) return 0;
+		txSegment = 0;
+		txRemaining = 0;
+		txSeq = 0;
+		txMessageRemaining = frame->length;
+		txHeaderLength = sizeof(frame->header);
+		txPacketRemaining = MCTP_TX_UNIT - 1;
+		startTxPacket(frame);
+		// fall through
+	case TXPHASE_HEADER:
+		byte = frame->header[txIdx++];
+		txFcs = fcs_updateFcs(txFcs, byte);
+		if (txIdx == txHeaderLength) txPhase = TXPHASE_BODY;
+		*ch = byte;
+		return 1;
+	case TXPHASE_ESCAPE:
+		*ch = txEscaped;
+		txPhase = TXPHASE_BODY;
+		return 1;
+	case TXPHASE_BODY:
+		// move to the next segment with data in it
+		while ((txPacketRemaining) && (txRemaining == 0)) {
+			if (txSegment == frame->count) break;
+			txSeg = &frame->segments[txSegment++];
+			txRemaining = txSeg->size;
+			txPtr = txSeg->data.ptr;
+			txValue = txSeg->data.value;
+		}
+		if ((txPacketRemaining) && (txRemaining)) {
+			txRemaining--;
+			txPacketRemaining--;
+			switch (txSeg->type) {
+			case MCTP_SEG_PROGMEM:
+				byte = pgm_read_byte(txPtr++);
+				break;
+			case MCTP_SEG_LE:
+				byte = txValue & 0xff;
+				txValue >>= 8;
+				break;
+			default:
+				byte = *txPtr++;
+				break;
+			}
+			txFcs = fcs_updateFcs(txFcs, byte);
+			if ((byte == SYNC_CHAR) || (byte == ESCAPE_CHAR)) {
+				txEscaped = byte - 0x20;
+				txPhase = TXPHASE_ESCAPE;
+				byte = ESCAPE_CHAR;
+			}
+			*ch = byte;
+			return 1;
+		}
+		// end of the packet body
+		txPhase = TXPHASE_FCS_MSB;
+		// fall through
+	case TXPHASE_FCS_MSB:
+		*ch = txFcs >> 8;
+		txPhase = TXPHASE_FCS_LSB;
+		return 1;
+	case TXPHASE_FCS_LSB:
+		*ch = txFcs & 0xff;
+		txPhase = TXPHASE_ENDSYNC;
+		return 1;
+	case TXPHASE_ENDSYNC:
+		*ch = SYNC_CHAR;
+		if (txMessageRemaining) {
+			// start the next packet of the message
+			txSeq = (txSeq + 1) & 0x03;
+			txHeaderLength = sizeof(frame->header) - 1;
+			txPacketRemaining = MCTP_TX_UNIT;
+			startTxPacket(frame);
+		}
+		else {
+			txPhase = TXPHASE_IDLE;
+			txFrameTail++;
 		}
+		return 1;
 	}
-	// update the fcs
-	mctp_context.txfcs = fcs_calcFcs(mctp_context.txfcs, data, size);
+	return 0;
+}
+#pragma GCC pop_options
+
+//*******************************************************************
+// mctp_getLinkStatistics()
+//
+// This function copies the link statistics, merging the framer counters
+// with the uart byte, overflow and stall counters.  Interrupts are held
+// off while the framer counters are copied since the framer may run in
+// interrupt context.
+//
+// parameters:
+//    stats - pointer to the structure to receive the statistics
+// returns:
+//    void
+void mctp_getLinkStatistics(mctp_linkstats *stats) {
+	uart_statistics ustats;
+
+	unsigned char sreg = SREG;
+	__builtin_avr_cli();
+	*stats = mctp_context.stats;
+	SREG = sreg;
+
+	uart_getStatistics(&ustats);
+	stats->bytesIn = ustats.bytesIn;
+	stats->bytesOut = ustats.bytesOut;
+	stats->ringOverflows = ustats.rxOverflows;
+	stats->txStalls += ustats.txStalls;
 }
 
 //*******************************************************************
-// mctp_transmitFrameEnd()
+// mctp_clearLinkStatistics()
 //
-// This function builds the MCTP packet footer and puts it into the buffer.
+// This function resets the framer and uart link statistics to zero.
 //
 // returns:
 //    void
-void  mctp_transmitFrameEnd() {
-	// transmit the message length in big-endian format
-	uart_writeCh(mctp_context.txfcs >> 8);
-	uart_writeCh(mctp_context.txfcs & 0xff);
-	// mctp synchronization character
-	uart_writeCh(SYNC_CHAR);
+void mctp_clearLinkStatistics() {
+	unsigned char sreg = SREG;
+	__builtin_avr_cli();
+	memset(&mctp_context.stats, 0, sizeof(mctp_context.stats));
+	SREG = sreg;
+	uart_clearStatistics();
 }
 
 //*******************************************************************
@@ -42,7 +42,58 @@
 #define CMD_GET_MESSAGE_TYPE_SUPPORT       0x05
 #define CMD_DISCOVERY_NOTIFY               0x0d
 
-#define MCTP_BUFFER_SIZE 128
+// control message completion codes
+#define MCTP_CC_SUCCESS                    0x00
+#define MCTP_CC_ERROR                      0x01
+#define MCTP_CC_ERROR_INVALID_DATA         0x02
+#define MCTP_CC_ERROR_INVALID_LENGTH       0x03
+#define MCTP_CC_ERROR_UNSUPPORTED_CMD      0x05
+#define MCTP_CC_MESSAGE_TYPE_NOT_SUPPORTED 0x80
+
+// message types
+#define MCTP_TYPE_CONTROL                  0x00
+#define MCTP_TYPE_PLDM                     0x01
+
+// special endpoint IDs.  Frames addressed to the null EID (physical
+// addressing) or the broadcast EID are accepted along with frames
+// addressed to the endpoint's own EID.
+#define MCTP_NULL_EID                      0x00
+#define MCTP_BROADCAST_EID                 0xFF
+
+// EIDs 0x01 through 0x07 are reserved by DSP0236 and cannot be assigned.
+#define MCTP_RESERVED_EID_LAST             0x07
+
+// transport header flags (som, eom, packet sequence, tag owner, tag)
+#define MCTP_SOM                           0x80
+#define MCTP_EOM                           0x40
+#define MCTP_SEQ_SHIFT                     4
+#define MCTP_TO                            0x08
+#define MCTP_TAG_MASK                      0x07
+
+// baseline transmission unit.  Messages with more payload than this
+// (message type plus body) are sent as several packets.
+#define MCTP_TX_UNIT                       64
+
+#define MCTP_BUFFER_SIZE 128    // largest reassembled message body
+
+// receive packet pool.  Framing continues into a free packet buffer while
+// the node layer processes earlier packets.  MCTP_RX_PACKETS must be a
+// power of 2.
+#define MCTP_RX_PACKETS     2    // number of receive packet buffers
+
+// define MCTP_RX_IN_ISR to run the receive state machine directly in the
+// uart receive interrupt.  Only completed packets with a good FCS are
+// handed to the main loop.  Otherwise, characters are buffered by the
+// uart and framed by mctp_updateRxFSM() from the main loop.
+//#define MCTP_RX_IN_ISR
+
+// transmit frame queue sizes.  MCTP_TX_FRAMES must be a power of 2.
+#define MCTP_TX_FRAMES      2    // frames that can be queued for transmit
+#define MCTP_TX_SEGMENTS    8    // maximum body segments per queued frame
+// bytes of RAM segment data copied per frame.  This must hold the largest
+// message built in RAM: a 4 byte pldm response header and a 64 byte body
+// (a sensor snapshot or a message from the node's response writer).
+#define MCTP_TX_STAGING     68
 
 //#defines for MCTP data transmission
 #define MCTPSER_WAITING_FOR_SYNC 0
@@ -66,27 +117,109 @@
 #define MCTP_SERIAL_REV         0x01
 
 
+// MCTP link statistics.  Byte counts, ring overflows and transmit stalls
+// come from the uart; the remaining counters are kept by the framer.
+//
+// The structure is sent as-is (little-endian, no padding) by the
+// GetLinkStatistics command, so its layout is part of the protocol:
+//    offset  0  bytesIn          (4)     offset 18  packetsDropped   (2)
+//    offset  4  bytesOut         (4)     offset 20  ringOverflows    (2)
+//    offset  8  framesOk         (2)     offset 22  txStalls         (4)
+//    offset 10  fcsErrors        (2)     offset 26  framesIgnored    (2)
+//    offset 12  invalidEscapes   (2)     offset 28  sequenceErrors   (2)
+//    offset 14  lengthOverruns   (2)
+//    offset 16  framingErrors    (2)
+// New counters must only ever be added at the end.
+typedef struct {
+	unsigned long bytesIn;             // characters received by the uart
+	unsigned long bytesOut;            // characters transmitted by the uart
+	unsigned int  framesOk;            // frames received with a good FCS
+	unsigned int  fcsErrors;           // frames dropped for a bad FCS
+	unsigned int  invalidEscapes;      // frames dropped for a bad escape sequence
+	unsigned int  lengthOverruns;      // frames dropped for a byte count too large for a packet buffer
+	unsigned int  framingErrors;       // frames dropped for a misplaced or missing sync
+	unsigned int  packetsDropped;      // frames dropped because the packet pool was full
+	unsigned int  ringOverflows;       // characters dropped because the uart ring was full
+	unsigned long txStalls;            // uart transmit wait loop passes and frames refused by a full queue
+	unsigned int  framesIgnored;       // frames addressed to other endpoints
+	unsigned int  sequenceErrors;      // packets dropped for being out of sequence
+} mctp_linkstats;
+
+// a received MCTP packet (message body only)
+typedef struct {
+	unsigned char length;                  // number of valid bytes in data
+	unsigned char type;                    // mctp message type
+	unsigned char tag;                     // tag owner and message tag
+	unsigned char sourceEid;               // endpoint ID of the sender
+	unsigned char data[MCTP_BUFFER_SIZE];
+} mctp_packet;
+
 // struct for data transfer
 typedef struct{
-    unsigned char rxBuffer[MCTP_BUFFER_SIZE];
+	mctp_packet   rxPackets[MCTP_RX_PACKETS];
+	volatile unsigned char rxHead;         // free-running, written by the framer
+	volatile unsigned char rxTail;         // free-running, written by the consumer
 	unsigned char rxInsertionIdx;
 	unsigned int  fcs;
-	unsigned int  txfcs;
-	unsigned char mctp_packet_ready;
 	unsigned char discovered;
+	unsigned char eid;                     // this endpoint's ID (null until assigned)
+	unsigned char peerEid;                 // destination for responses
+	unsigned char txTag;                   // tag owner and tag for responses
 	unsigned char last_msg_type;
+	mctp_linkstats stats;                  // framer counters (uart counters merged on read)
 } mctp_struct;
 
 extern mctp_struct mctp_context;
 
+// segment types for the scatter/gather frame builder
+#define MCTP_SEG_RAM      0   // bytes located in SRAM
+#define MCTP_SEG_PROGMEM  1   // bytes located in program memory
+#define MCTP_SEG_LE       2   // scalar value sent little-endian (1, 2 or 4 bytes)
+
+// a single piece of a frame body.  A body is described by an array of
+// these, which are sent back to back by mctp_transmitFrame().
+typedef struct {
+	unsigned char type;
+	unsigned int  size;
+	union {
+		const unsigned char *ptr;
+		unsigned long        value;
+	} data;
+} mctp_segment;
+
+// a message queued for transmission.  The serial and transport headers
+// are built when the message is queued.  RAM segments are copied into
+// the staging area so the caller's buffers may be reused immediately.
+// The message is split into packets of at most MCTP_TX_UNIT bytes, and
+// each packet is serialized, escaped and checksummed by the uart
+// transmit interrupt.
+typedef struct {
+	unsigned char header[8];    // header of the first packet
+	unsigned int  length;       // message body length (after the message type)
+	unsigned char count;        // number of body segments
+	mctp_segment  segments[MCTP_TX_SEGMENTS];
+	unsigned char staging[MCTP_TX_STAGING];
+} mctp_txframe;
+
+// initializers for frame segments
+#define MCTP_SEGMENT_RAM(p, n)     { MCTP_SEG_RAM,     (n), { .ptr = (const unsigned char*)(p) } }
+#define MCTP_SEGMENT_PROGMEM(p, n) { MCTP_SEG_PROGMEM, (n), { .ptr = (const unsigned char*)(p) } }
+#define MCTP_SEGMENT_LE(v, n)      { MCTP_SEG_LE,      (n), { .value = (unsigned long)(v) } }
+
 // function definitions
 void  mctp_init();
 unsigned char mctp_sendAndWait(unsigned int, unsigned char*, unsigned char mctp_message_type);
 unsigned char mctp_sendNoWait(unsigned int, unsigned char*, unsigned char mctp_message_type);
 unsigned char mctp_isPacketAvailable();
 unsigned char* mctp_getPacket();
+unsigned char mctp_getPacketSource();
+unsigned char mctp_getPacketLength();
+void  mctp_releasePacket();
 void  mctp_updateRxFSM();
-void  mctp_transmitFrameStart(unsigned char totallength, unsigned char mctp_message_type);
-void  mctp_transmitFrameData(unsigned char*, unsigned int);
-void  mctp_transmitFrameEnd();
+unsigned char mctp_transmitFrame(unsigned char mctp_message_type, const mctp_segment *segments, unsigned char count);
+unsigned char mctp_transmitRequest(unsigned char destEid, unsigned char mctp_message_type, const mctp_segment *segments, unsigned char count);
+unsigned char mctp_isTransmitReady();
+unsigned char mctp_isTransmitIdle();
+void  mctp_getLinkStatistics(mctp_linkstats *stats);
+void  mctp_clearLinkStatistics();
 void  mctp_close();
@@ -34,20 +34,81 @@
 #define __AVR_ATmega328P__
 #endif
 
+#include <string.h>
 #include <avr/pgmspace.h>
 #include <avr/io.h>
 #include "node.h"
 #include "mctp.h"
+#include "uart.h"
 #include "pldm.h"
+#include "systemtimer.h"
 #include "config.h"
 #include "entityStepper1.h"
 #include "entitySimple1.h"
 #include "EventGenerator.h"
+#include "StateSensor.h"
+#include "StateEffecter.h"
+#include "NumericSensor.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "isrprofile.h"
 
 static uint8   tid;
 static uint8   globalEventEnableState = 0;
-static char   eventFifoInsertId = 0;
-static char   eventFifoExtractId = 0;
+
+// the event queue.  Events are captured when they occur and held until
+// the manager acknowledges them.  The head and tail are free running
+// counts so that the queue can be filled completely; the entry index
+// is the count modulo the queue size.
+#define EVENT_QUEUE_SIZE 8      // must be a power of 2
+#define EVENT_DATA_SIZE  10     // the largest sensor event data
+typedef struct {
+    EventGeneratorInstance *egi;    // the generator to acknowledge
+    unsigned int  eventId;
+    unsigned char size;
+    unsigned char data[EVENT_DATA_SIZE];
+} QueuedEvent;
+static QueuedEvent   eventQueue[EVENT_QUEUE_SIZE];
+static unsigned char eventQueueHead = 0;     // the next entry to fill
+static unsigned char eventQueueTail = 0;     // the oldest entry
+static unsigned int  eventNextId = 1;
+static unsigned char eventBatchSize = 1;     // events per poll response
+
+// event message global enable values (SetEventReceiver)
+#define EVENTS_DISABLED        0
+#define EVENTS_ASYNC           1
+#define EVENTS_POLLING         2
+
+// asynchronous event push state.  The oldest queued event is sent to
+// the event receiver as a PlatformEventMessage and is removed from the
+// queue once the receiver responds.  If no response arrives within
+// EVENT_PUSH_TIMEOUT_MS, the message is sent again, up to
+// EVENT_PUSH_MAX_ATTEMPTS times.  After that the event stays queued
+// (it may still be polled) and pushing resumes once a request is
+// received from the manager.
+#define PUSH_IDLE              0
+#define PUSH_WAITING           1
+#define PUSH_FAILED            2
+#define EVENT_PUSH_DELAY_INSTANCE 2
+#define EVENT_PUSH_TIMEOUT_MS  250
+#define EVENT_PUSH_MAX_ATTEMPTS 3
+static unsigned char pushState = PUSH_IDLE;
+static unsigned char pushAttempts;
+static unsigned char pushInstanceId = 0;
+static unsigned int  pushEventId;
+static unsigned char eventReceiverEid = MCTP_NULL_EID;  // set by SetEventReceiver
+
+// baud rate change state.  A new rate is switched to once the response
+// to the request has been sent.  If no valid request is received at the
+// new rate within BAUD_CONFIRM_TIMEOUT_MS, the previous rate is restored.
+#define BAUD_IDLE              0
+#define BAUD_SWITCH_PENDING    1
+#define BAUD_CONFIRM_PENDING   2
+#define BAUD_DELAY_INSTANCE    1
+#define BAUD_CONFIRM_TIMEOUT_MS 1000
+static unsigned char baudState = BAUD_IDLE;
+static unsigned long baudNew;
+static unsigned long baudPrevious;
 
 #ifdef UUID
     const unsigned char uuid_bytes[] PROGMEM = {UUID};
@@ -92,27 +153,73 @@ static char   eventFifoExtractId = 0;
 #endif
 
 
-static void transmitByte(unsigned char data) {
-    // send the data to the MCTP buffer in little-endian fashion
-    mctp_transmitFrameData(&data,1);
+//*******************************************************************
+// message writer
+//
+// Messages are built in txMessage and sent in one piece when they are
+// committed, so the length of a message never has to be worked out by
+// hand.  For responses, the completion code is filled in at commit time.
+// A message that does not fit is never sent truncated: a response
+// becomes a bare RESPONSE_ERROR and a request is dropped.
+#define TX_MESSAGE_SIZE 64
+static unsigned char txMessage[TX_MESSAGE_SIZE];
+static unsigned char txMessageLength;
+static unsigned char txMessageOverflow;
+
+static void writeByte(unsigned char data) {
+    // characters beyond the end of the buffer are dropped and the
+    // message is marked as overflowed
+    if (txMessageLength < TX_MESSAGE_SIZE) txMessage[txMessageLength++] = data;
+    else txMessageOverflow = 1;
+}
+
+static void writeShort(unsigned int data) {
+    // write the data in little-endian fashion
+    writeByte(data & 0xff);
+    writeByte(data >> 8);
+}
+
+static void writeLong(unsigned long data) {
+    // write the data in little-endian fashion
+    writeShort(data);
+    writeShort(data >> 16);
 }
 
-static void transmitShort(unsigned int data) {
-    // send the data to the MCTP buffer in little-endian fashion
-    unsigned char ch = (data&0xff);
-    transmitByte(ch);
-    data = data>>8;
-    ch = (data&0xff);
-    transmitByte(ch);
+static void messageBegin(unsigned char flags1, unsigned char flags2, unsigned char command) {
+    txMessage[0] = flags1;
+    txMessage[1] = flags2;
+    txMessage[2] = command;
+    txMessageLength = sizeof(PldmRequestHeader);
+    txMessageOverflow = 0;
 }
 
-static void transmitLong(unsigned long data) {
-    // send the data to the MCTP buffer in little-endian fashion
-    transmitShort(data);
-    data = data>>16;
-    transmitShort(data);
+static void messageCommit() {
+    mctp_segment segment = MCTP_SEGMENT_RAM(txMessage, txMessageLength);
+    mctp_transmitFrame(MCTP_TYPE_PLDM, &segment, 1);
 }
 
+static void requestCommit(unsigned char destEid) {
+    // requests get a tag of their own, even while a request is held
+    if (txMessageOverflow) return;
+    mctp_segment segment = MCTP_SEGMENT_RAM(txMessage, txMessageLength);
+    mctp_transmitRequest(destEid, MCTP_TYPE_PLDM, &segment, 1);
+}
+
+static void responseBegin(PldmRequestHeader* rxHeader) {
+    // leave room for the completion code
+    messageBegin(rxHeader->flags1 & 0x7f, rxHeader->flags2, rxHeader->command);
+    txMessageLength = sizeof(PldmResponseHeader);
+}
+
+static void responseCommit(unsigned char code) {
+    if (txMessageOverflow) {
+        // the body did not fit - send the header alone
+        code = RESPONSE_ERROR;
+        txMessageLength = sizeof(PldmResponseHeader);
+    }
+    ((PldmResponseHeader*)txMessage)->completionCode = code;
+    messageCommit();
+}
 
 void node_init() {
 //    pdrCount = __pdr_number_of_records;
@@ -120,62 +227,59 @@ void node_init() {
 }
 
 //*******************************************************************
-// getPdrHeader()
+// transmitResponse()
 //
-// iterate through the repository to find the header for the pdr indexed by
-// the given index parameter.
+// send a response frame made up of the pldm response header (with the
+// given completion code) followed by an optional response body.
 //
 // parameters:
-//    index - the index of the pdr to get
+//    rxHeader - a pointer to the request header
+//    code - the completion code for the response
+//    body - the response body (may be null if size is 0)
+//    size - the size of the response body in bytes
 // returns:
-//    a pointer to the pdr header for the specified pdr
-static PdrCommonHeader* getPdrHeader(unsigned int index) {
-    // adjust the index for the pdr structure - assume records start at 1,
-    // and increase sequentially.  0 is a special case which will also retrieve
-    // the first record
-    if (index > 0) index--;
-    PdrCommonHeader* result = (PdrCommonHeader*)(__pdr_data);
-    unsigned long offset = 0;
-    unsigned int counter = 0;
-    while (counter != index) {
-        unsigned long part1 = sizeof(PdrCommonHeader);
-        unsigned long part2 = pgm_read_dword(&(result->dataLength));
-        offset = offset + part1 + part2;
-        result = (PdrCommonHeader*)(&__pdr_data[offset]);
-        if (pgm_read_byte(&(__pdr_data[offset])) == 0) return 0;
-        counter++;
-    }
-    return result;
+//    void
+static void transmitResponse(PldmRequestHeader* rxHeader, unsigned char code, unsigned char *body, unsigned char size) {
+    unsigned char hdr[] = { rxHeader->flags1 & 0x7f, rxHeader->flags2, rxHeader->command, code };
+    mctp_segment segments[] = {
+        MCTP_SEGMENT_RAM(hdr, sizeof(hdr)),
+        MCTP_SEGMENT_RAM(body, size)
+    };
+    mctp_transmitFrame(MCTP_TYPE_PLDM, segments, 2);
+}
+
+//*******************************************************************
+// getPdrIndex()
+//
+// convert a pdr record handle into an index into the pdr index table.
+// records are assumed to start at 1 and increase sequentially.  0 is a
+// special case which will also retrieve the first record.
+//
+// parameters:
+//    handle - the record handle of the pdr
+// returns:
+//    the index of the pdr within __pdr_index, or PDR_NUMBER_OF_RECORDS
+//    if the handle is not in the repository
+static unsigned int getPdrIndex(unsigned long handle) {
+    if (handle > 0) handle--;
+    if (handle >= PDR_NUMBER_OF_RECORDS) return PDR_NUMBER_OF_RECORDS;
+    return (unsigned int)handle;
 }
 
 //*******************************************************************
-// getPdrHeader()
+// getPdrOffset()
 //
-// iterate through the repository to find the header for the pdr indexed by
-// the given index parameter.
+// look up the offset of the pdr indexed by the given index parameter
+// from the precomputed pdr index table.
 //
 // parameters:
 //    index - the index of the pdr offset to get
 // returns:
 //    the data offset for the specified pdr
 static unsigned int getPdrOffset(unsigned int index) {
-    // adjust the index for the pdr structure - assume records start at 1,
-    // and increase sequentially.  0 is a special case which will also retrieve
-    // the first record
-    if (index > 0) index--;
-
-    PdrCommonHeader* hdr = (PdrCommonHeader*)(__pdr_data);
-    unsigned int offset = 0;
-    unsigned int counter = 0;
-    while (counter != index) {
-        unsigned long part1 = sizeof(PdrCommonHeader);
-        unsigned long part2 = pgm_read_dword(&(hdr->dataLength));
-        offset = offset + part1 + part2;
-        hdr = (PdrCommonHeader*)(&__pdr_data[offset]);
-        if (pgm_read_byte(&(__pdr_data[offset])) == 0) return 0;
-        counter++;
-    }
-    return offset;
+    index = getPdrIndex(index);
+    if (index == PDR_NUMBER_OF_RECORDS) return 0;
+    return pgm_read_word(&(__pdr_index[index].offset));
 }
 
 //*******************************************************************
@@ -204,10 +308,63 @@ static unsigned long  getNextRecord(unsigned long index) {
 // returns:
 //    the size in bytes of the indexed pdr
 static unsigned int pdrSize(unsigned int index) {
-    PdrCommonHeader * header = getPdrHeader(index);
-    if (!header) return 0;
-    unsigned int pdr_size = pgm_read_word(&(header->dataLength)); 
-    return pdr_size + sizeof(PdrCommonHeader);
+    index = getPdrIndex(index);
+    if (index == PDR_NUMBER_OF_RECORDS) return 0;
+    return pgm_read_word(&(__pdr_index[index].size));
+}
+
+//*******************************************************************
+// pdrCrc8()
+//
+// returns the crc8 of the entire pdr record.  This is precomputed when
+// the configuration is generated, so it does not need to be accumulated
+// while the record is being transferred.
+//
+// parameters:
+//    index - the index of the pdr to get the crc for
+// returns:
+//    the crc8 of the indexed pdr
+static unsigned char pdrCrc8(unsigned int index) {
+    index = getPdrIndex(index);
+    if (index == PDR_NUMBER_OF_RECORDS) return 0;
+    return pgm_read_byte(&(__pdr_index[index].crc8));
+}
+
+//*******************************************************************
+// transmitGetPdrResponse()
+//
+// send a getPdr response frame.  The pdr data is sent directly from
+// program memory.  When the transfer flag indicates the end of a
+// multi-part transfer, the crc8 of the record is appended.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+//    code - the completion code for the response
+//    recordHandle - the record handle being transferred
+//    nextRecord - the handle of the next record (0 if none)
+//    nextHandle - the next data transfer handle
+//    transferFlag - the transfer flag for this part
+//    extractionPoint - the offset of the first pdr byte in __pdr_data
+//    count - the number of pdr bytes to send
+// returns:
+//    void
+static void transmitGetPdrResponse(PldmRequestHeader* rxHeader, unsigned char code,
+    unsigned long recordHandle, unsigned long nextRecord, unsigned long nextHandle,
+    unsigned char transferFlag, unsigned int extractionPoint, unsigned int count)
+{
+    unsigned char hdr[] = { rxHeader->flags1 & 0x7f, rxHeader->flags2, rxHeader->command, code };
+    unsigned char crc8 = pdrCrc8(recordHandle);
+    mctp_segment segments[] = {
+        MCTP_SEGMENT_RAM(hdr, sizeof(hdr)),
+        MCTP_SEGMENT_LE(nextRecord, 4),             // response->nextRecordHandle
+        MCTP_SEGMENT_LE(nextHandle, 4),             // response->nextDataTransferHandle
+        MCTP_SEGMENT_LE(transferFlag, 1),           // response->transferFlag
+        MCTP_SEGMENT_LE(count, 2),                  // response->responseCount
+        MCTP_SEGMENT_PROGMEM(&__pdr_data[extractionPoint], count),
+        MCTP_SEGMENT_RAM(&crc8, 1)
+    };
+    // the crc is only sent with the end part of a multi-part transfer
+    mctp_transmitFrame(MCTP_TYPE_PLDM, segments, (transferFlag == 0x04) ? 7 : 6);
 }
 
 //*******************************************************************
@@ -226,13 +383,18 @@ static unsigned int pdrSize(unsigned int index) {
 static void processCommandGetPdr(PldmRequestHeader* rxHeader) 
 {
     static char pdrTxState = 0;
-    static char crc8;
     static unsigned int pdrNextHandle;
     static unsigned long pdrRecord;
-    unsigned int extractionPoint;
 
-    GetPdrCommand* request = (GetPdrCommand*)(mctp_context.rxBuffer + sizeof(*rxHeader));
+    GetPdrCommand* request = (GetPdrCommand*)(((unsigned char*)rxHeader) + sizeof(*rxHeader));
     unsigned char errorcode = 0;
+
+    // look up the record once - these are constant for the rest of the request
+    unsigned int  recordOffset = getPdrOffset(request->recordHandle);
+    unsigned int  recordSize   = pdrSize(request->recordHandle);
+    unsigned long nextRecord   = getNextRecord(request->recordHandle);
+    if (nextRecord > PDR_NUMBER_OF_RECORDS) nextRecord = 0;
+
     switch (pdrTxState) {
     case 0:
         // transfer has not begun yet
@@ -246,61 +408,21 @@ static void processCommandGetPdr(PldmRequestHeader* rxHeader)
             errorcode = RESPONSE_INVALID_RECORD_CHANGE_NUMBER;
         if (errorcode) {
             // send the error response
-            mctp_transmitFrameStart(sizeof(PldmResponseHeader)+sizeof(GetPdrResponse) + 5-1, 1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            mctp_transmitFrameData(&errorcode,1);  // response->completionCode = errorcode;
-            transmitLong(0);                       // response->nextRecordHandle = 0;
-            transmitLong(0);                       // response->NextRecordTransferHandle;
-            transmitByte(0);                       // response->transferFlag = 0;
-            transmitShort(0);                      // response->responseCount = 0;
-            mctp_transmitFrameEnd();
+            transmitGetPdrResponse(rxHeader, errorcode, 0, 0, 0, 0, 0, 0);
             return;
         }
-        if (request->requestCount >= pdrSize(request->recordHandle)) {
-            // send the data (single part)
-            mctp_transmitFrameStart( sizeof(PldmResponseHeader) + sizeof(GetPdrResponse) + pdrSize(request->recordHandle)+5-1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-            transmitLong((getNextRecord(request->recordHandle) <= PDR_NUMBER_OF_RECORDS) ?
-                getNextRecord(request->recordHandle) : 0);
-            transmitLong(0);                      //response->nextDataTransferHandle = 0;
-            transmitByte(0x05);                   // response->transferFlag = 0x05;   // start and end
-            transmitShort(pdrSize(request->recordHandle)); // response->responseCount = pdrSize(request->recordHandle);
-            unsigned int extractionPoint = getPdrOffset(request->recordHandle);
-            // insert the pdr
-            for (int i = 0;i < pdrSize(request->recordHandle); i++) {
-                transmitByte(pgm_read_byte(&(__pdr_data[extractionPoint++])));
-            }
-            mctp_transmitFrameEnd();
+        if (request->requestCount >= recordSize) {
+            // send the data (single part) - start and end
+            transmitGetPdrResponse(rxHeader, RESPONSE_SUCCESS, request->recordHandle,
+                nextRecord, 0, 0x05, recordOffset, recordSize);
             return;
         }
         // start sending the data (multi-part)
-        mctp_transmitFrameStart( sizeof(PldmResponseHeader) + sizeof(GetPdrResponse) + request->requestCount+5-1,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-        transmitLong((getNextRecord(request->recordHandle) <= PDR_NUMBER_OF_RECORDS) ?
-                getNextRecord(request->recordHandle) : 0);
-        transmitLong(getPdrOffset(request->recordHandle) + request->requestCount);
-        transmitByte(0x00);                // response->transferFlag = 0x0;   // start
-        transmitShort(request->requestCount); // response->responseCount = request->requestCount;
-        extractionPoint = request->dataTransferHandle+getPdrOffset(request->recordHandle);
-        // insert the pdr
-        crc8 = 0;
-        for (int i = 0;i < request->requestCount;i++) {
-            unsigned char byte = pgm_read_byte(&(__pdr_data[extractionPoint++])); 
-            transmitByte(byte);
-            crc8 = calc_new_crc8(crc8, byte);
-        }
-        mctp_transmitFrameEnd();
+        transmitGetPdrResponse(rxHeader, RESPONSE_SUCCESS, request->recordHandle,
+            nextRecord, recordOffset + request->requestCount, 0x00, recordOffset, request->requestCount);
         pdrTxState = 1;
         pdrRecord = request->recordHandle;
-        pdrNextHandle = getPdrOffset(request->recordHandle) + request->requestCount;
+        pdrNextHandle = recordOffset + request->requestCount;
         return;
     case 1:
         // transfer has already begun
@@ -314,70 +436,61 @@ static void processCommandGetPdr(PldmRequestHeader* rxHeader)
             errorcode = RESPONSE_INVALID_RECORD_CHANGE_NUMBER;
         if (errorcode) {
             // send the error response
-            mctp_transmitFrameStart(sizeof(PldmResponseHeader)+sizeof(GetPdrResponse) + 5-1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            mctp_transmitFrameData(&errorcode,1);  // response->completionCode = errorcode;
-            transmitLong(0);                       // response->nextRecordHandle = 0;
-            transmitLong(0);                       // response->NextRecordTransferHandle;
-            transmitByte(0);                       // response->transferFlag = 0;
-            transmitShort(0);                      // response->responseCount = 0;
-            mctp_transmitFrameEnd();
+            transmitGetPdrResponse(rxHeader, errorcode, 0, 0, 0, 0, 0, 0);
             return;
         }
-        if (request->requestCount + request->dataTransferHandle >= getPdrOffset(request->recordHandle)+pdrSize(request->recordHandle)+1) {
+        if (request->requestCount + request->dataTransferHandle >= recordOffset+recordSize+1) {
             // transfer end part of the data
-            mctp_transmitFrameStart( sizeof(PldmResponseHeader) + sizeof(GetPdrResponse) + pdrSize(request->recordHandle) -
-                (request->dataTransferHandle-getPdrOffset(request->recordHandle)) + 5 - 1 + 1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-            transmitLong((getNextRecord(request->recordHandle) <= PDR_NUMBER_OF_RECORDS) ?
-                getNextRecord(request->recordHandle) : 0);
-            transmitLong(0);                      // next data transfer handle
-            transmitByte(0x04);                   // response->transferFlag = 0x04;   end
-            transmitShort(pdrSize(request->recordHandle) -
-                (request->dataTransferHandle-getPdrOffset(request->recordHandle))); 
-            unsigned int extractionPoint = request->dataTransferHandle;
-            // insert the pdr
-            for (int i = 0;i < pdrSize(request->recordHandle) -
-                (request->dataTransferHandle-getPdrOffset(request->recordHandle));i++) {
-                unsigned char byte = pgm_read_byte(&(__pdr_data[extractionPoint++])); 
-                transmitByte(byte);
-                crc8 = calc_new_crc8(crc8, byte);
-            }
-            transmitByte(crc8);
-            mctp_transmitFrameEnd();
+            transmitGetPdrResponse(rxHeader, RESPONSE_SUCCESS, request->recordHandle,
+                nextRecord, 0, 0x04, request->dataTransferHandle,
+                recordSize - (request->dataTransferHandle-recordOffset));
             pdrTxState = 0;
             return;
         }
         // send the middle data (multi-part)
-        mctp_transmitFrameStart( sizeof(PldmResponseHeader) + sizeof(GetPdrResponse) + request->requestCount + 5-1,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-        transmitLong((getNextRecord(request->recordHandle) <= PDR_NUMBER_OF_RECORDS) ?
-            getNextRecord(request->recordHandle) : 0);
-        transmitLong(request->dataTransferHandle + request->requestCount); // next data transfer handle
-        transmitByte(0x01);                   // response->transferFlag = 0x01;   middle
-        transmitShort(request->requestCount); 
-        unsigned int extractionPoint = request->dataTransferHandle;
-        // insert the pdr
-        for (int i = 0;i < request->requestCount;i++) {
-            unsigned char byte = pgm_read_byte(&(__pdr_data[extractionPoint++])); 
-            transmitByte(byte);
-            crc8 = calc_new_crc8(crc8, byte);
-        }
-        mctp_transmitFrameEnd();
+        transmitGetPdrResponse(rxHeader, RESPONSE_SUCCESS, request->recordHandle,
+            nextRecord, request->dataTransferHandle + request->requestCount, 0x01,
+            request->dataTransferHandle, request->requestCount);
         pdrTxState = 1;
         pdrNextHandle = request->dataTransferHandle + request->requestCount;
         return;
     }
 }
 
+//*******************************************************************
+// transmitFruTableResponse()
+//
+// send a getFruRecordTable response frame.  The fru data is sent
+// directly from program memory.  The final part of the transfer is
+// followed by the padding and the table crc.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+//    code - the completion code for the response
+//    nextHandle - the next data transfer handle
+//    transferFlag - the transfer flag for this part
+//    extractionPoint - the offset of the first fru byte in __fru_data
+//    count - the number of fru bytes to send
+//    padding - the number of padding bytes (only for the final part)
+// returns:
+//    void
+static void transmitFruTableResponse(PldmRequestHeader* rxHeader, unsigned char code,
+    unsigned long nextHandle, unsigned char transferFlag, unsigned int extractionPoint,
+    unsigned int count, unsigned char padding)
+{
+    unsigned char hdr[] = { rxHeader->flags1 & 0x7f, rxHeader->flags2, rxHeader->command, code };
+    mctp_segment segments[] = {
+        MCTP_SEGMENT_RAM(hdr, sizeof(hdr)),
+        MCTP_SEGMENT_LE(nextHandle, 4),             // response->nextDataTransferHandle
+        MCTP_SEGMENT_LE(transferFlag, 1),           // response->transferFlag
+        MCTP_SEGMENT_PROGMEM(&__fru_data[extractionPoint], count),
+        MCTP_SEGMENT_LE(0, padding),                // padding bytes if required
+        MCTP_SEGMENT_LE(0, 4)                       // TODO: calculate and send CRC
+    };
+    // padding and crc are only sent with the last part of the table
+    mctp_transmitFrame(MCTP_TYPE_PLDM, segments, ((transferFlag == 0x04)||(transferFlag == 0x05)) ? 6 : 4);
+}
+
 //*******************************************************************
 // processCommandGetFruTable()
 //
@@ -395,8 +508,8 @@ static void processCommandFruTable(PldmRequestHeader* rxHeader)
     static char fruTxState = 0;
     static unsigned int fruNextHandle;
 
-    unsigned long dataTransferHandle = *((long*)(mctp_context.rxBuffer + sizeof(*rxHeader)));
-    unsigned char transferOperationFlag  = *(mctp_context.rxBuffer + sizeof(*rxHeader) + sizeof(unsigned long));
+    unsigned long dataTransferHandle = *((long*)(((unsigned char*)rxHeader) + sizeof(*rxHeader)));
+    unsigned char transferOperationFlag  = *(((unsigned char*)rxHeader) + sizeof(*rxHeader) + sizeof(unsigned long));
     unsigned char errorcode = 0;
     const unsigned short requestCount = 32;
     unsigned char padding = ((unsigned char)FRU_TOTAL_SIZE&0x03);
@@ -410,107 +523,40 @@ static void processCommandFruTable(PldmRequestHeader* rxHeader)
             errorcode = RESPONSE_INVALID_DATA_TRANSFER_HANDLE;
         if (errorcode) {
             // send the error response
-            mctp_transmitFrameStart(sizeof(PldmResponseHeader)+ 6 + 5-1, 1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            mctp_transmitFrameData(&errorcode,1);  // response->completionCode = errorcode;
-            transmitLong(0);                       // response->NextTransferHandle;
-            transmitByte(0);                       // response->transferFlag = 0;
-            mctp_transmitFrameEnd();
+            transmitFruTableResponse(rxHeader, errorcode, 0, 0, 0, 0, 0);
             return;
         }
         if (requestCount >= FRU_TOTAL_SIZE + padding) {          
-            // send the data (single part)
-            mctp_transmitFrameStart( sizeof(PldmResponseHeader) + 6 + FRU_TOTAL_SIZE + padding + 4 + 5-1, 1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_SUCCESS);       // response->completionCode = RESPONSE_SUCCESS;
-            transmitLong(0);                      // response->nextDataTransferHandle = 0;
-            transmitByte(0x05);                   // response->transferFlag = 0x05;   // start and end
-            // send the FRU data
-            for (int i = 0;i < FRU_TOTAL_SIZE; i++) {
-                transmitByte(pgm_read_byte(&(__fru_data[i])));
-            }
-            // send padding bytes if required
-            for (int i = 0;i < padding; i++) {
-                transmitByte(0x00);
-            }
-            transmitLong(0x00);                   // TODO: calculate and send CRC
-            mctp_transmitFrameEnd();
+            // send the data (single part) - start and end
+            transmitFruTableResponse(rxHeader, RESPONSE_SUCCESS, 0, 0x05, 0, FRU_TOTAL_SIZE, padding);
             return;
         }
         // start sending the data (multi-part)
-        mctp_transmitFrameStart( sizeof(PldmResponseHeader) + 6 + requestCount + 5-1,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-        transmitLong(dataTransferHandle + requestCount);  // next data transfer handle
-        transmitByte(0x00);                               // response->transferFlag = 0x0;   // start
-        // insert the pdr
-        for (int i = 0;i < requestCount;i++) {
-            unsigned char byte = pgm_read_byte(&(__fru_data[dataTransferHandle++])); 
-            transmitByte(byte);
-        }
-        mctp_transmitFrameEnd();
+        transmitFruTableResponse(rxHeader, RESPONSE_SUCCESS, dataTransferHandle + requestCount, 0x00,
+            dataTransferHandle, requestCount, 0);
         fruTxState = 1;
-        fruNextHandle = dataTransferHandle;
+        fruNextHandle = dataTransferHandle + requestCount;
         return;
     case 1: // transfer has already begun
         if (transferOperationFlag != 0x0) errorcode = RESPONSE_INVALID_TRANSFER_OPERATION_FLAG;
         else if (dataTransferHandle != fruNextHandle) errorcode = RESPONSE_INVALID_DATA_TRANSFER_HANDLE;
         if (errorcode) {
             // send the error response
-            mctp_transmitFrameStart(sizeof(PldmResponseHeader)+ 6 + 5-1, 1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            mctp_transmitFrameData(&errorcode,1);  // response->completionCode = errorcode;
-            transmitLong(0);      // response->NextTransferHandle;
-            transmitByte(0);                       // response->transferFlag = 0;
-            mctp_transmitFrameEnd();
+            transmitFruTableResponse(rxHeader, errorcode, 0, 0, 0, 0, 0);
             return;
         }
         if (requestCount + dataTransferHandle >= FRU_TOTAL_SIZE + padding) {
             // transfer end part of the data
-            mctp_transmitFrameStart( sizeof(PldmResponseHeader) + 6 + 4 + FRU_TOTAL_SIZE + padding -
-                dataTransferHandle + 5 - 1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-            transmitLong(0);                      // next data transfer handle
-            transmitByte(0x04);                   // response->transferFlag = 0x04;   end
-            // send the FRU data
-            while (dataTransferHandle < FRU_TOTAL_SIZE) {
-                transmitByte(pgm_read_byte(&(__fru_data[dataTransferHandle++])));
-            }
-            // send padding bytes if required
-            for (int i = 0;i < padding; i++) {
-                transmitByte(0x00);
-            }
-            transmitLong(0x00);                   // TODO: calculate and send CRC
-            mctp_transmitFrameEnd();
+            transmitFruTableResponse(rxHeader, RESPONSE_SUCCESS, 0, 0x04,
+                dataTransferHandle, FRU_TOTAL_SIZE - dataTransferHandle, padding);
             fruTxState = 0;
             return;
         }
         // send the middle data (multi-part)
-        mctp_transmitFrameStart( sizeof(PldmResponseHeader) + 6 + requestCount + 5-1,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(RESPONSE_SUCCESS);        // response->completionCode = RESPONSE_SUCCESS;
-        transmitLong(dataTransferHandle + requestCount); // next data transfer handle
-        transmitByte(0x01);                   // response->transferFlag = 0x01;   middle
-        for (int i = 0;i < requestCount;i++) {
-            unsigned char byte = pgm_read_byte(&(__pdr_data[dataTransferHandle++])); 
-            transmitByte(byte);
-        }
-        mctp_transmitFrameEnd();
+        transmitFruTableResponse(rxHeader, RESPONSE_SUCCESS, dataTransferHandle + requestCount, 0x01,
+            dataTransferHandle, requestCount, 0);
         fruTxState = 1;
-        fruNextHandle = dataTransferHandle;
+        fruNextHandle = dataTransferHandle + requestCount;
         return;
     }
 }
@@ -527,6 +573,14 @@ static void processCommandFruTable(PldmRequestHeader* rxHeader)
 // changes:
 //    the contents of the transmit buffer
 static void setStateEffecterStates(PldmRequestHeader* rxHeader) {
+    // each composite field is a {setRequest, effecterState} pair that
+    // follows the effecter id and count
+    unsigned char effecter_count = *(((unsigned char*)rxHeader)+sizeof(PldmRequestHeader)+2);
+    if (mctp_getPacketLength() - sizeof(PldmRequestHeader) < 3 + 2*effecter_count) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_LENGTH, 0, 0);
+        return;
+    }
+
     #ifdef ENTITY_STEPPER1
         unsigned char response = entityStepper1_setStateEffecterStates(rxHeader);
     #endif
@@ -541,12 +595,7 @@ static void setStateEffecterStates(PldmRequestHeader* rxHeader) {
     #endif
     
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, 0, 0);
 } 
 
 //*******************************************************************
@@ -575,18 +624,13 @@ static void setStateEffecterEnables(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, 0, 0);
 } 
 
 //*******************************************************************
 // getStateSensorReading()
 //
-// get the value of a state sensor state if it exists.
+// get the states of a (possibly composite) state sensor if it exists.
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -595,7 +639,7 @@ static void setStateEffecterEnables(PldmRequestHeader* rxHeader) {
 // changes:
 //    the contents of the transmit buffer
 static void getStateSensorReading(PldmRequestHeader* rxHeader) {
-    unsigned char body[10];
+    unsigned char body[1 + 4*STATESENSOR_MAX_COMPOSITE];
     unsigned char size;
 
     #ifdef ENTITY_STEPPER1
@@ -612,19 +656,13 @@ static void getStateSensorReading(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5 + size,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);         // completion code
-        mctp_transmitFrameData(body,size);
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, body, size);
 } 
 
 //*******************************************************************
 // getStateEfffecterStates()
 //
-// get the value of a numeric state effecter state if it exists.
+// get the states of a (possibly composite) state effecter if it exists.
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -633,7 +671,7 @@ static void getStateSensorReading(PldmRequestHeader* rxHeader) {
 // changes:
 //    the contents of the transmit buffer
 static void getStateEffecterStates(PldmRequestHeader* rxHeader) {
-    unsigned char body[10];
+    unsigned char body[1 + 3*STATEEFFECTER_MAX_COMPOSITE];
     unsigned char size;
 
     #ifdef ENTITY_STEPPER1
@@ -650,13 +688,7 @@ static void getStateEffecterStates(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5 + size,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);         // completion code
-        mctp_transmitFrameData(body,size);
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, body, size);
 } 
 
 //*******************************************************************
@@ -685,12 +717,7 @@ static void setNumericEffecterValue(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameEnd();    
+    transmitResponse(rxHeader, response, 0, 0);
 }
 
 //*******************************************************************
@@ -722,13 +749,7 @@ static void getNumericEffecterValue(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + size + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameData(body,size);
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, body, size);
 }
 
 //*******************************************************************
@@ -760,13 +781,7 @@ static void getSensorReading(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + size + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameData(body,size);
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, body, size);
 }
 
 //*******************************************************************
@@ -795,12 +810,7 @@ static void setNumericSensorEnable(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, 0, 0);
 }
 
 //*******************************************************************
@@ -829,12 +839,7 @@ static void setNumericEffecterEnable(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, 0, 0);
 }
 
 //*******************************************************************
@@ -863,12 +868,7 @@ static void setStateSensorEnables(PldmRequestHeader* rxHeader) {
     #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response);   // completion code
-        mctp_transmitFrameEnd();
+    transmitResponse(rxHeader, response, 0, 0);
 }
 
 //*******************************************************************
@@ -884,14 +884,9 @@ static void setStateSensorEnables(PldmRequestHeader* rxHeader) {
 //    the contents of the transmit buffer
 void setTid(PldmRequestHeader* rxHeader) {
     tid = *((uint8*)(((char*)rxHeader)+sizeof(PldmRequestHeader)));
-    unsigned char response_code = RESPONSE_SUCCESS;
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5,1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        mctp_transmitFrameEnd();
+    responseBegin(rxHeader);
+    responseCommit(RESPONSE_SUCCESS);
 }
 
 //*******************************************************************
@@ -906,15 +901,10 @@ void setTid(PldmRequestHeader* rxHeader) {
 // changes:
 //    the contents of the transmit buffer
 void getTid(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        transmitByte(tid);
-        mctp_transmitFrameEnd();
+    responseBegin(rxHeader);
+    writeByte(tid);
+    responseCommit(RESPONSE_SUCCESS);
 }
 
 //*******************************************************************
@@ -929,24 +919,19 @@ void getTid(PldmRequestHeader* rxHeader) {
 // changes:
 //    the contents of the transmit buffer
 void getPldmVersion(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 13 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        transmitLong(0x00000000);      // next transfer handle
-        transmitByte(0x05);            // start and end
-        transmitLong(0xF1F0F000);      // Version 1.0.0.0
-        transmitLong(0x4A868FFB);      // CRC32 of the
-        mctp_transmitFrameEnd();
+    responseBegin(rxHeader);
+    writeLong(0x00000000);      // next transfer handle
+    writeByte(0x05);            // start and end
+    writeLong(0xF1F0F000);      // Version 1.0.0.0
+    writeLong(0x4A868FFB);      // CRC32 of the
+    responseCommit(RESPONSE_SUCCESS);
 }
 
 //*******************************************************************
-// getPldmTypes()
+// getTerminusUuid()
 //
-// respond by sending the Pldm types supported by this node
+// respond by sending the UUID of this node
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -954,29 +939,18 @@ void getPldmVersion(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void getPldmTypes(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
+void getUuid(PldmRequestHeader* rxHeader) {
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 8 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        transmitByte(0x15);            // types 0-7 (base, platform management, fru supported)
-        transmitByte(0x00);            // types 8-15
-        transmitByte(0x00);            // types 6-23
-        transmitByte(0x00);            // types 24-31
-        transmitByte(0x00);            // types 32-39
-        transmitByte(0x00);            // types 40-47
-        transmitByte(0x00);            // types 48-55
-        transmitByte(0x00);            // types 56-63
-        mctp_transmitFrameEnd();
+    responseBegin(rxHeader);
+    for (int i=0;i<16;i++) writeByte(pgm_read_byte(&uuid_bytes[i]));
+    responseCommit(RESPONSE_SUCCESS);
 }
 
 //*******************************************************************
-// getPldmCommands()
+// processCommandEventMessageSupported()
 //
-// respond by sending the commands supported by this node
+// respond to a EventMessageSupported command.  Events may be pushed
+// to the event receiver asynchronously or polled.
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -984,50 +958,22 @@ void getPldmTypes(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void getPldmCommands(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
+void processCommandEventMessageSupported(PldmRequestHeader* rxHeader) {
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 32 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);  // completion code   
-        switch(rxHeader->flags2&0x3F) {
-            case 0:
-                // pldm command and discovery
-                transmitLong(0x0000003E);
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                break;
-            case 2:
-                // pldm for platform management and control
-                transmitLong(0x007F1810);
-                transmitLong(0x07070003);
-                transmitLong(0x00030000);
-                transmitLong(0x00000000);
-                break;
-            case 4:
-                // pldm for fru
-                transmitLong(0x00000006);
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                break;
-            default:
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                transmitLong(0x00000000);
-                break;
-        }
-        mctp_transmitFrameEnd();
+    responseBegin(rxHeader);
+    writeByte(globalEventEnableState);
+    writeByte(0x06);  // asynchronous and polled modes supported
+    writeByte(0x01);  // one class of event generated
+    writeByte(0x00);  // sensor event class generated
+    responseCommit(RESPONSE_SUCCESS);
 }
 
 //*******************************************************************
-// getTerminusUuid()
+// processSetEventReceiver()
 //
-// respond by sending the UUID of this node
+// respond to a SetEventReceiver command.  Asynchronous events and
+// polling are supported, over mctp only.  Asynchronous events are
+// sent to the endpoint given by eventReceiverAddressInfo.
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -1035,23 +981,70 @@ void getPldmCommands(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void getUuid(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
+void processSetEventReceiver(PldmRequestHeader* rxHeader) {
+    unsigned char enable = *((char*)(rxHeader+1));
+    unsigned char transportProtocol = *(((char*)(rxHeader+1))+1);
+    unsigned char receiver = *(((char*)(rxHeader+1))+2);
+
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 16 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        for (int i=0;i<16;i++) transmitByte(pgm_read_byte(uuid_bytes[i]));
-        mctp_transmitFrameEnd();
+    if (enable > EVENTS_POLLING) {
+        transmitResponse(rxHeader, RESPONSE_ENABLE_METHOD_NOT_SUPPORTED, 0, 0);
+        enable = EVENTS_DISABLED;
+    } else if ((enable != EVENTS_DISABLED) && (transportProtocol != 0)) {
+        transmitResponse(rxHeader, RESPONSE_INVALID_PROTOCOL_TYPE, 0, 0);
+        enable = EVENTS_DISABLED;
+    } else if ((enable == EVENTS_ASYNC) && ((receiver == MCTP_NULL_EID) || (receiver == MCTP_BROADCAST_EID))) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_DATA, 0, 0);
+        enable = EVENTS_DISABLED;
+    } else {
+        eventReceiverEid = receiver;
+        transmitResponse(rxHeader, RESPONSE_SUCCESS, 0, 0);
+    }
+
+    globalEventEnableState = enable;
+    pushState = PUSH_IDLE;
 }
 
 //*******************************************************************
-// processCommandEventMessageSupported()
+// acknowledgeEvents()
 //
-// respond to a EventMessageSupported command.  Currently only polling
-// is supported by the device.
+// remove events from the event queue, up to and including the event
+// with the given id, and acknowledge them with their event generators.
+//
+// parameters:
+//    eventId - the id of the last event to acknowledge
+// returns:
+//    1 if the event was in the queue, otherwise 0
+static unsigned char acknowledgeEvents(unsigned int eventId) {
+    // find the event
+    unsigned char count = 0;
+    unsigned char i = eventQueueTail;
+    while (i != eventQueueHead) {
+        count++;
+        if (eventQueue[i & (EVENT_QUEUE_SIZE-1)].eventId == eventId) break;
+        i++;
+    }
+    if (i == eventQueueHead) return 0;
+
+    // remove it and the events before it
+    while (count--) {
+        eventgenerator_acknowledge(eventQueue[eventQueueTail & (EVENT_QUEUE_SIZE-1)].egi);
+        eventQueueTail++;
+    }
+    return 1;
+}
+
+//*******************************************************************
+// processPollForPlataformEvent()
+//
+// respond to a PollForPlatformEvent command.  Events are sent as a
+// single part.  A poll acknowledges the event named in the request (if
+// it is queued) and returns the oldest event that remains.  When the
+// manager has set an event batch size greater than 1, several events
+// are returned in one response using the oem batch event class.  Each
+// event in the batch is preceded by its event id, event class and data
+// size, and the event id of the response is that of the last event, so
+// acknowledging it acknowledges the whole batch.
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -1059,27 +1052,136 @@ void getUuid(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void processCommandEventMessageSupported(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
+void processPollForPlatformEvent(PldmRequestHeader* rxHeader) {
+    if (!globalEventEnableState) {
+        // send error if events are not enabled
+        transmitResponse(rxHeader, RESPONSE_ERROR, 0, 0);
+        return;
+    }
     
+    unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+    unsigned char transferOperation = body[1];
+    unsigned int  eventIdToAcknowledge = body[6] | (body[7] << 8);
+
+    if (transferOperation==0x02) {
+        // acknowledge only
+        if (!acknowledgeEvents(eventIdToAcknowledge)) {
+            transmitResponse(rxHeader, RESPONSE_EVENT_ID_NOT_VALID, 0, 0);
+            return;
+        }
+        // send the response
+        responseBegin(rxHeader);
+        writeByte(tid);
+        if (eventQueueHead!=eventQueueTail) writeShort(0xFFFF); 
+        else writeShort(0x0000); 
+        responseCommit(RESPONSE_SUCCESS);
+        return;
+    }
+
+    // acknowledge the event from the previous poll
+    acknowledgeEvents(eventIdToAcknowledge);
+
+    responseBegin(rxHeader);
+    writeByte(tid);
+    if (eventQueueHead==eventQueueTail) {
+        // send the response - there was nothing to retrieve
+        writeShort(0x0000); 
+        responseCommit(RESPONSE_SUCCESS);
+        return;
+    }
+
+    // work out how many events fit in the response
+    unsigned char queued = eventQueueHead - eventQueueTail;
+    unsigned char space = TX_MESSAGE_SIZE - sizeof(PldmResponseHeader) - 13;
+    unsigned char count = 1;
+    unsigned int  dataSize = eventQueue[eventQueueTail & (EVENT_QUEUE_SIZE-1)].size;
+    if ((eventBatchSize > 1) && (queued > 1)) {
+        dataSize = 1;
+        count = 0;
+        while ((count < queued) && (count < eventBatchSize)) {
+            QueuedEvent *ev = &eventQueue[(eventQueueTail + count) & (EVENT_QUEUE_SIZE-1)];
+            if (dataSize + 4 + ev->size > space) break;
+            dataSize += 4 + ev->size;
+            count++;
+        }
+    }
+    QueuedEvent *last = &eventQueue[(eventQueueTail + count - 1) & (EVENT_QUEUE_SIZE-1)];
+
+    writeShort(last->eventId);
+    writeLong(0);                       // next data transfer handle
+    writeByte(0x05);                    // transfer flag = start and end
+    if (count == 1) {
+        writeByte(PLDM_EVENT_CLASS_SENSOR);
+        writeLong(dataSize);
+        for (unsigned char j = 0; j < last->size; j++) writeByte(last->data[j]);
+    } else {
+        writeByte(PLDM_EVENT_CLASS_OEM_BATCH);
+        writeLong(dataSize);
+        writeByte(count);
+        for (unsigned char i = 0; i < count; i++) {
+            QueuedEvent *ev = &eventQueue[(eventQueueTail + i) & (EVENT_QUEUE_SIZE-1)];
+            writeShort(ev->eventId);
+            writeByte(PLDM_EVENT_CLASS_SENSOR);
+            writeByte(ev->size);
+            for (unsigned char j = 0; j < ev->size; j++) writeByte(ev->data[j]);
+        }
+    }
+    responseCommit(RESPONSE_SUCCESS);
+}
+
+//*******************************************************************
+// setEventBatchSize()
+//
+// set the most events that a PollForPlatformEventMessage response may
+// return.  A size of 1 (the default) returns standard single events.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void setEventBatchSize(PldmRequestHeader* rxHeader) {
+    unsigned char size = *(((unsigned char*)rxHeader) + sizeof(PldmRequestHeader));
+    if ((size == 0) || (size > EVENT_QUEUE_SIZE)) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_DATA, 0, 0);
+        return;
+    }
+    eventBatchSize = size;
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, 0, 0);
+}
+
+//*******************************************************************
+// getFruTableMetadata()
+//
+// respond to a getFruTableMetadata command.  
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void getFruTableMetadata(PldmRequestHeader* rxHeader) {
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 4 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        transmitByte(globalEventEnableState);
-        transmitByte(0x04);  // polled mode support only
-        transmitByte(0x01);  // one class of event generated
-        transmitByte(0x00);  // sensor event class generated
-        mctp_transmitFrameEnd();
+    responseBegin(rxHeader);
+    writeByte(0x01);  // major version
+    writeByte(0x00);  // minor version
+    writeLong(FRU_TABLE_MAXIMUM_SIZE); 
+    writeLong(FRU_TOTAL_SIZE); 
+    writeShort(FRU_TOTAL_RECORD_SETS);
+    writeShort(FRU_NUMBER_OF_RECORDS);
+    writeLong(0x00000000);  // CRC32 - TODO: Calculate this checksum       
+    responseCommit(RESPONSE_SUCCESS);
 }
 
 //*******************************************************************
-// processSetEventReceiver()
+// getLinkStatistics()
 //
-// respond to a SetEventReceiver command.  Currently only polling
-// is supported by the device.
+// respond with the mctp link statistics.  Bit 0 of the request byte
+// asks for the statistics to be cleared once they have been read.  The
+// statistics structure is sent as-is since it has no padding and the
+// fields are already little-endian (see mctp_linkstats for the layout).
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -1087,25 +1189,99 @@ void processCommandEventMessageSupported(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void processSetEventReceiver(PldmRequestHeader* rxHeader) {
-    unsigned char enable = *((char*)(rxHeader+1));
+void getLinkStatistics(PldmRequestHeader* rxHeader) {
+    mctp_linkstats stats;
+    unsigned char clear = *(((unsigned char*)rxHeader) + sizeof(PldmRequestHeader));
+
+    mctp_getLinkStatistics(&stats);
+    if (clear & 0x01) mctp_clearLinkStatistics();
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, (unsigned char*)&stats, sizeof(stats));
+}
+
+//*******************************************************************
+// getSensorSnapshot()
+//
+// respond with a snapshot of every enabled sensor, all taken from the
+// same control cycle.  The body is the entry count followed by one
+// entry per sensor: the sensor id (2 bytes), the operational, present,
+// previous and event states, and for numeric sensors the 4-byte
+// FIXEDPOINT_24_8 reading.  The manager tells the entry types apart
+// from the sensor PDRs.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void getSensorSnapshot(PldmRequestHeader* rxHeader) {
+    unsigned char body[SENSOR_SNAPSHOT_MAX_SIZE];
+    unsigned char size;
+
+    #ifdef ENTITY_STEPPER1
+        unsigned char response = entityStepper1_getSensorSnapshot(body, &size);
+    #endif
+    #ifdef ENTITY_SERVO1
+        unsigned char response = entityServo1_getSensorSnapshot(body, &size);
+    #endif
+    #ifdef ENTITY_PID1
+        unsigned char response = entityPid1_getSensorSnapshot(body, &size);
+    #endif
+    #ifdef ENTITY_SIMPLE1
+        unsigned char response = entitySimple1_getSensorSnapshot(body, &size);
+    #endif
 
     // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5, 1);
-    transmitByte(rxHeader->flags1 & 0x7f);
-    transmitByte(rxHeader->flags2);
-    transmitByte(rxHeader->command);
-    if ((enable==0)||(enable==2)) transmitByte(RESPONSE_SUCCESS);
-    else transmitByte(RESPONSE_ENABLE_METHOD_NOT_SUPPORTED);
-
-    globalEventEnableState = 0;
-    if (enable==2) globalEventEnableState = 1;
+    transmitResponse(rxHeader, response, body, size);
 }
 
 //*******************************************************************
-// processPollForPlataformEvent()
+// lookupSources()
 //
-// respond to a PollForPlatformEvent command.  C
+// look up the values that the control isr samples for a list of
+// sensor ids taken from a request.
+//
+// parameters:
+//    ids - the sensor ids (little-endian, two bytes each)
+//    count - the number of sensor ids
+//    sources - receives the location and size of each value
+// returns:
+//    1 if every sensor exists, otherwise 0
+#if defined(TELEMETRY) || defined(CAPTURE)
+static unsigned char lookupSources(const unsigned char *ids, unsigned char count, TelemetrySource *sources) {
+    for (unsigned char i = 0; i < count; i++) {
+        unsigned int sensorId = ids[2*i] | (ids[2*i + 1] << 8);
+        unsigned char found = 0;
+        #ifdef ENTITY_STEPPER1
+            found = entityStepper1_getTelemetrySource(sensorId, &sources[i]);
+        #endif
+        #ifdef ENTITY_SERVO1
+            found = entityServo1_getTelemetrySource(sensorId, &sources[i]);
+        #endif
+        #ifdef ENTITY_PID1
+            found = entityPid1_getTelemetrySource(sensorId, &sources[i]);
+        #endif
+        #ifdef ENTITY_SIMPLE1
+            found = entitySimple1_getTelemetrySource(sensorId, &sources[i]);
+        #endif
+        if (!found) return 0;
+    }
+    return 1;
+}
+#endif
+
+//*******************************************************************
+// subscribeTelemetry()
+//
+// start streaming the values of the selected sensors to the manager.
+// The request holds the decimation (the number of control cycles
+// between samples), the frame budget (the number of frames to send,
+// or 0 to stream until stopped), the sensor count and then the sensor
+// ids.  An optional last byte selects the frame encoding (raw if it is
+// absent).  A sensor count of 0 stops the stream.  The frames
+// themselves are sent to the subscriber by telemetry_update().  The
+// command is only built (and advertised) when the firmware is built
+// with TELEMETRY.
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -1113,75 +1289,544 @@ void processSetEventReceiver(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void processPollForPlatformEvent(PldmRequestHeader* rxHeader) {
-    if (!globalEventEnableState) {
-        // send error if events are not enabled
-        mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(RESPONSE_ERROR);   // completion code
-        mctp_transmitFrameEnd();
+#ifdef TELEMETRY
+void subscribeTelemetry(PldmRequestHeader* rxHeader) {
+    unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+    unsigned int  decimation = *((unsigned int*)&body[0]);
+    unsigned int  frameBudget = *((unsigned int*)&body[2]);
+    unsigned char count = body[4];
+    TelemetrySource sources[TELEMETRY_MAX_SENSORS];
+
+    if (count == 0) {
+        telemetry_stop();
+        transmitResponse(rxHeader, RESPONSE_SUCCESS, 0, 0);
+        return;
+    }
+    if (mctp_getPacketLength() - sizeof(PldmRequestHeader) < 5 + 2*count) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_LENGTH, 0, 0);
+        return;
+    }
+    unsigned char encoding = TELEMETRY_ENCODING_RAW;
+    if (mctp_getPacketLength() - sizeof(PldmRequestHeader) > 5 + 2*count) encoding = body[5 + 2*count];
+    if ((count > TELEMETRY_MAX_SENSORS) || (decimation == 0) || (encoding > TELEMETRY_ENCODING_DELTA)) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_DATA, 0, 0);
         return;
     }
-    
-    // note: for simplicity, this function sends events as a
-    // single transfer.  It is assumed that acknowledgements
-    // always are targeted at the correct ID.
-    unsigned char transferOperation = *(((char*)(rxHeader+1))+1);
 
-    if (transferOperation==0x02) {
-        // acknowledge only
-        if (eventFifoInsertId!=eventFifoExtractId) {    
-            // there are items in the fifo - call the entity to
-            // acknowledge the current event
-#ifdef ENTITY_SIMPLE1
-            entitySimple1_acknowledgeEvent(eventFifoExtractId);
+    // look up each of the sensors
+    if (!lookupSources(&body[5], count, sources)) {
+        transmitResponse(rxHeader, RESPONSE_INVALID_SENSOR_ID, 0, 0);
+        return;
+    }
+
+    telemetry_start(sources, count, decimation, frameBudget, encoding, mctp_getPacketSource());
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, 0, 0);
+}
+#endif
+
+//*******************************************************************
+// configureCapture()
+//
+// arm a triggered capture of control loop values.  The request holds
+// the decimation (the number of control cycles between rows), the
+// number of pre-trigger rows, the trigger condition, the index of the
+// channel that the trigger tests, the trigger threshold (32 bits), the
+// channel count and then the sensor ids of the channels.  A channel
+// count of 0 stops the capture.  The response holds the number of rows
+// that the capture will record.  The capture commands are only built
+// (and advertised) when the firmware is built with CAPTURE.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+#ifdef CAPTURE
+void configureCapture(PldmRequestHeader* rxHeader) {
+    unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+    unsigned int  decimation = *((unsigned int*)&body[0]);
+    unsigned int  preTrigger = *((unsigned int*)&body[2]);
+    unsigned char condition = body[4];
+    unsigned char triggerChannel = body[5];
+    long          threshold = *((long*)&body[6]);
+    unsigned char count = body[10];
+    TelemetrySource sources[CAPTURE_MAX_CHANNELS];
+
+    if (count == 0) {
+        capture_stop();
+        transmitResponse(rxHeader, RESPONSE_SUCCESS, 0, 0);
+        return;
+    }
+    if (mctp_getPacketLength() - sizeof(PldmRequestHeader) < 11 + 2*count) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_LENGTH, 0, 0);
+        return;
+    }
+    if (count > CAPTURE_MAX_CHANNELS) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_DATA, 0, 0);
+        return;
+    }
+    if (!lookupSources(&body[11], count, sources)) {
+        transmitResponse(rxHeader, RESPONSE_INVALID_SENSOR_ID, 0, 0);
+        return;
+    }
+
+    unsigned int rows = capture_arm(sources, count, decimation, preTrigger, condition, triggerChannel, threshold);
+    if (!rows) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_DATA, 0, 0);
+        return;
+    }
+    unsigned char response[] = { rows & 0xff, rows >> 8 };
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, response, sizeof(response));
+}
+
+//*******************************************************************
+// getCaptureStatus()
+//
+// report the state of the triggered capture (see capture_writeStatus()).
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void getCaptureStatus(PldmRequestHeader* rxHeader) {
+    unsigned char body[CAPTURE_STATUS_SIZE];
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, body, capture_writeStatus(body));
+}
+
+// the most capture data sent in one part of a readCapture response.  The
+// response stays within the mctp staging area.
+#define CAPTURE_READ_CHUNK_SIZE 32
+
+//*******************************************************************
+// readCapture()
+//
+// read a completed capture using the same multipart transfer as
+// getFruRecordTable.  The data transfer handle is the byte offset
+// within the capture, so a part may be requested again if its
+// response is lost.  The rows are sent oldest first, each holding the
+// channel values in the order that they were configured.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void readCapture(PldmRequestHeader* rxHeader) {
+    unsigned char *body = ((unsigned char*)rxHeader) + sizeof(PldmRequestHeader);
+    unsigned long dataTransferHandle = *((unsigned long*)&body[0]);
+    unsigned char transferOperationFlag = body[4];
+    unsigned int  size = capture_getSize();
+
+    if (size == 0) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_NOT_READY, 0, 0);
+        return;
+    }
+    if (transferOperationFlag > 0x01) {
+        transmitResponse(rxHeader, RESPONSE_INVALID_TRANSFER_OPERATION_FLAG, 0, 0);
+        return;
+    }
+    if ((dataTransferHandle >= size) || ((transferOperationFlag == 0x01) && (dataTransferHandle != 0))) {
+        transmitResponse(rxHeader, RESPONSE_INVALID_DATA_TRANSFER_HANDLE, 0, 0);
+        return;
+    }
+
+    unsigned char response[5 + CAPTURE_READ_CHUNK_SIZE];
+    unsigned char count = capture_read(dataTransferHandle, &response[5], CAPTURE_READ_CHUNK_SIZE);
+    unsigned long nextHandle = dataTransferHandle + count;
+    unsigned char transferFlag = (dataTransferHandle == 0) ? 0x00 : 0x01;  // start or middle
+    if (nextHandle >= size) {
+        transferFlag = (dataTransferHandle == 0) ? 0x05 : 0x04;            // start and end, or end
+        nextHandle = 0;
+    }
+    response[0] = nextHandle & 0xff;
+    response[1] = (nextHandle >> 8) & 0xff;
+    response[2] = (nextHandle >> 16) & 0xff;
+    response[3] = nextHandle >> 24;
+    response[4] = transferFlag;
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, response, 5 + count);
+}
 #endif
+
+//*******************************************************************
+// setSensorStatistics()
+//
+// enable or disable the windowed statistics of a numeric sensor.  The
+// request holds the sensor id, the enable (0 or 1) and the number of
+// samples in each window (0 to accumulate until the statistics are
+// read with a reset).
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void setSensorStatistics(PldmRequestHeader* rxHeader) {
+    #ifdef ENTITY_STEPPER1
+        unsigned char response = entityStepper1_setSensorStatistics(rxHeader);
+    #endif
+    #ifdef ENTITY_SERVO1
+        unsigned char response = entityServo1_setSensorStatistics(rxHeader);
+    #endif
+    #ifdef ENTITY_PID1
+        unsigned char response = entityPid1_setSensorStatistics(rxHeader);
+    #endif
+    #ifdef ENTITY_SIMPLE1
+        unsigned char response = entitySimple1_setSensorStatistics(rxHeader);
+    #endif
+
+    // send the response
+    transmitResponse(rxHeader, response, 0, 0);
+}
+
+//*******************************************************************
+// getSensorStatistics()
+//
+// read the windowed statistics of a numeric sensor.  The request holds
+// the sensor id and a reset flag (1 to start a new accumulation once
+// the statistics have been read).  The response body is described by
+// numericsensor_writeStatistics().
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void getSensorStatistics(PldmRequestHeader* rxHeader) {
+    unsigned char body[NUMERICSENSOR_STATISTICS_SIZE];
+    unsigned char size;
+
+    #ifdef ENTITY_STEPPER1
+        unsigned char response = entityStepper1_getSensorStatistics(rxHeader, body, &size);
+    #endif
+    #ifdef ENTITY_SERVO1
+        unsigned char response = entityServo1_getSensorStatistics(rxHeader, body, &size);
+    #endif
+    #ifdef ENTITY_PID1
+        unsigned char response = entityPid1_getSensorStatistics(rxHeader, body, &size);
+    #endif
+    #ifdef ENTITY_SIMPLE1
+        unsigned char response = entitySimple1_getSensorStatistics(rxHeader, body, &size);
+    #endif
+
+    // send the response
+    transmitResponse(rxHeader, response, body, size);
+}
+
+//*******************************************************************
+// queueMove()
+//
+// add a move to the blended motion path of the entity.  The request
+// holds the final position, the plateau velocity and the acceleration.
+// The response holds the number of free entries left in the queue.
+// The command is only built (and advertised) for the stepper entity,
+// which is the only one with a motion profile.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
 #ifdef ENTITY_STEPPER1
-            entityStepper1_acknowledgeEvent(eventFifoExtractId);
+void queueMove(PldmRequestHeader* rxHeader) {
+    unsigned char body[1];
+    unsigned char size = 0;
+    unsigned char response = entityStepper1_queueMove(rxHeader, body, &size);
+
+    // send the response
+    transmitResponse(rxHeader, response, body, size);
+}
 #endif
-            // "remove the event from the fifo"
-            eventFifoExtractId = (eventFifoExtractId+1)&0xF;
-        } 
-        // send the response
-        mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 3 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(RESPONSE_SUCCESS);   // completion code
-        transmitByte(tid);
-        if (eventFifoInsertId!=eventFifoExtractId) transmitShort(0xFFFF); 
-        else transmitShort(0x0000); 
-        mctp_transmitFrameEnd();
-    } else {
-        if (eventFifoInsertId!=eventFifoExtractId) {
-            // there are items in the FIFO - call the entity to
-            // respond to this request
-#ifdef ENTITY_SIMPLE1
-            entitySimple1_respondToPollEvent(rxHeader, eventFifoInsertId, eventFifoExtractId);
+
+//*******************************************************************
+// getIsrProfile()
+//
+// respond with the execution time statistics of each isr source (see
+// isrprofile.h).  Bit 0 of the request byte asks for the statistics to
+// be cleared once they have been read.  The command is only built (and
+// advertised) when the firmware is built with ISR_PROFILE.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+#ifdef ISR_PROFILE
+void getIsrProfile(PldmRequestHeader* rxHeader) {
+    isrprofile_stats stats[ISRPROFILE_SOURCES];
+    unsigned char clear = *(((unsigned char*)rxHeader) + sizeof(PldmRequestHeader));
+
+    isrprofile_getStats(stats);
+    if (clear & 0x01) isrprofile_clear();
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, (unsigned char*)stats, sizeof(stats));
+}
 #endif
+
+//*******************************************************************
+// setBaudRate()
+//
+// change the baud rate of the serial link.  The response is sent at the
+// current rate and the new rate takes effect once it has been sent.
+// The manager must send a request at the new rate within
+// BAUD_CONFIRM_TIMEOUT_MS or the node falls back to the current rate.
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void setBaudRate(PldmRequestHeader* rxHeader) {
+    unsigned long baud = *((unsigned long*)(((unsigned char*)rxHeader) + sizeof(PldmRequestHeader)));
+    unsigned long current = uart_getBaudRate();
+
+    // nothing changes if the rate is already in use
+    if (baud != current) {
+        if ((baudState != BAUD_IDLE) || (!uart_isBaudRateSupported(baud))) {
+            transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_DATA, 0, 0);
+            return;
+        }
+        baudPrevious = current;
+        baudNew = baud;
+        baudState = BAUD_SWITCH_PENDING;
+    }
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, 0, 0);
+}
+
+//*******************************************************************
+// updateBaudRate()
+//
+// advance the baud rate change state machine.  This switches to the new
+// rate once the transmitter is idle and falls back to the previous rate
+// if the change is not confirmed in time.
+//
+// parameters:
+//    none
+// returns:
+//    void
+static void updateBaudRate() {
+    switch (baudState) {
+    case BAUD_SWITCH_PENDING:
+        if (!uart_isTxComplete()) break;
+        uart_setBaudRate(baudNew);
+        delay_set(BAUD_DELAY_INSTANCE, BAUD_CONFIRM_TIMEOUT_MS);
+        baudState = BAUD_CONFIRM_PENDING;
+        break;
+    case BAUD_CONFIRM_PENDING:
+        if (!delay_isDone(BAUD_DELAY_INSTANCE)) break;
+        uart_setBaudRate(baudPrevious);
+        baudState = BAUD_IDLE;
+        break;
+    }
+}
+
+//*******************************************************************
+// getPdrRepositoryInfo()
+//
+// respond by sending information about the pdr repository
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+static void getPdrRepositoryInfo(PldmRequestHeader* rxHeader) {
+    responseBegin(rxHeader);
+    writeByte(0);                  // repository state = available
+    for (int i=0;i<13;i++) writeByte(0); // update time
+    for (int i=0;i<13;i++) writeByte(0); // oem update time
+    writeLong(PDR_NUMBER_OF_RECORDS);            // pdr record count
+    writeLong(PDR_TOTAL_SIZE);   // repository size
+    writeLong(PDR_MAX_RECORD_SIZE);  // record size
+    writeByte(0);                  // no timeout
+    responseCommit(RESPONSE_SUCCESS);
+}
+
+void getPldmTypes(PldmRequestHeader* rxHeader);
+void getPldmCommands(PldmRequestHeader* rxHeader);
+
+//*******************************************************************
+// PLDM command registry
+//
+// Every supported command is listed once here with its pldm type,
+// command code, minimum request length (bytes following the request
+// header) and handler.  The dispatch tables and the bitmaps reported by
+// GetPLDMTypes and GetPLDMCommands are generated from these lists, so a
+// command cannot be handled without being advertised.
+#define PLDM_BASE_COMMANDS(X) \
+    X(PLDM_TYPE_BASE,     CMD_SET_TID,                         1,  setTid) \
+    X(PLDM_TYPE_BASE,     CMD_GET_TID,                         0,  getTid) \
+    X(PLDM_TYPE_BASE,     CMD_GET_PLDM_VERSION,                6,  getPldmVersion) \
+    X(PLDM_TYPE_BASE,     CMD_GET_PLDM_TYPES,                  0,  getPldmTypes) \
+    X(PLDM_TYPE_BASE,     CMD_GET_PLDM_COMMANDS,               5,  getPldmCommands)
+
+#define PLDM_PLATFORM_COMMANDS(X) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_TERMINUS_UID,                0,  getUuid) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_EVENT_RECEIVER,              3,  processSetEventReceiver) \
+    X(PLDM_TYPE_PLATFORM, CMD_POLL_FOR_PLATFORM_EVENT_MESSAGE, 8,  processPollForPlatformEvent) \
+    X(PLDM_TYPE_PLATFORM, CMD_EVENT_MESSAGE_SUPPORTED,         1,  processCommandEventMessageSupported) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_NUMERIC_SENSOR_ENABLE,       4,  setNumericSensorEnable) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_SENSOR_READING,              3,  getSensorReading) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_STATE_SENSOR_ENABLES,        5,  setStateSensorEnables) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_STATE_SENSOR_READINGS,       4,  getStateSensorReading) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_NUMERIC_EFFECTER_ENABLE,     3,  setNumericEffecterEnable) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_NUMERIC_EFFECTER_VALUE,      4,  setNumericEffecterValue) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_NUMERIC_EFFECTER_VALUE,      2,  getNumericEffecterValue) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_STATE_EFFECTER_ENABLES,      5,  setStateEffecterEnables) \
+    X(PLDM_TYPE_PLATFORM, CMD_SET_STATE_EFFECTER_STATES,       5,  setStateEffecterStates) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_STATE_EFFECTER_STATES,       2,  getStateEffecterStates) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_PDR_REPOSITORY_INFO,         0,  getPdrRepositoryInfo) \
+    X(PLDM_TYPE_PLATFORM, CMD_GET_PDR,                         13, processCommandGetPdr)
+
+#define PLDM_FRU_COMMANDS(X) \
+    X(PLDM_TYPE_FRU,      CMD_GET_FRU_TABLE_METADATA,          0,  getFruTableMetadata) \
+    X(PLDM_TYPE_FRU,      CMD_GET_FRU_RECORD_TABLE,            5,  processCommandFruTable)
+
+#define PLDM_OEM_COMMANDS(X) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_GET_LINK_STATISTICS,         1,  getLinkStatistics) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_SET_BAUD_RATE,               4,  setBaudRate) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_GET_SENSOR_SNAPSHOT,         0,  getSensorSnapshot) \
+    PLDM_TELEMETRY_COMMANDS(X) \
+    PLDM_CAPTURE_COMMANDS(X) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_SET_SENSOR_STATISTICS,       5,  setSensorStatistics) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_GET_SENSOR_STATISTICS,       3,  getSensorStatistics) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_SET_EVENT_BATCH_SIZE,        1,  setEventBatchSize) \
+    PLDM_MOTION_COMMANDS(X) \
+    PLDM_ISR_PROFILE_COMMANDS(X)
+
+// commands that are only built into some firmware
 #ifdef ENTITY_STEPPER1
-            entityStepper1_respondToPollEvent(rxHeader, eventFifoInsertId, eventFifoExtractId);
+#define PLDM_MOTION_COMMANDS(X) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_QUEUE_MOVE,                 12,  queueMove)
+#else
+#define PLDM_MOTION_COMMANDS(X)
 #endif
-        } else {
-            // send the response - there was nothing to retrieve
-            mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 3 + 1 + 5, 1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_SUCCESS);   // completion code
-            transmitByte(tid);
-            transmitShort(0x00); 
-            mctp_transmitFrameEnd();
-        }
+
+#ifdef TELEMETRY
+#define PLDM_TELEMETRY_COMMANDS(X) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_SUBSCRIBE_TELEMETRY,         5,  subscribeTelemetry)
+#else
+#define PLDM_TELEMETRY_COMMANDS(X)
+#endif
+
+#ifdef CAPTURE
+#define PLDM_CAPTURE_COMMANDS(X) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_CONFIGURE_CAPTURE,          11,  configureCapture) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_GET_CAPTURE_STATUS,          0,  getCaptureStatus) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_READ_CAPTURE,                5,  readCapture)
+#else
+#define PLDM_CAPTURE_COMMANDS(X)
+#endif
+
+#ifdef ISR_PROFILE
+#define PLDM_ISR_PROFILE_COMMANDS(X) \
+    X(PLDM_TYPE_OEM,      CMD_OEM_GET_ISR_PROFILE,             1,  getIsrProfile)
+#else
+#define PLDM_ISR_PROFILE_COMMANDS(X)
+#endif
+
+#define PLDM_ALL_COMMANDS(X) \
+    PLDM_BASE_COMMANDS(X) PLDM_PLATFORM_COMMANDS(X) PLDM_FRU_COMMANDS(X) PLDM_OEM_COMMANDS(X)
+
+typedef void (*PldmCommandHandler)(PldmRequestHeader* rxHeader);
+
+typedef struct {
+    unsigned char      type;
+    unsigned char      command;
+    unsigned char      minLength;   // minimum request length after the header
+    PldmCommandHandler handler;
+} PldmCommandEntry;
+
+// the position of each command in the registry
+#define COMMAND_INDEX(type, command, length, handler) COMMAND_INDEX_##handler,
+enum { PLDM_ALL_COMMANDS(COMMAND_INDEX) PLDM_COMMAND_COUNT };
+
+#define COMMAND_ENTRY(type, command, length, handler) { type, command, length, handler },
+static const PldmCommandEntry pldmCommands[PLDM_COMMAND_COUNT] PROGMEM = {
+    PLDM_ALL_COMMANDS(COMMAND_ENTRY)
+};
+
+// per-type tables indexed by command code, holding the registry index
+// of the command plus one (0 if the command is not supported)
+#define COMMAND_LOOKUP(type, command, length, handler) [command] = COMMAND_INDEX_##handler + 1,
+static const unsigned char baseCommandLookup[] PROGMEM = { PLDM_BASE_COMMANDS(COMMAND_LOOKUP) };
+static const unsigned char platformCommandLookup[] PROGMEM = { PLDM_PLATFORM_COMMANDS(COMMAND_LOOKUP) };
+static const unsigned char fruCommandLookup[] PROGMEM = { PLDM_FRU_COMMANDS(COMMAND_LOOKUP) };
+static const unsigned char oemCommandLookup[] PROGMEM = { PLDM_OEM_COMMANDS(COMMAND_LOOKUP) };
+
+typedef struct {
+    const unsigned char *lookup;
+    unsigned char        size;
+} PldmTypeEntry;
+
+// supported pldm types, indexed by the type slot in pldmTypeSlot
+static const PldmTypeEntry pldmTypes[] PROGMEM = {
+    { baseCommandLookup,     sizeof(baseCommandLookup) },
+    { platformCommandLookup, sizeof(platformCommandLookup) },
+    { fruCommandLookup,      sizeof(fruCommandLookup) },
+    { oemCommandLookup,      sizeof(oemCommandLookup) }
+};
+
+// pldm type to slot in pldmTypes plus one (0 if the type is not supported)
+static const unsigned char pldmTypeSlot[64] PROGMEM = {
+    [PLDM_TYPE_BASE] = 1, [PLDM_TYPE_PLATFORM] = 2, [PLDM_TYPE_FRU] = 3, [PLDM_TYPE_OEM] = 4
+};
+
+//*******************************************************************
+// findCommand()
+//
+// look up a command in the registry.  This is two table reads, no
+// matter how many commands are supported.
+//
+// parameters:
+//    type - the pldm type
+//    command - the command code
+// returns:
+//    a pointer to the registry entry (in program memory) or 0 if the
+//    command is not supported
+static const PldmCommandEntry *findCommand(unsigned char type, unsigned char command) {
+    unsigned char slot = pgm_read_byte(&pldmTypeSlot[type & 0x3f]);
+    if (!slot) return 0;
+    const PldmTypeEntry *typeEntry = &pldmTypes[slot - 1];
+    if (command >= pgm_read_byte(&typeEntry->size)) return 0;
+    unsigned char index = pgm_read_byte((const unsigned char *)pgm_read_ptr(&typeEntry->lookup) + command);
+    if (!index) return 0;
+    return &pldmCommands[index - 1];
+}
+
+//*******************************************************************
+// getPldmTypes()
+//
+// respond by sending the Pldm types supported by this node
+//
+// parameters:
+//    rxHeader - a pointer to the request header
+// returns:
+//    void
+// changes:
+//    the contents of the transmit buffer
+void getPldmTypes(PldmRequestHeader* rxHeader) {
+    unsigned char types[8];
+    memset(types, 0, sizeof(types));
+    for (unsigned char i = 0; i < 64; i++) {
+        if (pgm_read_byte(&pldmTypeSlot[i])) types[i >> 3] |= 1 << (i & 0x07);
     }
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, types, sizeof(types));
 }
 
 //*******************************************************************
-// getFruTableMetadata()
+// getPldmCommands()
 //
-// respond to a getFruTableMetadata command.  
+// respond by sending the commands supported by this node for the
+// requested pldm type
 //
 // parameters:
 //    rxHeader - a pointer to the request header
@@ -1189,30 +1834,115 @@ void processPollForPlatformEvent(PldmRequestHeader* rxHeader) {
 //    void
 // changes:
 //    the contents of the transmit buffer
-void getFruTableMetadata(PldmRequestHeader* rxHeader) {
-    unsigned char response_code = RESPONSE_SUCCESS;
-    
-    // send the response
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 18 + 1 + 5, 1);
-        transmitByte(rxHeader->flags1 & 0x7f);
-        transmitByte(rxHeader->flags2);
-        transmitByte(rxHeader->command);
-        transmitByte(response_code);   // completion code
-        transmitByte(0x01);  // major version
-        transmitByte(0x00);  // minor version
-        transmitLong(FRU_TABLE_MAXIMUM_SIZE); 
-        transmitLong(FRU_TOTAL_SIZE); 
-        transmitShort(FRU_TOTAL_RECORD_SETS);
-        transmitShort(FRU_NUMBER_OF_RECORDS);
-        transmitLong(0x00000000);  // CRC32 - TODO: Calculate this checksum       
-        mctp_transmitFrameEnd();
+void getPldmCommands(PldmRequestHeader* rxHeader) {
+    unsigned char type = *(((unsigned char*)rxHeader) + sizeof(PldmRequestHeader));
+    unsigned char commands[32];
+
+    if ((type > 0x3f) || (!pgm_read_byte(&pldmTypeSlot[type]))) {
+        transmitResponse(rxHeader, RESPONSE_INVALID_PLDM_TYPE_IN_REQUEST_DATA, 0, 0);
+        return;
+    }
+    memset(commands, 0, sizeof(commands));
+    for (unsigned char i = 0; i < PLDM_COMMAND_COUNT; i++) {
+        if (pgm_read_byte(&pldmCommands[i].type) != type) continue;
+        unsigned char command = pgm_read_byte(&pldmCommands[i].command);
+        commands[command >> 3] |= 1 << (command & 0x07);
+    }
+    transmitResponse(rxHeader, RESPONSE_SUCCESS, commands, sizeof(commands));
+}
+
+//===================================================================
+// pushEvent()
+//
+// send the oldest queued event to the event receiver as a
+// PlatformEventMessage request and start the response timer.
+//
+// parameters: none
+// returns: nothing
+static void pushEvent()
+{
+    QueuedEvent *ev = &eventQueue[eventQueueTail & (EVENT_QUEUE_SIZE-1)];
+
+    // pldm request, header version = 00, pldm type = platform
+    messageBegin(0x80 | pushInstanceId, PLDM_TYPE_PLATFORM, CMD_PLATFORM_EVENT_MESSAGE);
+    writeByte(0x01);                    // format version
+    writeByte(tid);
+    writeByte(PLDM_EVENT_CLASS_SENSOR);
+    for (unsigned char i = 0; i < ev->size; i++) writeByte(ev->data[i]);
+    requestCommit(eventReceiverEid);
+
+    pushEventId = ev->eventId;
+    pushAttempts++;
+    delay_set(EVENT_PUSH_DELAY_INSTANCE, EVENT_PUSH_TIMEOUT_MS);
+    pushState = PUSH_WAITING;
+}
+
+//===================================================================
+// updateEventPush()
+//
+// run the asynchronous event push state machine: send the oldest
+// queued event when the transmitter is free and resend it if the
+// receiver does not respond in time.
+//
+// parameters: none
+// returns: nothing
+static void updateEventPush()
+{
+    if (globalEventEnableState != EVENTS_ASYNC) return;
+
+    switch (pushState) {
+    case PUSH_IDLE:
+        if ((eventQueueHead == eventQueueTail) || (!mctp_isTransmitIdle())) break;
+        pushInstanceId = (pushInstanceId + 1) & 0x1f;
+        pushAttempts = 0;
+        pushEvent();
+        break;
+    case PUSH_WAITING:
+        if (!delay_isDone(EVENT_PUSH_DELAY_INSTANCE)) break;
+        if ((eventQueueHead == eventQueueTail) ||
+            (eventQueue[eventQueueTail & (EVENT_QUEUE_SIZE-1)].eventId != pushEventId)) {
+            // the event was acknowledged by a poll in the meantime
+            pushState = PUSH_IDLE;
+        } else if (pushAttempts >= EVENT_PUSH_MAX_ATTEMPTS) {
+            pushState = PUSH_FAILED;
+        } else if (mctp_isTransmitIdle()) {
+            pushEvent();
+        }
+        break;
+    }
+}
+
+//===================================================================
+// processResponse()
+//
+// handle a response to a request sent by this node.  A successful
+// response to the PlatformEventMessage that is waiting removes the
+// event from the queue so that the next one can be sent.
+//
+// parameters:
+//    rxHeader - a pointer to the response header
+//    length - the length of the response
+// returns: nothing
+static void processResponse(PldmResponseHeader* rxHeader, unsigned char length)
+{
+    if (length < sizeof(PldmResponseHeader)) return;
+    if ((rxHeader->command != CMD_PLATFORM_EVENT_MESSAGE) || (pushState != PUSH_WAITING)) return;
+    if ((rxHeader->flags1 & 0x1f) != pushInstanceId) return;
+    if (mctp_getPacketSource() != eventReceiverEid) return;
+
+    if (rxHeader->completionCode == RESPONSE_SUCCESS) {
+        acknowledgeEvents(pushEventId);
+        pushState = PUSH_IDLE;
+    }
 }
 
 //*******************************************************************
 // parseCommand()
 //
 // parse a new PLDM command and take appropriate action.  It is assumed
-// that the new PLDM request is stored in the rx buffer.
+// that the new PLDM request is stored in the rx buffer.  The command is
+// looked up in the command registry, its length is checked, and then
+// its handler is called.
 //
 // parameters:
 //    none
@@ -1225,126 +1955,33 @@ static void parseCommand()
     // cast the relevant portions of the header so that
     // they are easier to use later.
     PldmRequestHeader* rxHeader = (PldmRequestHeader*)mctp_getPacket();
+    unsigned char length = mctp_getPacketLength();
 
-    // switch based on the command and type in the header
-    if (((rxHeader->flags2)&0x3f)==0) {
-        // PLDM Messanging Control and Discovery
-        switch (rxHeader->command) {
-        case CMD_GET_TID:
-            getTid(rxHeader);
-            break;
-        case CMD_SET_TID:
-            setTid(rxHeader);
-            break;
-        case CMD_GET_PLDM_VERSION:
-            getPldmVersion(rxHeader);
-            break;
-        case CMD_GET_PLDM_TYPES:
-            getPldmTypes(rxHeader);
-            break;
-        case CMD_GET_PLDM_COMMANDS:
-            getPldmCommands(rxHeader);
-            break;
-        default:
-            mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 5 + 1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_ERROR_UNSUPPORTED_PLDM_CMD);   // completion code
-            break;
-        }
-    } else if (((rxHeader->flags2)&0x3f)==2) {
-        // PLDM for Platform Monitoring and Control
-        switch (rxHeader->command) {
-        case CMD_GET_TERMINUS_UID:
-            getUuid(rxHeader);
-            break;
-        case CMD_GET_SENSOR_READING:
-            getSensorReading(rxHeader);
-            break;
-        case CMD_SET_NUMERIC_SENSOR_ENABLE:
-            setNumericSensorEnable(rxHeader);
-            break;
-        case CMD_GET_STATE_SENSOR_READINGS:
-            getStateSensorReading(rxHeader);
-            break;
-        case CMD_SET_STATE_SENSOR_ENABLES:
-            setStateSensorEnables(rxHeader);
-            break;
-        case CMD_SET_NUMERIC_EFFECTER_VALUE:
-            setNumericEffecterValue(rxHeader);
-            break;
-        case CMD_GET_NUMERIC_EFFECTER_VALUE:
-            getNumericEffecterValue(rxHeader);
-            break;
-        case CMD_SET_STATE_EFFECTER_STATES:
-            setStateEffecterStates(rxHeader);
-            break;
-        case CMD_GET_STATE_EFFECTER_STATES:
-            getStateEffecterStates(rxHeader);
-            break;
-        case CMD_GET_PDR_REPOSITORY_INFO:
-        {
-            mctp_transmitFrameStart(sizeof(GetPdrRepositoryInfoResponse) + sizeof(PldmRequestHeader) + 5,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_SUCCESS);   // completion code
-            transmitByte(0);                  // repository state = available
-            for (int i=0;i<13;i++) transmitByte(0); // update time
-            for (int i=0;i<13;i++) transmitByte(0); // oem update time
-            transmitLong(PDR_NUMBER_OF_RECORDS);            // pdr record count
-            transmitLong(PDR_TOTAL_SIZE);   // repository size
-            transmitLong(PDR_MAX_RECORD_SIZE);  // record size
-            transmitByte(0);                  // no timeout
-            mctp_transmitFrameEnd();
-            break;
-        }
-        case CMD_GET_PDR:
-            processCommandGetPdr(rxHeader);
-            break;
-        case CMD_SET_NUMERIC_EFFECTER_ENABLE:
-            setNumericEffecterEnable(rxHeader);
-            break;
-        case CMD_SET_STATE_EFFECTER_ENABLES:
-            setStateEffecterEnables(rxHeader);
-            break;
-        case CMD_EVENT_MESSAGE_SUPPORTED:
-            processCommandEventMessageSupported(rxHeader);
-            break;
-        case CMD_POLL_FOR_PLATFORM_EVENT_MESSAGE:
-            processPollForPlatformEvent(rxHeader);
-            break;
-        case CMD_SET_EVENT_RECEIVER:
-            processSetEventReceiver(rxHeader);
-            break;
-        default:
-            mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 5 + 1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_ERROR_UNSUPPORTED_PLDM_CMD);   // completion code
-            break;
-        }
-    } else if (((rxHeader->flags2)&0x3f)==4) {
-        // PLDM for FRU Data
-        switch (rxHeader->command) {
-        case CMD_GET_FRU_TABLE_METADATA:
-            getFruTableMetadata(rxHeader);
-            break;
-        case CMD_GET_FRU_RECORD_TABLE:
-            processCommandFruTable(rxHeader); 
-            break;
-        default:
-            mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 5 + 1,1);
-            transmitByte(rxHeader->flags1 & 0x7f);
-            transmitByte(rxHeader->flags2);
-            transmitByte(rxHeader->command);
-            transmitByte(RESPONSE_ERROR_UNSUPPORTED_PLDM_CMD);   // completion code
-            break;
-        }
-    } 
-    return;
+    // too short to even respond to
+    if (length < sizeof(PldmRequestHeader)) return;
+
+    // responses are to requests sent by this node
+    if (!(rxHeader->flags1 & 0x80)) {
+        processResponse((PldmResponseHeader*)rxHeader, length);
+        return;
+    }
+
+    // the manager is reachable again, so events may be pushed
+    if (pushState == PUSH_FAILED) pushState = PUSH_IDLE;
+
+    const PldmCommandEntry *entry = findCommand(rxHeader->flags2, rxHeader->command);
+    if (!entry) {
+        if (!pgm_read_byte(&pldmTypeSlot[(rxHeader->flags2)&0x3f]))
+            transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_PLDM_TYPE, 0, 0);
+        else
+            transmitResponse(rxHeader, RESPONSE_ERROR_UNSUPPORTED_PLDM_CMD, 0, 0);
+        return;
+    }
+    if (length - sizeof(PldmRequestHeader) < pgm_read_byte(&entry->minLength)) {
+        transmitResponse(rxHeader, RESPONSE_ERROR_INVALID_LENGTH, 0, 0);
+        return;
+    }
+    ((PldmCommandHandler)pgm_read_ptr(&entry->handler))(rxHeader);
 }
 
 //*******************************************************************
@@ -1359,10 +1996,11 @@ static void parseCommand()
 // returns:
 //    void
 void node_putCommand(PldmRequestHeader* hdr, unsigned char* command, unsigned int size) {
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + size +5,1);
-    mctp_transmitFrameData((unsigned char *)hdr,sizeof(PldmRequestHeader));
-    mctp_transmitFrameData(command,size);
-    mctp_transmitFrameEnd();
+    mctp_segment segments[] = {
+        MCTP_SEGMENT_RAM(hdr, sizeof(PldmRequestHeader)),
+        MCTP_SEGMENT_RAM(command, size)
+    };
+    mctp_transmitFrame(MCTP_TYPE_PLDM, segments, 2);
 }
 
 //*******************************************************************
@@ -1371,113 +2009,146 @@ void node_putCommand(PldmRequestHeader* hdr, unsigned char* command, unsigned in
 // Update the PLDM Rx finite state machine and return a pointer to 
 // the most recent message response if there is one.  If there
 // is no packet available, it returns 0.  If there is an MCTP 
-// control message, the message is consumed.
+// control message, the message is consumed.  The returned request
+// keeps its pool slot until the next call, so it stays valid for the
+// caller even when the framer runs in the uart receive interrupt.
 //
 // parameters: none
 // returns: a pointer to the most recent message response.
 //    void
+static unsigned char packetHeld = 0;
 unsigned char* node_getResponse(void) {
-    if (!mctp_isPacketAvailable()) {
-        mctp_updateRxFSM();
-        return 0;
-    } else {
-        parseCommand();               // process the command
-        return mctp_getPacket();  // clear the packet ready flag
+    unsigned char *packet;
+
+    // the caller is done with the previous request
+    if (packetHeld) {
+        mctp_releasePacket();
+        packetHeld = 0;
     }
+
+    // framing continues into the packet pool even while earlier packets
+    // are waiting to be processed
+    mctp_updateRxFSM();
+    updateBaudRate();
+
+    // if the previous responses are still being sent, leave the packet
+    // pending rather than waiting for the transmitter
+    if ((!mctp_isPacketAvailable()) || (!mctp_isTransmitReady())) return 0;
+
+    // any request received at a new baud rate confirms it
+    if (baudState == BAUD_CONFIRM_PENDING) baudState = BAUD_IDLE;
+
+    packet = mctp_getPacket();
+    parseCommand();               // process the command
+    packetHeld = 1;               // released on the next call
+    return packet;
+}
+
+//===================================================================
+// queueEvent()
+//
+// place an event in the event queue, giving it the next event id.
+// Event ids 0x0000 and 0xFFFF are reserved and are skipped.
+//
+// parameters:
+//    egi - event generator instance to acknowledge with the event
+//    data - the sensor event data
+//    size - the size of the event data (up to EVENT_DATA_SIZE bytes)
+// returns:
+//    1 if the event was queued, 0 if the queue is full
+static char queueEvent(EventGeneratorInstance* egi, const unsigned char *data, unsigned char size)
+{
+    if ((unsigned char)(eventQueueHead - eventQueueTail) == EVENT_QUEUE_SIZE) return 0;
+
+    QueuedEvent *ev = &eventQueue[eventQueueHead & (EVENT_QUEUE_SIZE-1)];
+    ev->egi = egi;
+    ev->eventId = eventNextId;
+    ev->size = size;
+    for (unsigned char i = 0; i < size; i++) ev->data[i] = data[i];
+    eventQueueHead++;
+
+    if (++eventNextId == 0xFFFF) eventNextId = 1;
+    return 1;
 }
 
 //===================================================================
-// sendNumericSensorEvent()
+// queueNumericSensorEvent()
 //
-// send a numeric sensor event based on the parameters passed to the
-// function.  This helper function is intended to be called by child
-// instances from within the high-priority loop.
+// queue a numeric sensor state change event, capturing the sensor
+// event data at the time of the event.  This helper function is
+// intended to be called by child instances from the main loop.
 //
 // parameters:
 //    egi - event generator instance related to this event.
 //    sensorId - the ID of the senosr that caused the event
+//    eventState - the sensor state that caused the event
+//    previousEventState - the sensor state before the event
 //    presentReading - the current reading of the sensor  
-void node_sendNumericSensorEvent(
-        PldmRequestHeader *rxHeader,
-        unsigned char more,
+// returns:
+//    1 if the event was queued, 0 if the queue is full
+char node_queueNumericSensorEvent(
         EventGeneratorInstance* egi, 
         unsigned int sensorId, 
+        unsigned char eventState, 
         unsigned char previousEventState, 
         FIXEDPOINT_24_8 presentReading
 ) 
 {  
-    // begin the event frame
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 13 + 5,1);
-    // transmit the header
-    transmitByte( 0x80 );    // pldm datagram request message type, instance ID 0
-    transmitByte( 0x00);     // header version = 00, pldm type = 0 (pldm messaging/discovery)
-    transmitByte( CMD_PLATFORM_EVENT_MESSAGE ); 
-
-    // transmit the platform event message common data
-    transmitByte(0x01);         // format version
-    transmitByte(0x01);         // terminus ID
-    transmitByte(0x00);         // event class 0 = sensor
-
-    // transmit the body
-    transmitShort(sensorId);
-    transmitByte(2);            // cause = numeric sensor state change
-    transmitByte(egi->eventState);
-    transmitByte(previousEventState);
-    transmitByte(5);            // reading is a signed 32-bit integer
-    transmitLong(presentReading);
-    mctp_transmitFrameEnd();
+    unsigned char data[] = {
+        sensorId & 0xff, sensorId >> 8,
+        2,                  // sensor event class = numeric sensor state change
+        eventState,
+        previousEventState,
+        5,                  // reading is a signed 32-bit integer
+        presentReading & 0xff, (presentReading >> 8) & 0xff,
+        (presentReading >> 16) & 0xff, (presentReading >> 24) & 0xff
+    };
+    return queueEvent(egi, data, sizeof(data));
 }
 
 //===================================================================
-// sendStateSensorEvent()
+// queueStateSensorEvent()
 //
-// send a state sensor event based on the parameters passed to the
-// function.  This helper function is intended to be called by child
-// instances from within the high-priority loop.
+// queue a state sensor state change event, capturing the sensor event
+// data at the time of the event.  This helper function is intended to
+// be called by child instances from the main loop.
 //
 // parameters:
 //    egi - event generator instance related to this event.
 //    sensorId - the ID of the senosr that caused the event
-void node_sendStateSensorEvent(
-        PldmRequestHeader *rxHeader,
-        unsigned char more,
+//    eventState - the sensor state that caused the event
+//    previousEventState - the sensor state before the event
+// returns:
+//    1 if the event was queued, 0 if the queue is full
+char node_queueStateSensorEvent(
         EventGeneratorInstance* egi, 
         unsigned int sensorId, 
+        unsigned char eventState, 
         unsigned char previousEventState) {
 
-    // begin the event frame
-    mctp_transmitFrameStart(sizeof(PldmRequestHeader) + 8 + 5,1);
-    // transmit the header
-    transmitByte( 0x80 );    // pldm datagram request message type, instance ID 0
-    transmitByte( 0x00);     // header version = 00, pldm type = 0 (pldm messaging/discovery)
-    transmitByte( CMD_PLATFORM_EVENT_MESSAGE ); 
-
-    // transmit the platform event message common data
-    transmitByte(0x01);         // format version
-    transmitByte(0x01);         // terminus ID
-    transmitByte(0x00);         // event class 0 = sensor
-
-    // transmit the body
-    transmitShort(sensorId);
-    transmitByte(1);            // cause = state sensor state change
-    transmitByte(egi->eventState);
-    transmitByte(previousEventState);
-    
-    mctp_transmitFrameEnd();
+    unsigned char data[] = {
+        sensorId & 0xff, sensorId >> 8,
+        1,                  // sensor event class = state sensor state change
+        0,                  // sensor offset
+        eventState,
+        previousEventState
+    };
+    return queueEvent(egi, data, sizeof(data));
 }
 
 //===================================================================
 // updateEvents()
 //
 // called from the low-priority loop to update the state of the event
-// handler.
+// handler and to push any queued events to the event receiver.
 //
 // parameters:
 void node_updateEvents() {
     #ifdef ENTITY_STEPPER1
-    entityStepper1_updateEvents(&eventFifoInsertId);
+    entityStepper1_updateEvents();
     #endif
     #ifdef ENTITY_SIMPLE1
-    entitySimple1_updateEvents(&eventFifoInsertId);
+    entitySimple1_updateEvents();
     #endif
+    updateEventPush();
 }
\ No newline at end of file
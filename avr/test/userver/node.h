@@ -36,12 +36,16 @@
 #include "config.h"
 #include "EventGenerator.h"
 
+// the largest bulk sensor snapshot body (entry count plus one entry per
+// enabled sensor) that an entity may return
+#define SENSOR_SNAPSHOT_MAX_SIZE 64
+
 void node_init();
 void node_putCommand(PldmRequestHeader* hdr, unsigned char* command, unsigned int size);
 unsigned char* node_getResponse(void);
-void node_sendNumericSensorEvent(PldmRequestHeader *rxHeader, unsigned char more, EventGeneratorInstance* egi, unsigned int sensorId, 
+char node_queueNumericSensorEvent(EventGeneratorInstance* egi, unsigned int sensorId, unsigned char eventState,
                                     unsigned char previousEventState, FIXEDPOINT_24_8 presentReading);
-void node_sendStateSensorEvent(PldmRequestHeader *rxHeader, unsigned char more, EventGeneratorInstance* egi, unsigned int sensorId, 
+char node_queueStateSensorEvent(EventGeneratorInstance* egi, unsigned int sensorId, unsigned char eventState,
                                     unsigned char previousEventState);
 void node_updateEvents();
 
@@ -66,6 +66,16 @@ typedef struct {
 #define PDR_TYPE_OEM_ENTITY_ID                   17
 #define PDR_TYPE_FRU_RECORD_SET                  20
 
+// platform event classes
+#define PLDM_EVENT_CLASS_SENSOR             0x00 // sensor event
+#define PLDM_EVENT_CLASS_OEM_BATCH          0xF0 // several queued events in one poll response (oem)
+
+// PLDM types
+#define PLDM_TYPE_BASE                      0x00 // messaging control and discovery
+#define PLDM_TYPE_PLATFORM                  0x02 // platform monitoring and control
+#define PLDM_TYPE_FRU                       0x04 // fru data
+#define PLDM_TYPE_OEM                       0x3F // oem
+
 // PLDM Control and discovery command codes (Type code = 0x00)
 #define CMD_SET_TID                         0x01 // SetTID
 #define CMD_GET_TID                         0x02 // GetTID
@@ -117,6 +127,22 @@ typedef struct {
 #define CMD_GET_FRU_TABLE_METADATA          0x01 
 #define CMD_GET_FRU_RECORD_TABLE            0x02 
 
+// PLDM OEM commands (PLDM TYPE = 0x3F)
+#define CMD_OEM_GET_LINK_STATISTICS         0x01 // read (and optionally clear) the mctp link statistics
+#define CMD_OEM_SET_BAUD_RATE               0x02 // change the serial baud rate (confirmed by the next request)
+#define CMD_OEM_GET_SENSOR_SNAPSHOT         0x03 // read every enabled sensor from a single control cycle
+#define CMD_OEM_SUBSCRIBE_TELEMETRY         0x04 // start (or stop) streaming selected sensor values
+#define CMD_OEM_TELEMETRY_FRAME             0x05 // a frame of streamed sensor values (sent by the node)
+#define CMD_OEM_TELEMETRY_DELTA_FRAME       0x06 // a delta/varint encoded frame of streamed sensor values
+#define CMD_OEM_CONFIGURE_CAPTURE           0x07 // arm (or stop) a triggered capture of control loop values
+#define CMD_OEM_GET_CAPTURE_STATUS          0x08 // read the state of the triggered capture
+#define CMD_OEM_READ_CAPTURE                0x09 // read a completed capture (multipart)
+#define CMD_OEM_SET_SENSOR_STATISTICS       0x0A // enable windowed min/max/mean statistics for a numeric sensor
+#define CMD_OEM_GET_SENSOR_STATISTICS       0x0B // read (and optionally reset) the statistics of a numeric sensor
+#define CMD_OEM_SET_EVENT_BATCH_SIZE        0x0C // set the most events returned by one PollForPlatformEventMessage
+#define CMD_OEM_QUEUE_MOVE                  0x0D // add a move to the blended motion path
+#define CMD_OEM_GET_ISR_PROFILE             0x0E // read (and optionally clear) the isr execution times
+
 #define RESPONSE_SUCCESS                    0x00
 #define RESPONSE_ERROR                      0x01
 #define RESPONSE_ERROR_INVALID_DATA         0x02
@@ -124,6 +150,7 @@ typedef struct {
 #define RESPONSE_ERROR_NOT_READY            0x04
 #define RESPONSE_ERROR_UNSUPPORTED_PLDM_CMD 0x05
 #define RESPONSE_ERROR_INVALID_PLDM_TYPE    0x20
+#define RESPONSE_INVALID_PLDM_TYPE_IN_REQUEST_DATA  0x83
 
 #define RESPONSE_INVALID_PROTOCOL_TYPE              0x80
 #define RESPONSE_INVALID_SENSOR_ID                  0x80
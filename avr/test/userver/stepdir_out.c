@@ -26,6 +26,7 @@
 #define __AVR_ATmega328P__
 #endif
 
+#include <stdlib.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "channels.h"
@@ -38,10 +39,36 @@
 
 // #define VELOCITYDEBUG
 #ifndef VELOCITYDEBUG
+// the shortest step period (in cpu clocks) that will be programmed.  This
+// limits the step rate to 200kHz and keeps the step pulse 2.5us wide. It
+// must stay above twice the frame timer prescaler (see below).
+#define STEPDIR_MIN_PERIOD 80
+
+// the longest step period (in cpu clocks) that will be programmed once
+// the output is moving.  Longer periods would delay the next rate change
+// by too much, so slower rates are output one pulse at a time.
+#define STEPDIR_MAX_PERIOD 16384
+
+// the timer period (in cpu clocks) used while no pulses are being output.
+// It is kept short so that a new step rate takes effect quickly.
+#define STEPDIR_IDLE_PERIOD 256
+
+// the largest number of pulses (16.16) that are allowed to build up when
+// more pulses are requested than the generator can output
+#define STEPDIR_MAX_RESIDUAL 0x40000000L
+
+// the number of cpu clocks allowed between sampling timer 1 and writing
+// the new period.  The period is left alone for a frame if the timer 
+// could reach TOP within this time.
+#define STEPDIR_WRITE_GUARD 32
+
 /********************************************************************
 * stepdir_out_init()
 *
-* initialize the step/dir channel interface
+* initialize the step/dir channel interface.  Timer1 is left running
+* in fast PWM mode 15 (TOP = OCR1A) from here on - the step rate is
+* only ever changed through the double buffered OCR1A/OCR1B registers
+* so that no pulse is ever cut short or stretched.
 *
 * parameters:
 *    nothing
@@ -55,23 +82,32 @@
 *
 * NOTE: This function assumes that the cpu clock is running at 16MHz
 */
-static unsigned char direction;
-static unsigned int timer_divisor;
-static long residual = 0;
+static unsigned char direction;      // the state of the direction pin
+static unsigned int period_now;      // the timer period in force at the last sample
+static signed char step_now;         // the step made by each period_now (+1, -1 or 0)
+static unsigned int period_next;     // the timer period waiting in the double buffer
+static signed char step_next;        // the step made by each period_next
+static unsigned int last_count;      // timer 1 count at the last sample
+static unsigned char last_tick;      // timer 2 count at the last sample
+static long last_fraction;           // progress through period_now at the last sample (16.16)
+static long last_rate;               // the rate last programmed (16.16 pulses/frame)
+static long residual = 0;            // pulses requested but not yet output (16.16)
 void step_dir_out1_init()
 {
     // stop the timer
     TCCR1B = 0x18;
 
-    // set the timer for fast PWM mode 15
+    // set the timer for fast PWM mode 15 - OC1B is set on compare match
+    // and cleared at BOTTOM
     TCCR1A = 0x33;
     
-    // set the top value to an arbitrary value
-    OCR1A = 40;
-    timer_divisor = 40;
+    // start out idle
+    OCR1A = STEPDIR_IDLE_PERIOD-1;
+    period_now = period_next = STEPDIR_IDLE_PERIOD;
+    step_now = step_next = 0;
 
     // set OCR1B above OCR1A so that it will not toggle
-    OCR1B = 20;
+    OCR1B = 0xFFFF;
 
     // clear the timer count
     TCNT1 = 0x0000;
@@ -85,88 +121,164 @@ void step_dir_out1_init()
 
     // set the direction pin data direction to output
     DDRB |= (1<<DDB4);
+    direction = 0;
+    PORTB &= (~(1<<PB4));
+
+    residual = 0;
+    last_rate = 0;
+    last_fraction = 0;
+    last_count = TCNT1;
+    last_tick = TCNT2;
 }
 
 /********************************************************************
 * stepdir_out_setOutput()
 *
 * program the step/dir to output a certain number of pulses within
-* the sample frame.  This function should be called from the high-frequency
-* loop.
+* the sample frame.  This function should be called once per frame from 
+* the high-frequency loop.
 *
-* Due to rounding errors, this function should not be used to achieve
-* more than about 40 steps/microsteps per 4KHz sample frame.  If higher
-* rates are desired, a more sophisticated algorithm will be required.
+* The step timer is never stopped.  Each frame the pulses that it really
+* output are recovered from the timer counts and any shortfall or excess
+* (including the fraction of a pulse in progress) is carried into the
+* next frame's rate.  This keeps the output locked to the requested
+* position without drift, with even pulse spacing up to 200kHz.  Rates
+* below one pulse per frame are output as single pulses once a whole 
+* pulse is due.
 *
 * parameters:
-*    the number of pulses to output during the frame time
+*    the number of pulses to output during the frame time expressed as a
+*    fixed point number with 16 bits of fractional precision.
 *
 * returns:
-*    the integer number of pulses that will be sent during the 
-*    next sample frame. The sign of the return value signifies the
-*    direction of motion.
+*    the integer number of pulses that were output since the previous
+*    call. The sign of the return value signifies the direction of motion.
 *
 * changes:
 *    updates the timer registers for Timer1 (used for the step/dir 
 *    rate generator)
 *
 * NOTE: This function assumes that the cpu clock is running at 16MHz
+* and that the frame timer (Timer2) runs from a divide by 32 prescaler.
 */
 int step_dir_out1_setOutput(long requested_pulses)
 {    
-    // stop the timer - this should be done before clearing the count
-    TCCR1B = 0x18;
-
-    // set the timer to CTC mode 12 - this allows the ocr register
-    // values to be changed immediately (no double buffering) 
-    TCCR1A = 0x20;
-
-    // reset the timer count to zero
-    TCNT1 = 0x0000;
-
-    // set the new top value to the timer divisor
-    OCR1A = timer_divisor-1;
-    
-    // set OCR1B below OCR1A so that it will not toggle approximately
-    // half way through each cycle
-    OCR1B = (timer_divisor-1)>>1;
-
-    // if the value of the OCR1B pin is high, clear it
-    if (PINB|(1<<PB2)) TCCR1C = (1<<FOC1B);
+    // the frame length in cpu clocks
+    unsigned int frame = ((unsigned int)OCR2A+1)<<5;
 
-    // output the direction
-    if (direction) PORTB |= (1<<PB4);
-    else PORTB &= (~(1<<PB4));
+    // add the new request to the pulses still owed.  The rate that was
+    // programmed last frame will be output until the new period takes 
+    // effect, so take that off of what is still to be done.  Only a
+    // quarter of the remaining error is corrected each frame - a new 
+    // period can take most of a frame to take effect at low rates.
+    residual += requested_pulses; 
+    if (residual > STEPDIR_MAX_RESIDUAL) residual = STEPDIR_MAX_RESIDUAL;
+    else if (residual < -STEPDIR_MAX_RESIDUAL) residual = -STEPDIR_MAX_RESIDUAL;
+    long error = residual - last_rate;
+    long rate = requested_pulses + ((error - requested_pulses)>>2);
 
-    // set the mode back to FAST PWM 15
-    TCCR1A = 0x33;
-    
-    // enable the timer
-    TCCR1B = 0x19;
-     
-    // calculate the divisor to get the right number of pulses
+    // calculate the timer period to get the right rate
     // since:
-    //    pulses / second = requested_pulses * SAMPLE_RATE;
+    //    pulses / frame = rate / 65536
     // and: 
-    //    pulses / second = F_CPU / timer_divisor
-    // timer_divisor = (F_CPU/SAMPLE_RATE)/requested_pulses
-    residual += requested_pulses; 
-    unsigned int pulses;
-    if (residual<0) {
-        direction = 1;
-        pulses = -(residual/65536);
-        residual += (pulses*65536);
-    } else {
-        direction = 0;
-        pulses = (residual/65536);
-        residual -= (pulses*65536);
+    //    pulses / frame = frame / period
+    // period = (frame * 65536) / rate
+    unsigned long limit = ((unsigned long)frame)<<16;
+    unsigned long slowest = limit/STEPDIR_MAX_PERIOD;
+    unsigned char newdir = (rate<0);
+    unsigned long magnitude = (newdir) ? -rate : rate;
+    if ((step_next == 0) || (newdir != direction)) {
+        // a move is only started once a whole pulse is owed.  This keeps
+        // the output from dithering back and forth while stopped.
+        if (newdir != (error<0)) magnitude = 0;
+        newdir = (error<0);
+        if (((newdir) ? -error : error) < 65536) magnitude = 0;
+        else if (magnitude < slowest) magnitude = slowest;
     }
-    if (pulses == 0) {
-        timer_divisor = 0xFFFF;  // this is so high, it will not be reached in a frame time
-    } else {
-        timer_divisor = (F_CPU/SAMPLE_RATE) / pulses;
+    unsigned int period = STEPDIR_IDLE_PERIOD;
+    signed char step = 0;
+    long newrate = 0;
+    unsigned char dir = direction;
+    if (magnitude >= slowest) {
+        // the direction may only change once no pulses in the old
+        // direction remain in the timer
+        if ((newdir != dir) && (step_now == 0) && (step_next == 0)) dir = newdir;
+        if (newdir == dir) {
+            if (magnitude > limit/STEPDIR_MIN_PERIOD) {
+                period = STEPDIR_MIN_PERIOD;
+                magnitude = limit/STEPDIR_MIN_PERIOD;
+            } else {
+                period = limit/magnitude;
+            }
+            step = 1;
+            newrate = magnitude;
+            if (dir) {
+                step = -1;
+                newrate = -newrate;
+            }
+        }
     }
-    if (direction) return -pulses;
+
+    // sample the timers, then program the new period - it takes effect 
+    // at the next BOTTOM.  The timer is running at either period_now or 
+    // period_next.  If it is close to the end of either one, the BOTTOM 
+    // could fall before or after the write, so the old period is kept 
+    // for another frame rather than guessing which one was loaded.
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+    unsigned int count = TCNT1;
+    unsigned char tick = TCNT2;
+    unsigned char write = 
+        ((count >= period_now) || ((unsigned int)(period_now-count) > STEPDIR_WRITE_GUARD)) &&
+        ((count >= period_next) || ((unsigned int)(period_next-count) > STEPDIR_WRITE_GUARD));
+    if (write) {
+        if (dir) PORTB |= (1<<PB4);
+        else PORTB &= (~(1<<PB4));
+        OCR1A = period-1;
+        OCR1B = (step) ? ((period-1)>>1) : 0xFFFF;
+    }
+    SREG = sreg;
+
+    // find how many times timer 1 wrapped since the last sample.  The time 
+    // between samples is known to within one timer 2 count (32 clocks),
+    // and timer 1 gives it exactly modulo the period, so together they
+    // give the number of wraps exactly.
+    int expected = frame + ((int)tick - (int)last_tick)*32;
+    int elapsed = (int)(period_now - last_count) + (int)count;
+    unsigned int wraps = 0;
+    if (expected > elapsed) {
+        wraps = ((unsigned int)(expected - elapsed) + (period_next>>1)) / period_next;
+        elapsed += wraps*period_next;
+    }
+    int pulses = 0;
+    if ((count < last_count) || 
+        (abs(expected - elapsed) <= abs(expected - (int)(count - last_count)))) {
+        // the first wrap ends the period that was in force at the last 
+        // sample, the rest are all from the buffered period
+        pulses = step_now + (int)wraps*step_next;
+        period_now = period_next;
+        step_now = step_next;
+    }
+    if (write) {
+        period_next = period;
+        step_next = step;
+        direction = dir;
+        last_rate = newrate;
+    }
+
+    // take the pulses that were output off of the pulses still owed.  The
+    // fraction of the current pulse is worked back to the start of the 
+    // frame so that the time taken to get here does not show up as jitter.
+    long fraction = 0;
+    if (step_now) {
+        fraction = (((long)count - ((int)tick<<5))<<16)/(long)period_now;
+        if (step_now<0) fraction = -fraction;
+    }
+    residual -= (((long)pulses)<<16) + fraction - last_fraction;
+    last_fraction = fraction;
+    last_count = count;
+    last_tick = tick;
+
     return pulses;
 }    
 #else
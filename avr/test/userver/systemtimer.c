@@ -35,6 +35,9 @@
 #include "pldm.h"
 #include "entityStepper1.h"
 #include "entitySimple1.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "isrprofile.h"
 
 #ifndef F_CPU
     #define F_CPU 16000000
@@ -61,10 +64,15 @@ static unsigned char delay_limit_changed[DELAY_INSTANCES];
 *    void
 * changes:
 *    updates the motor controller (if used).
+*    samples streamed telemetry values (if built with TELEMETRY)
+*    records rows of an armed capture (if built with CAPTURE)
 *    updates any delay counters
+*    records the time taken (if built with ISR_PROFILE)
 */
 static unsigned char tick = 0;
 ISR(TIMER2_COMPA_vect) {
+    ISRPROFILE_ENTER(ISRPROFILE_FRAME);
+    ISRPROFILE_ENTER(ISRPROFILE_CONTROL);
     #ifdef ENTITY_STEPPER1
         entityStepper1_updateControl();
     #endif
@@ -77,6 +85,19 @@ ISR(TIMER2_COMPA_vect) {
     #ifdef ENTITY_SIMPLE1
         entitySimple1_updateControl();
     #endif
+    ISRPROFILE_EXIT(ISRPROFILE_CONTROL);
+
+    // sample any streamed sensor values and record any armed capture
+    #if defined(TELEMETRY) || defined(CAPTURE)
+        ISRPROFILE_ENTER(ISRPROFILE_SAMPLE);
+        #ifdef TELEMETRY
+            telemetry_sample();
+        #endif
+        #ifdef CAPTURE
+            capture_sample();
+        #endif
+        ISRPROFILE_EXIT(ISRPROFILE_SAMPLE);
+    #endif
 
     // update delay counters every fourth clock
     if (tick == 0) {
@@ -92,6 +113,7 @@ ISR(TIMER2_COMPA_vect) {
             }
     }
     tick = (tick+1)&0x03;
+    ISRPROFILE_EXIT(ISRPROFILE_FRAME);
 }
 #pragma GCC pop_options
 
@@ -0,0 +1,265 @@
+//    telemetry.c
+//
+//    This file defines functions related to streaming sensor
+//    telemetry as part of the PICMG reference code for IoT.
+//    The manager subscribes to a set of sensors and the values are
+//    sampled by the control isr and pushed to the manager from the
+//    main loop whenever the transmitter is idle.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef __AVR_ATmega328P__ 
+#define __AVR_ATmega328P__
+#endif
+
+#include <avr/io.h>
+#include "mctp.h"
+#include "pldm.h"
+#include "telemetry.h"
+
+#ifdef TELEMETRY
+
+// the number of sample values held between the control isr and the
+// main loop.  Rows of one value per subscribed sensor are stored here.
+#define TELEMETRY_RING_VALUES 32
+
+// the size of the sample data carried by one telemetry frame (ten raw
+// values).  Frames are kept within the mctp staging area so that they
+// are queued without waiting for the transmitter.
+#define TELEMETRY_PAYLOAD_SIZE 40
+#define TELEMETRY_HEADER_SIZE  (sizeof(PldmRequestHeader) + 5)
+
+// subscription settings
+static TelemetrySource sources[TELEMETRY_MAX_SENSORS];
+static unsigned char   sourceCount;
+static unsigned int    decimation;
+static unsigned int    framesRemaining;   // 0 when the stream has no budget
+static unsigned char   encoding;
+static unsigned char   receiver;          // endpoint the frames are sent to
+static volatile unsigned char active = 0;
+
+// sample ring - the head is advanced by the control isr and the tail
+// by the main loop
+static long            ring[TELEMETRY_RING_VALUES];
+static unsigned int    rowSample[TELEMETRY_RING_VALUES];
+static unsigned char   rowCapacity;
+static volatile unsigned char head;
+static volatile unsigned char tail;
+static unsigned int    decimationCount;
+static unsigned int    sampleNumber;
+static unsigned char   sequence;
+
+//*******************************************************************
+// telemetry_init()
+//
+// initialize the telemetry stream.  No sensors are streamed until
+// the manager subscribes to them.
+//
+// parameters: none
+// returns: nothing
+void telemetry_init() {
+    active = 0;
+    head = tail = 0;
+    sequence = 0;
+}
+
+//*******************************************************************
+// telemetry_start()
+//
+// start streaming the given sensors, replacing any current
+// subscription.  A sample row is taken every decimation control
+// cycles (SAMPLE_RATE/decimation rows per second).
+//
+// parameters:
+//    sources - the sensor values to stream
+//    count - the number of sensors (1 to TELEMETRY_MAX_SENSORS)
+//    decimation - the number of control cycles between samples
+//    frameBudget - the number of frames to send before the stream
+//       stops, or 0 to stream until stopped
+//    enc - the frame encoding (TELEMETRY_ENCODING_RAW or _DELTA)
+//    destEid - the endpoint ID to send the frames to
+// returns:
+//    1 if the stream was started, otherwise 0
+unsigned char telemetry_start(const TelemetrySource *src, unsigned char count, unsigned int decim, unsigned int frameBudget, unsigned char enc, unsigned char destEid) {
+    if ((count == 0) || (count > TELEMETRY_MAX_SENSORS) || (decim == 0)) return 0;
+    if (enc > TELEMETRY_ENCODING_DELTA) return 0;
+
+    // the isr ignores the settings while the stream is inactive
+    active = 0;
+    for (unsigned char i = 0; i < count; i++) sources[i] = src[i];
+    sourceCount = count;
+    decimation = decim;
+    decimationCount = decim;
+    framesRemaining = frameBudget;
+    encoding = enc;
+    receiver = destEid;
+    rowCapacity = TELEMETRY_RING_VALUES / count;
+    head = tail = 0;
+    sampleNumber = 0;
+    active = 1;
+    return 1;
+}
+
+//*******************************************************************
+// telemetry_stop()
+//
+// stop streaming and discard any samples that have not been sent.
+//
+// parameters: none
+// returns: nothing
+void telemetry_stop() {
+    active = 0;
+    head = tail;
+}
+
+#pragma GCC push_options
+#pragma GCC optimize "-O3"
+//*******************************************************************
+// telemetry_sample()
+//
+// take a sample row if one is due.  This is called from the control
+// isr after the entities have updated their sensors.  If the ring is
+// full, the row is dropped; the gap shows up in the sample numbers
+// of the frames that follow.
+//
+// parameters: none
+// returns: nothing
+void telemetry_sample() {
+    if (!active) return;
+    if (--decimationCount) return;
+    decimationCount = decimation;
+
+    unsigned int  sample = sampleNumber++;
+    unsigned char next = head + 1;
+    if (next == rowCapacity) next = 0;
+    if (next == tail) return;
+
+    long *row = &ring[head * sourceCount];
+    for (unsigned char i = 0; i < sourceCount; i++) {
+        if (sources[i].size == 1) row[i] = *((const volatile unsigned char*)sources[i].value);
+        else row[i] = *((const volatile long*)sources[i].value);
+    }
+    rowSample[head] = sample;
+    head = next;
+}
+#pragma GCC pop_options
+
+//*******************************************************************
+// putVarint()
+//
+// write a signed value as a zig-zag varint: the value is mapped to an
+// unsigned one (0,-1,1,-2... become 0,1,2,3...) and written seven bits
+// at a time, least significant group first, with bit 7 set on every
+// byte but the last.  Small values of either sign take a single byte.
+//
+// parameters:
+//    buffer - where to write the encoded value (up to 5 bytes)
+//    value - the value to encode
+// returns:
+//    the number of bytes written
+static unsigned char putVarint(unsigned char *buffer, long value) {
+    unsigned long zz = (((unsigned long)value) << 1) ^ (unsigned long)(value >> 31);
+    unsigned char size = 0;
+    while (zz >= 0x80) {
+        buffer[size++] = (zz & 0x7f) | 0x80;
+        zz >>= 7;
+    }
+    buffer[size++] = zz;
+    return size;
+}
+
+//*******************************************************************
+// telemetry_update()
+//
+// send a telemetry frame if samples are waiting and the transmitter
+// is idle, so that telemetry never delays a response.  This is called
+// from the main loop.
+//
+// A frame is an unacknowledged OEM PLDM datagram holding a sequence
+// number, the sample number of the first row, the sensor count, the
+// row count and then the rows, one value per subscribed sensor in
+// subscription order.  State sensor values are zero-extended.  The
+// rows of a frame are always consecutive samples.  Frames are sent to
+// the endpoint that started the stream, each with a tag of its own.
+//
+// Raw frames (CMD_OEM_TELEMETRY_FRAME) carry each value as a
+// little-endian 32-bit number.  Delta frames
+// (CMD_OEM_TELEMETRY_DELTA_FRAME) carry each value as a zig-zag varint
+// (see putVarint()).  The first row of a delta frame is a keyframe
+// holding the values themselves; each later row holds the difference
+// from the previous row of the same sensor.  Every frame can therefore
+// be decoded on its own, and a lost frame only loses its own rows.
+//
+// parameters: none
+// returns: nothing
+void telemetry_update() {
+    unsigned char frame[TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE];
+    unsigned char encoded[5*TELEMETRY_MAX_SENSORS];
+    long previous[TELEMETRY_MAX_SENSORS];
+
+    if ((head == tail) || (!mctp_isTransmitIdle())) return;
+
+    // gather consecutive rows from the tail of the ring until the
+    // payload is full
+    unsigned char rows = 0;
+    unsigned char row = tail;
+    unsigned int  first = rowSample[row];
+    unsigned char *payload = frame + TELEMETRY_HEADER_SIZE;
+    unsigned char size = 0;
+    while ((row != head) && (rowSample[row] == first + rows)) {
+        long *value = &ring[row * sourceCount];
+        unsigned char length = 0;
+        if (encoding == TELEMETRY_ENCODING_DELTA) {
+            for (unsigned char i = 0; i < sourceCount; i++) {
+                long delta = (long)((unsigned long)value[i] - (unsigned long)previous[i]);
+                length += putVarint(encoded + length, rows ? delta : value[i]);
+            }
+        } else {
+            for (unsigned char i = 0; i < sourceCount; i++) {
+                *((long*)(encoded + length)) = value[i];
+                length += 4;
+            }
+        }
+        if (size + length > TELEMETRY_PAYLOAD_SIZE) break;
+        for (unsigned char i = 0; i < length; i++) payload[size++] = encoded[i];
+        for (unsigned char i = 0; i < sourceCount; i++) previous[i] = value[i];
+        rows++;
+        row++;
+        if (row == rowCapacity) row = 0;
+    }
+
+    frame[0] = 0xC0;                 // request, datagram
+    frame[1] = PLDM_TYPE_OEM;
+    frame[2] = (encoding == TELEMETRY_ENCODING_DELTA) ? CMD_OEM_TELEMETRY_DELTA_FRAME : CMD_OEM_TELEMETRY_FRAME;
+    frame[3] = sequence;
+    frame[4] = first & 0xff;
+    frame[5] = first >> 8;
+    frame[6] = sourceCount;
+    frame[7] = rows;
+    mctp_segment segment = MCTP_SEGMENT_RAM(frame, TELEMETRY_HEADER_SIZE + size);
+    if (!mctp_transmitRequest(receiver, MCTP_TYPE_PLDM, &segment, 1)) return;
+
+    // the frame has been copied, so the rows can be reused
+    tail = row;
+    sequence++;
+    if ((framesRemaining) && (--framesRemaining == 0)) telemetry_stop();
+}
+
+#endif
@@ -0,0 +1,53 @@
+//    telemetry.h
+//
+//    This header file declares functions related to streaming sensor
+//    telemetry as part of the PICMG reference code for IoT.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+// Telemetry streaming is only compiled in when the firmware is built
+// with -DTELEMETRY.  It holds about 220 bytes of sram (the 192 byte
+// sample ring and the subscription), which the stack gets back when
+// streaming is left out.  The TelemetrySource type is always present
+// since the capture uses it too.
+
+// the most sensors that a single subscription may stream
+#define TELEMETRY_MAX_SENSORS 4
+
+// telemetry frame encodings
+#define TELEMETRY_ENCODING_RAW   0   // 32-bit values
+#define TELEMETRY_ENCODING_DELTA 1   // keyframe then deltas, as zig-zag varints
+
+// a sensor value that is sampled by the control isr.  State sensors
+// provide a single byte and numeric sensors a FIXEDPOINT_24_8 value.
+typedef struct {
+    const volatile void *value;
+    unsigned char size;
+} TelemetrySource;
+
+#ifdef TELEMETRY
+void          telemetry_init();
+unsigned char telemetry_start(const TelemetrySource *sources, unsigned char count, unsigned int decimation, unsigned int frameBudget, unsigned char encoding, unsigned char destEid);
+void          telemetry_stop();
+void          telemetry_sample();
+void          telemetry_update();
+#endif
@@ -34,13 +34,43 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "uart.h"
+#include "isrprofile.h"
 
-// Baud rate.
+// Baud rate used at startup.  This must be one of the rates in the
+// baud rate table.
 #define BAUD 38400
 #define BUFFERSIZE 64    // this must be an 8-bit power of 2
 #define BIT2NUM(bit) (1<<bit)
 
+// ubrr divisor (rounded) for a baud rate, with and without U2X
+#define UBRR_VALUE(baud, u2x) ((((F_CPU)/((u2x)?8:16)) + ((baud)/2)) / (baud) - 1)
+
+// supported baud rates.  U2X is used where it gives the lower rate
+// error at 16MHz.  250k, 500k and 1M divide the clock exactly.
+typedef struct {
+    unsigned long baud;
+    unsigned int  ubrr;
+    unsigned char u2x;
+} uart_baudrate;
+
+#define BAUD_ENTRY(baud, u2x) { (baud), UBRR_VALUE(baud, u2x), (u2x) }
+static const uart_baudrate uart_baudtable[] PROGMEM = {
+    BAUD_ENTRY(9600UL,    1),
+    BAUD_ENTRY(19200UL,   1),
+    BAUD_ENTRY(38400UL,   0),
+    BAUD_ENTRY(57600UL,   1),
+    BAUD_ENTRY(115200UL,  1),
+    BAUD_ENTRY(250000UL,  0),
+    BAUD_ENTRY(500000UL,  0),
+    BAUD_ENTRY(1000000UL, 0)
+};
+#define BAUD_TABLE_SIZE (sizeof(uart_baudtable)/sizeof(uart_baudrate))
+
+// the baud rate currently in use
+static unsigned long uart_baud = 0;
+
 // rx buffer implementation
 static volatile unsigned char uart_rxhead = 0;  // insertion point
 static volatile unsigned char uart_rxtail = 0;  // extraction point
@@ -51,21 +81,48 @@ static volatile unsigned char uart_txhead = 0;  // insertion point
 static volatile unsigned char uart_txtail = 0;  // extraction point
 static volatile unsigned char uart_txbuf[BUFFERSIZE];
 
+// link statistics
+static volatile uart_statistics uart_stats;
+
+// optional receive sink.  If set, the receive interrupt passes each
+// character directly to it instead of placing it in the rx buffer.
+static void (*uart_rxsink)(unsigned char ch) = 0;
+
+// optional transmit source, used by the transmit interrupt once the
+// tx buffer is empty.  It returns non-zero and sets *ch if it has a
+// character to send.
+static unsigned char (*uart_txsource)(unsigned char *ch) = 0;
+
 //===================================================================
 // uart receive interrupt service routine
 //
 // this interrupt service routine grabs a character from the uart
 // and places it in the receive buffer.  If the buffer is full, the 
-// new charcter is thrown away.
+// new charcter is thrown away.  If a receive sink has been set, the
+// character is passed to the sink instead.
 ISR(USART_RX_vect) {
+    ISRPROFILE_ENTER(ISRPROFILE_USART_RX);
+
     // get the character from the uart data register
     unsigned char ch = UDR0;
+    uart_stats.bytesIn++;
+
+    // if a receive sink is set, hand the character straight to it
+    if (uart_rxsink) {
+        uart_rxsink(ch);
+        ISRPROFILE_EXIT(ISRPROFILE_USART_RX);
+        return;
+    }
 
     // if there is space in the buffer place the new character in the buffer
     if ((uart_rxtail - uart_rxhead - 1) & (BUFFERSIZE - 1)) {
         uart_rxbuf[uart_rxhead] = ch;
         uart_rxhead = (uart_rxhead + 1)&(BUFFERSIZE-1);
     }
+    else {
+        uart_stats.rxOverflows++;
+    }
+    ISRPROFILE_EXIT(ISRPROFILE_USART_RX);
 }
 
 //===================================================================
@@ -73,17 +130,41 @@ ISR(USART_RX_vect) {
 //
 // this interrupt service routine grabs a character from the transmit
 // buffer and places it in the uart transmit register.  If the buffer  
-// empty, further interrupts are disabled
+// is empty, the character is taken from the transmit source (if one is
+// set).  If neither has data, further interrupts are disabled
 ISR(USART_UDRE_vect) {
+    ISRPROFILE_ENTER(ISRPROFILE_USART_UDRE);
+    unsigned char ch;
+
     // if there is a character, place it in the transmit buffer
     if ((uart_txhead - uart_txtail) & (BUFFERSIZE - 1)) {
         UDR0 = uart_txbuf[uart_txtail]; 
         uart_txtail = (uart_txtail + 1) & (BUFFERSIZE - 1);
+        uart_stats.bytesOut++;
+    }
+    // otherwise, try the transmit source
+    else if ((uart_txsource) && (uart_txsource(&ch))) {
+        UDR0 = ch;
+        uart_stats.bytesOut++;
     }
     // otherwise, disable further interrupts 
     else {
         UCSR0B &= ~BIT2NUM(UDRIE0);
     }
+    ISRPROFILE_EXIT(ISRPROFILE_USART_UDRE);
+}
+
+//*******************************************************************
+// clearTxComplete()
+//
+// clear the transmit complete flag.  This is done before new data is
+// queued so that the flag is only set again once that data has left the
+// shift register.  The error flags must be written as zero.
+//
+// returns:
+//    void
+static inline void clearTxComplete() {
+    UCSR0A = (UCSR0A & (BIT2NUM(U2X0) | BIT2NUM(MPCM0))) | BIT2NUM(TXC0);
 }
 
 //*******************************************************************
@@ -96,14 +177,8 @@ ISR(USART_UDRE_vect) {
 // returns:
 //    true if the connection was successful
 void uart_init() {
-    // set the buad rate based on the cpu frequency
-    #if BAUD > 38401
-        UCSR0A = BIT2NUM(U2X0);
-        UBRR0 = (((F_CPU / 8) / BAUD) - 0.5);
-    #else
-        UCSR0A = 0;
-        UBRR0 = (((F_CPU / 16) / BAUD) - 0.5);
-    #endif
+    // set the startup baud rate
+    uart_setBaudRate(BAUD);
 
     // configure the UCSR0B and UCSR0C for uart operation
     UCSR0B = BIT2NUM(RXEN0) | BIT2NUM(TXEN0);
@@ -169,7 +244,11 @@ unsigned char uart_writeCh(char ch) {
     // if interrupts are enabled, wait for space to exist
     // in the buffer and write the result.
     if (SREG & BIT2NUM(SREG_I)) {
-        while (!((uart_txtail - uart_txhead - 1) & (BUFFERSIZE - 1))) {}
+        // count each pass of the wait loop as a transmit stall
+        while (!((uart_txtail - uart_txhead - 1) & (BUFFERSIZE - 1))) {
+            uart_stats.txStalls++;
+        }
+        clearTxComplete();
         uart_txbuf[uart_txhead] = ch;
         uart_txhead = (uart_txhead + 1)&(BUFFERSIZE-1);
     }
@@ -177,6 +256,7 @@ unsigned char uart_writeCh(char ch) {
         // otherwise, only write the character in the transmit
         // buffer if there is room.
         if ((uart_txtail - uart_txhead - 1) & (BUFFERSIZE - 1)) {
+            clearTxComplete();
             uart_txbuf[uart_txhead] = ch;
             uart_txhead = (uart_txhead + 1)&(BUFFERSIZE-1);
         }
@@ -221,6 +301,165 @@ unsigned char uart_rx_isempty() {
     return ((uart_rxhead - uart_rxtail) & (BUFFERSIZE - 1));
 }
 
+//*******************************************************************
+// uart_getStatistics()
+//
+// This function copies the uart link statistics.  The copy is made with
+// interrupts disabled so that the multi-byte counters are consistent.
+//
+// parameters:
+//    stats - pointer to the structure to receive the statistics
+// returns:
+//    void
+void uart_getStatistics(uart_statistics *stats) {
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+    stats->bytesIn = uart_stats.bytesIn;
+    stats->bytesOut = uart_stats.bytesOut;
+    stats->rxOverflows = uart_stats.rxOverflows;
+    stats->txStalls = uart_stats.txStalls;
+    SREG = sreg;
+}
+
+//*******************************************************************
+// uart_clearStatistics()
+//
+// This function resets all the uart link statistics to zero.
+//
+// returns:
+//    void
+void uart_clearStatistics() {
+    unsigned char sreg = SREG;
+    __builtin_avr_cli();
+    uart_stats.bytesIn = 0;
+    uart_stats.bytesOut = 0;
+    uart_stats.rxOverflows = 0;
+    uart_stats.txStalls = 0;
+    SREG = sreg;
+}
+
+//*******************************************************************
+// uart_setRxSink()
+//
+// This function sets a function that the receive interrupt will call
+// with each received character, bypassing the receive buffer.  This
+// allows higher layers to process received data in interrupt context.
+//
+// parameters:
+//    sink - the receive sink function (0 for none)
+// returns:
+//    void
+void uart_setRxSink(void (*sink)(unsigned char ch)) {
+    uart_rxsink = sink;
+}
+
+//*******************************************************************
+// uart_setTxSource()
+//
+// This function sets a function that the transmit interrupt will call
+// for more characters once the transmit buffer is empty.  This allows
+// higher layers to produce transmit data directly from interrupt
+// context rather than filling the transmit buffer.
+//
+// parameters:
+//    source - the transmit source function (0 for none)
+// returns:
+//    void
+void uart_setTxSource(unsigned char (*source)(unsigned char *ch)) {
+    uart_txsource = source;
+}
+
+//*******************************************************************
+// uart_startTx()
+//
+// This function enables the transmit interrupt so that data from the
+// transmit source will be sent.
+//
+// returns:
+//    void
+void uart_startTx() {
+    clearTxComplete();
+    UCSR0B |= BIT2NUM(UDRIE0);
+}
+
+//*******************************************************************
+// uart_isTxComplete()
+//
+// This function returns true once all queued characters (including
+// those from the transmit source) have been shifted out of the uart.
+//
+// returns:
+//    true if the transmitter is completely idle
+unsigned char uart_isTxComplete() {
+    if ((uart_txhead - uart_txtail) & (BUFFERSIZE - 1)) return 0;
+    if (UCSR0B & BIT2NUM(UDRIE0)) return 0;
+    return (UCSR0A & BIT2NUM(TXC0)) ? 1 : 0;
+}
+
+//*******************************************************************
+// findBaudRate()
+//
+// find a baud rate in the baud rate table.
+//
+// parameters:
+//    baud - the baud rate to find
+// returns:
+//    the index of the rate in the table, or BAUD_TABLE_SIZE if the
+//    rate is not supported
+static unsigned char findBaudRate(unsigned long baud) {
+    unsigned char i;
+    for (i = 0; i < BAUD_TABLE_SIZE; i++) {
+        if (pgm_read_dword(&uart_baudtable[i].baud) == baud) break;
+    }
+    return i;
+}
+
+//*******************************************************************
+// uart_isBaudRateSupported()
+//
+// This function returns true if the baud rate is in the baud rate table.
+//
+// parameters:
+//    baud - the baud rate to check
+// returns:
+//    true if the rate is supported
+unsigned char uart_isBaudRateSupported(unsigned long baud) {
+    return findBaudRate(baud) < BAUD_TABLE_SIZE;
+}
+
+//*******************************************************************
+// uart_setBaudRate()
+//
+// This function changes the uart baud rate.  Any character being sent
+// or received at the time of the change will be corrupted, so callers
+// should wait for uart_isTxComplete() before switching.
+//
+// parameters:
+//    baud - the new baud rate.  This must be one of the rates in the
+//           baud rate table.
+// returns:
+//    true if the baud rate is supported and was set
+unsigned char uart_setBaudRate(unsigned long baud) {
+    unsigned char i = findBaudRate(baud);
+    if (i >= BAUD_TABLE_SIZE) return 0;
+
+    UCSR0A = pgm_read_byte(&uart_baudtable[i].u2x) ? BIT2NUM(U2X0) : 0;
+    UBRR0 = pgm_read_word(&uart_baudtable[i].ubrr);
+    uart_baud = baud;
+    return 1;
+}
+
+//*******************************************************************
+// uart_getBaudRate()
+//
+// This function returns the baud rate currently in use.
+//
+// returns:
+//    the baud rate
+unsigned long uart_getBaudRate() {
+    return uart_baud;
+}
+
 //*******************************************************************
 // uart_close()
 //
@@ -27,6 +27,14 @@
 #ifndef UART_H_INCLUDED
 #define UART_H_INCLUDED
 
+// uart link statistics
+typedef struct {
+    unsigned long bytesIn;       // characters received
+    unsigned long bytesOut;      // characters transmitted
+    unsigned int  rxOverflows;   // characters dropped, receive buffer full
+    unsigned long txStalls;      // wait loop passes with the transmit buffer full
+} uart_statistics;
+
 // function definitions
 void uart_init();
 unsigned char uart_flush();
@@ -34,6 +42,15 @@ unsigned char uart_readCh();
 unsigned char uart_writeCh(char);
 unsigned char uart_writeBuffer(const void* buf, unsigned int size);
 unsigned char uart_rx_isempty();
+void uart_getStatistics(uart_statistics *stats);
+void uart_clearStatistics();
+void uart_setRxSink(void (*sink)(unsigned char ch));
+void uart_setTxSource(unsigned char (*source)(unsigned char *ch));
+void uart_startTx();
+unsigned char uart_isTxComplete();
+unsigned char uart_isBaudRateSupported(unsigned long baud);
+unsigned char uart_setBaudRate(unsigned long baud);
+unsigned long uart_getBaudRate();
 unsigned char uart_close();
 
 #endif // UART_H_INCLUDED
\ No newline at end of file
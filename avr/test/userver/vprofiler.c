@@ -23,11 +23,32 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 //
-#include <math.h>
 #include <stdlib.h>
+#include <avr/io.h>
 #include "uart.h"
 #include "vprofiler.h"
 
+#define PLAN_NONE     0
+#define PLAN_POSITION 1
+#define PLAN_VELOCITY 2
+#define PLAN_QUEUE    3
+
+#define PHASE_PENDING 0x7E
+
+// the segment set for one motion profile.  Plans are calculated in the
+// main loop into one set while the control loop integrates the other.
+typedef struct {
+	long gt1, gt2, gt3, gt4, gt5;
+	long gdx1, gdx2, gdx3, gdx4, gdx5;
+	long gv1, gv2, gv3, gv4;
+	long ga1, ga2, ga3, ga4;
+	long gj1, gj2, gj3, gj4;
+	long gj1_6, gj2_6, gj3_6, gj4_6;
+	long velocity;            // starting velocity
+	long acceleration;        // starting acceleration
+	long jerk;                // starting jerk
+} VProfilePlan;
+
 static long active_position;
 static long active_velocity;
 static long active_acceleration;
@@ -40,12 +61,29 @@ static long current_position;      // fixed point 16 fractional bits
 static long current_jerk;
 static long current_jerk6;
 
-static long gt1, gt2, gt3, gt4, gt5;
-static long gdx1, gdx2, gdx3, gdx4, gdx5;
-static long gv1, gv2, gv3, gv4;
-static long ga1, ga2, ga3, ga4;
-static long gj1, gj2, gj3, gj4;
-static long gj1_6, gj2_6, gj3_6, gj4_6;
+static VProfilePlan plans[2];
+static VProfilePlan *activePlan = &plans[0];
+static VProfilePlan *nextPlan = &plans[1];
+
+static volatile char planRequest = PLAN_NONE;
+static volatile char planReady = 0;
+static volatile unsigned char planSequence = 0;
+
+// moves waiting to be blended into a continuous path.  Moves are added
+// and planned from the main loop.  The control loop only starts the
+// path and flushes the queue when the path is abandoned.
+typedef struct {
+	long deltax;
+	FP16 velocity;
+	FP16 acceleration;
+} QueuedMove;
+
+static QueuedMove moveQueue[VPROFILER_QUEUE_SIZE];
+static volatile unsigned char queueHead = 0;
+static volatile unsigned char queueTail = 0;
+static volatile char queueActive = 0;
+static volatile char queuePlanning = 0;   // a move has been taken but not yet published
+static FP16 queueVelocity = 0;            // exit velocity of the last planned move
 
 static char estop = 0;
 static char phase = 0x7F;
@@ -78,193 +116,727 @@ void vprofiler_setParameters(long deltax, FP16 velocity, FP16 acceleration, char
 	active_scurve = scurve;
 }
 
-static FP16 calc_v(float v0, float a, float j, float dt) {
-	return FLOAT_TO_FP16(v0 + a * dt + j * dt * dt / 2.0f);
+/********************************************************************
+* fpmul()
+*
+* multiply two 15.16 signed fixed point numbers using 32-bit partial
+* products.  The result is truncated toward zero.
+*/
+static FP16 fpmul(FP16 x, FP16 y) {
+	char negative = ((x < 0) != (y < 0));
+	unsigned long ux = (x < 0) ? -x : x;
+	unsigned long uy = (y < 0) ? -y : y;
+	unsigned long xh = ux >> 16, xl = ux & 0xFFFF;
+	unsigned long yh = uy >> 16, yl = uy & 0xFFFF;
+	unsigned long result = ((xh * yh) << 16) + xh * yl + xl * yh + ((xl * yl) >> 16);
+	return negative ? -(FP16)result : (FP16)result;
+}
+
+/********************************************************************
+* fpdiv()
+*
+* unsigned restoring division that returns the integer part of
+* (num * 2^shift) / den and places the next 32 bits of the quotient
+* in *frac.  All of the intermediates fit in 32 bits.  den must be
+* nonzero and the integer part must fit in 32 bits.
+*/
+static unsigned long fpdiv(unsigned long num, unsigned long den, unsigned char shift, unsigned long *frac) {
+	unsigned long q = num / den;
+	unsigned long r = num % den;
+	unsigned long f = 0;
+	unsigned char i;
+	for (i = 0; i < shift + 32; i++) {
+		unsigned char bit = (r >= den - r);
+		r = bit ? r - (den - r) : r << 1;
+		if (i < shift) q = (q << 1) | bit;
+		else f = (f << 1) | bit;
+	}
+	if (frac) *frac = f;
+	return q;
 }
 
-static FP16 calc_dx(float v0, float a, float j, float dt) {
-	return FLOAT_TO_FP16(v0*dt + a * dt*dt/2.0f + j * dt * dt * dt / 6.0f);
+/********************************************************************
+* isqrt()
+*
+* return the integer square root of a 64-bit value.  This is the only
+* place the planner needs 64-bit arithmetic.
+*/
+static unsigned long isqrt(unsigned long long x) {
+	unsigned long long result = 0;
+	unsigned long long bit = 1ULL << 62;
+	while (bit > x) bit >>= 2;
+	while (bit) {
+		if (x >= result + bit) {
+			x -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (unsigned long)result;
 }
 
 /********************************************************************
-* vprofiler_start()
+* transition()
 *
-* calculate the trajectory parameters for the most recently requested
-* move.  This routine calculates parameters for position-velocity moves.
-* For velocity only moves, use vprofiler_startv().
+* find the first sample period at or after a transition time and the
+* fraction of a sample period between the transition and that sample.
 *
+* parameters:
+*   whole - the integer part of the transition time in sample periods
+*   frac - the 16-bit fractional part of the transition time
+*   deltat - set to the 15.16 time from the transition to the sample,
+*      in the range (0, 1]
+* returns:
+*   the sample period index of the transition
 */
-void vprofiler_start()
+static long transition(unsigned long whole, unsigned int frac, FP16 *deltat) {
+	*deltat = 65536L - frac;
+	return (long)whole + 1;
+}
+
+static FP16 calc_v(FP16 v0, FP16 a, FP16 j, FP16 dt) {
+	FP16 dt2 = fpmul(dt, dt);
+	return v0 + fpmul(a, dt) + fpmul(j, dt2) / 2;
+}
+
+static FP16 calc_dx(FP16 v0, FP16 a, FP16 j, FP16 dt) {
+	FP16 dt2 = fpmul(dt, dt);
+	FP16 dt3 = fpmul(dt2, dt);
+	return fpmul(v0, dt) + fpmul(a, dt2) / 2 + fpmul(j, dt3) / 6;
+}
+
+/********************************************************************
+* planPosition()
+*
+* calculate the trajectory parameters for a position-velocity move into
+* the given segment set.  All arithmetic is integer.  Transition times
+* carry 16 fractional bits, so each segment value is within a few
+* counts of 1/65536 of the exact profile.  Acceleration must be less
+* than 16384 steps per sample period squared and the transient must be
+* shorter than 65536 sample periods.
+*
+* parameters:
+*   plan - the segment set to fill in
+*   active_position - the signed number of steps to move
+*   active_velocity - the 15.16 signed plateau velocity
+*   active_acceleration - the 15.16 signed average acceleration
+*   active_scurve - nonzero for an s-curve, zero for a trapezoid
+*/
+static void planPosition(VProfilePlan *plan, long active_position, long active_velocity, long active_acceleration, char active_scurve)
 {
-	// TODO - need to perform special case where position = 0
-	
-	float t2 = FP16_TO_FLOAT(active_velocity) / FP16_TO_FLOAT(active_acceleration);
-	// for scurve, average_acceleration = (1/2) peak_acceleration
+	unsigned long position = labs(active_position);
+	unsigned long velocity = labs(active_velocity);
+	unsigned long acceleration = labs(active_acceleration);
+	unsigned long frac;
 
-	// calculate the distance traveled if the the trajectory accelerates fully to
-	// the plateau velocity.
-	float xt2 = 0.5f * FP16_TO_FLOAT(active_acceleration) * t2 * t2;
-	float t3 = t2 + ((float)active_position-2.0f*xt2) / FP16_TO_FLOAT(active_velocity);
-	float jerk = 0.0f;
-	float vprofile = FP16_TO_FLOAT(active_velocity);
+	// t2 is the duration of the acceleration transient and t3 is the
+	// start of the deceleration transient.  For a full profile t3 is
+	// deltax / velocity.  Both have 16 fractional bits.
+	unsigned long t2 = (acceleration) ? fpdiv(velocity, acceleration, 16, 0) : 0;
+	unsigned long t3w = (velocity) ? fpdiv(position, velocity, 16, &frac) : 0;
+	unsigned int t3f = (velocity) ? (unsigned int)(frac >> 16) : 0;
+	FP16 vprofile = active_velocity;
 
-	if (active_scurve) jerk = FP16_TO_FLOAT(active_acceleration) * 4.0f / t2;
-	if (fabs(xt2) >= fabs((float)active_position) / 2.0f) {
+	if ((t3w < (t2 >> 16)) || ((t3w == (t2 >> 16)) && (t3f <= (t2 & 0xFFFF)))) {
 		// truncated - average acceleration remains as requested transient and
-		// plateau times change
-		t2 = sqrt((float)active_position / FP16_TO_FLOAT(active_acceleration));
-		t3 = t2;
-		xt2 = 0.5f * FP16_TO_FLOAT(active_acceleration) * t2 * t2;
+		// plateau times change.  t2 = sqrt(deltax / acceleration) with 32
+		// fractional bits under the root.
+		unsigned long t22 = (acceleration) ? fpdiv(position, acceleration, 16, &frac) : 0;
+		t2 = (acceleration) ? isqrt(((unsigned long long)t22 << 32) | frac) : 0;
+		t3w = t2 >> 16;
+		t3f = t2 & 0xFFFF;
 		// calculate the plateau velocity
-		if (active_scurve) jerk = FP16_TO_FLOAT(active_acceleration)*4.0f / t2;
-		vprofile = FP16_TO_FLOAT(active_acceleration) * t2;
+		vprofile = fpmul(active_acceleration, t2);
+	}
+
+	// for scurve, average_acceleration = (1/2) peak_acceleration
+	FP16 jerk = 0;
+	if ((active_scurve) && (t2)) {
+		jerk = fpdiv(acceleration * 4, t2, 16, 0);
+		if (active_acceleration < 0) jerk = -jerk;
 	}
-	// float dxt3 = (float)active_position - 2.0 * xt2;
+	FP16 a = active_acceleration;
 
 	// calculate the time points for each transition
-	// half way through the acceleration transient
-	gt1 = (long)(t2 / 2.0 + 1.0);
-	gt2 = (long)(t2 + 1.0);
-	gt3 = (long)(t3)+1;
-	gt4 = (long)(t3 + t2 / 2.0 + 1.0);
-	gt5 = (long)(t3 + t2 + 1.0);
-
-	float deltat;
-	deltat = (float)gt1 - (t2 / 2.0f);
-	gdx1 = (active_scurve) ?
-		calc_dx(vprofile/2.0, +2.0f * FP16_TO_FLOAT(active_acceleration), -jerk, deltat) :
-		calc_dx(vprofile / 2.0, +FP16_TO_FLOAT(active_acceleration), 0.0f, deltat);
-	gdx1 -= (active_scurve) ?
-		calc_dx(vprofile / 2.0, 2.0f * FP16_TO_FLOAT(active_acceleration), jerk, (deltat - 1.0f)) :
-		calc_dx(vprofile / 2.0, FP16_TO_FLOAT(active_acceleration), 0.0f, (deltat - 1.0f));
-	gv1 = (active_scurve) ?
-		calc_v(vprofile / 2.0, + 2.0f * FP16_TO_FLOAT(active_acceleration),-jerk,deltat) :
-		calc_v(vprofile / 2.0, + FP16_TO_FLOAT(active_acceleration), 0.0f, deltat);
-	ga1 = FLOAT_TO_FP16((active_scurve) ?
-		2.0f * FP16_TO_FLOAT(active_acceleration) - jerk * deltat :
-		FP16_TO_FLOAT(active_acceleration));
-	gj1 = FLOAT_TO_FP16((active_scurve) ?-jerk : 0.0f);
-	gj1_6 = gj1 / 6;
-
-	deltat = (float)gt2 - t2;
-	gdx2 = calc_dx(vprofile, 0, 0, deltat);
-	gdx2 -= (active_scurve) ?
-		calc_dx(vprofile, 0, -jerk, (deltat - 1.0f)) :
-		calc_dx(vprofile, FP16_TO_FLOAT(active_acceleration), 0.0f, (deltat - 1.0f));
-	gv2 = FLOAT_TO_FP16(vprofile);
-	ga2 = 0;
-	gj2 = 0;
-	gj2_6 = gj2 / 6;
-
-	deltat = (float)gt3 - t3;
-	gdx3 = (active_scurve) ?
+	FP16 dt1, dt2, dt3, dt4, dt5;
+	unsigned long t4 = ((unsigned long)t3f) + (t2 >> 1);
+	unsigned long t5 = ((unsigned long)t3f) + t2;
+	plan->gt1 = transition(t2 >> 17, (t2 >> 1) & 0xFFFF, &dt1);
+	plan->gt2 = transition(t2 >> 16, t2 & 0xFFFF, &dt2);
+	plan->gt3 = transition(t3w, t3f, &dt3);
+	plan->gt4 = transition(t3w + (t4 >> 16), t4 & 0xFFFF, &dt4);
+	plan->gt5 = transition(t3w + (t5 >> 16), t5 & 0xFFFF, &dt5);
+
+	FP16 deltat = dt1;
+	plan->gdx1 = (active_scurve) ?
+		calc_dx(vprofile / 2, 2 * a, -jerk, deltat) :
+		calc_dx(vprofile / 2, a, 0, deltat);
+	plan->gdx1 -= (active_scurve) ?
+		calc_dx(vprofile / 2, 2 * a, jerk, deltat - 65536L) :
+		calc_dx(vprofile / 2, a, 0, deltat - 65536L);
+	plan->gv1 = (active_scurve) ?
+		calc_v(vprofile / 2, 2 * a, -jerk, deltat) :
+		calc_v(vprofile / 2, a, 0, deltat);
+	plan->ga1 = (active_scurve) ? 2 * a - fpmul(jerk, deltat) : a;
+	plan->gj1 = (active_scurve) ? -jerk : 0;
+	plan->gj1_6 = plan->gj1 / 6;
+
+	deltat = dt2;
+	plan->gdx2 = calc_dx(vprofile, 0, 0, deltat);
+	plan->gdx2 -= (active_scurve) ?
+		calc_dx(vprofile, 0, -jerk, deltat - 65536L) :
+		calc_dx(vprofile, a, 0, deltat - 65536L);
+	plan->gv2 = vprofile;
+	plan->ga2 = 0;
+	plan->gj2 = 0;
+	plan->gj2_6 = plan->gj2 / 6;
+
+	deltat = dt3;
+	plan->gdx3 = (active_scurve) ?
 		calc_dx(vprofile, 0, -jerk, deltat) :
-		calc_dx(vprofile, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
-	if (gt2 == gt3) {
+		calc_dx(vprofile, -a, 0, deltat);
+	if (plan->gt2 == plan->gt3) {
 		// truncated waveform
-		gdx3 -= (active_scurve) ?
-			calc_dx(vprofile, 0, -jerk, (deltat - 1.0f)) :
-			calc_dx(vprofile, FP16_TO_FLOAT(active_acceleration), 0.0f, (deltat - 1.0f));
+		plan->gdx3 -= (active_scurve) ?
+			calc_dx(vprofile, 0, -jerk, deltat - 65536L) :
+			calc_dx(vprofile, a, 0, deltat - 65536L);
 	}
 	else {
 		// full waveform
-		gdx3 -= (active_scurve) ?
-			calc_dx(vprofile, 0, 0, (deltat - 1.0)) :
-			calc_dx(vprofile, 0, 0.0f, (deltat - 1.0));
+		plan->gdx3 -= calc_dx(vprofile, 0, 0, deltat - 65536L);
 	}
-	gv3 = (active_scurve) ?
+	plan->gv3 = (active_scurve) ?
 		calc_v(vprofile, 0, -jerk, deltat) :
-		calc_v(vprofile, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
-	ga3 = FLOAT_TO_FP16((active_scurve) ?- jerk * deltat : FP16_TO_FLOAT(-active_acceleration));
-	gj3 = FLOAT_TO_FP16((active_scurve) ? -jerk : 0.0f);
-	gj3_6 = gj3 / 6;
-
-	deltat = (float)gt4 - (t3 + t2 / 2.0f);
-	gdx4 = (active_scurve) ?
-		calc_dx(vprofile / 2.0f, 2.0f * FP16_TO_FLOAT(-active_acceleration), +jerk, deltat) :
-		calc_dx(vprofile / 2.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
-	gdx4 -= (active_scurve) ?
-		calc_dx(vprofile / 2.0f, 2.0f * FP16_TO_FLOAT(-active_acceleration), -jerk, (deltat-1.0f)) :
-		calc_dx(vprofile / 2.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, (deltat-1.0f));
-	gv4 = (active_scurve) ?
-		calc_v(vprofile/2.0f, 2.0f * FP16_TO_FLOAT(-active_acceleration), +jerk, deltat) :
-		calc_v(vprofile/2.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
-	ga4 = FLOAT_TO_FP16((active_scurve) ?
-		2.0f * FP16_TO_FLOAT(-active_acceleration) + jerk * deltat :
-		FP16_TO_FLOAT(-active_acceleration));
-	gj4 = FLOAT_TO_FP16((active_scurve) ? +jerk : 0.0f);
-	gj4_6 = gj4 / 6;
-
-	deltat = (float)gt5 - (t2 + t3);
-	gdx5 = (active_scurve) ?
-		-calc_dx(0.0f, 0.0f, jerk, (deltat - 1.0f)) :
-		-calc_dx(0.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, (deltat - 1.0f));
+		calc_v(vprofile, -a, 0, deltat);
+	plan->ga3 = (active_scurve) ? -fpmul(jerk, deltat) : -a;
+	plan->gj3 = (active_scurve) ? -jerk : 0;
+	plan->gj3_6 = plan->gj3 / 6;
 
-	current_position = 0;
-	current_velocity = 0;
-	current_jerk = FLOAT_TO_FP16(jerk);
-	current_jerk6 = current_jerk / 6;
-	current_acceleration = (active_scurve) ? 0 : active_acceleration;
-	current_t = gt1;
-	phase = 0;
+	deltat = dt4;
+	plan->gdx4 = (active_scurve) ?
+		calc_dx(vprofile / 2, -2 * a, jerk, deltat) :
+		calc_dx(vprofile / 2, -a, 0, deltat);
+	plan->gdx4 -= (active_scurve) ?
+		calc_dx(vprofile / 2, -2 * a, -jerk, deltat - 65536L) :
+		calc_dx(vprofile / 2, -a, 0, deltat - 65536L);
+	plan->gv4 = (active_scurve) ?
+		calc_v(vprofile / 2, -2 * a, jerk, deltat) :
+		calc_v(vprofile / 2, -a, 0, deltat);
+	plan->ga4 = (active_scurve) ? -2 * a + fpmul(jerk, deltat) : -a;
+	plan->gj4 = (active_scurve) ? jerk : 0;
+	plan->gj4_6 = plan->gj4 / 6;
+
+	deltat = dt5;
+	plan->gdx5 = (active_scurve) ?
+		-calc_dx(0, 0, jerk, deltat - 65536L) :
+		-calc_dx(0, -a, 0, deltat - 65536L);
+
+	plan->velocity = 0;
+	plan->jerk = jerk;
+	plan->acceleration = (active_scurve) ? 0 : active_acceleration;
 }
 
 /********************************************************************
-* vprofiler_startv()
+* planVelocity()
+*
+* calculate the trajectory parameters for a controlled velocity slew
+* into the given segment set.  All arithmetic is integer with the same
+* precision and limits as planPosition().
 *
-* calculate the trajectory parameters for the most recently requested
-* controlled velocity motion.  This routine calculates parameters for 
-* controlled velocity motion, for position-velocity moves, use 
-* vprofiler_start().
+* parameters:
+*   plan - the segment set to fill in
+*   current_velocity - the 15.16 velocity the slew begins from
+*   active_velocity - the 15.16 signed target velocity
+*   active_acceleration - the 15.16 signed average acceleration
+*   active_scurve - nonzero for an s-curve, zero for a trapezoid
 */
-void vprofiler_startv()
+static void planVelocity(VProfilePlan *plan, long current_velocity, long active_velocity, long active_acceleration, char active_scurve)
 {
-	float t2 = FP16_TO_FLOAT(active_velocity-current_velocity) / FP16_TO_FLOAT(active_acceleration);
-	if (t2<0) {
+	// the acceleration takes the direction of the velocity change
+	FP16 dv = active_velocity - current_velocity;
+	unsigned long acceleration = labs(active_acceleration);
+	if (((dv < 0) && (active_acceleration > 0)) || ((dv > 0) && (active_acceleration < 0))) {
 		active_acceleration = -active_acceleration;
-		t2 = -t2;
 	}
+	unsigned long t2 = (acceleration) ? fpdiv(labs(dv), acceleration, 16, 0) : 0;
 
 	// calculate the jerk for scurve moves
-	float jerk = 0.0f;
-	float vplateau = FP16_TO_FLOAT(active_velocity);	
-	if (active_scurve) jerk = FP16_TO_FLOAT(active_acceleration) * 4.0f / t2;
+	FP16 jerk = 0;
+	if ((active_scurve) && (t2)) {
+		jerk = fpdiv(acceleration * 4, t2, 16, 0);
+		if (active_acceleration < 0) jerk = -jerk;
+	}
+	FP16 a = active_acceleration;
 
 	// calculate the time points for each transition.
-	gt1 = (long)(t2 / 2.0 + 1.0);  	// half way through the acceleration transient
-	gt2 = (long)(t2 + 1.0);			// the beginning of the constant velocity phase
+	FP16 dt1, dt2;
+	plan->gt1 = transition(t2 >> 17, (t2 >> 1) & 0xFFFF, &dt1);  	// half way through the acceleration transient
+	plan->gt2 = transition(t2 >> 16, t2 & 0xFFFF, &dt2);			// the beginning of the constant velocity phase
+	plan->gt3 = plan->gt4 = plan->gt5 = 0x7FFFFFFFL;				// the plateau is held until the next move
 
-	// gv1 is the velocity at the sample period immediately at (or after) the first
-	// transition point.  ga1 is the acceleration immediately at (or after) the first
+	// plan->gv1 is the velocity at the sample period immediately at (or after) the first
+	// transition point.  plan->ga1 is the acceleration immediately at (or after) the first
 	// transition point.
-	float deltat;
-	deltat = (float)gt1 - (t2 / 2.0f);
-	gv1 = (active_scurve) ?
-		calc_v(((FP16_TO_FLOAT(current_velocity)) + vplateau) / 2.0, + 2.0f * FP16_TO_FLOAT(active_acceleration),-jerk,deltat) :
-		calc_v(((FP16_TO_FLOAT(current_velocity)) + vplateau) / 2.0, + FP16_TO_FLOAT(active_acceleration), 0.0f, deltat);
-	ga1 = FLOAT_TO_FP16((active_scurve) ?
-		2.0f * FP16_TO_FLOAT(active_acceleration) - jerk * deltat :
-		FP16_TO_FLOAT(active_acceleration));
-	gj1 = FLOAT_TO_FP16((active_scurve) ?-jerk : 0.0f);
-	gj1_6 = gj1 / 6;
-
-	// gv2 is the velocity at the sample period immediately at (or after) the second
-	// transition point.  ga1 is the acceleration immediately at (or after) the second
+	FP16 deltat = dt1;
+	plan->gv1 = (active_scurve) ?
+		calc_v((current_velocity / 2) + (active_velocity / 2), 2 * a, -jerk, deltat) :
+		calc_v((current_velocity / 2) + (active_velocity / 2), a, 0, deltat);
+	plan->ga1 = (active_scurve) ? 2 * a - fpmul(jerk, deltat) : a;
+	plan->gj1 = (active_scurve) ? -jerk : 0;
+	plan->gj1_6 = plan->gj1 / 6;
+
+	// plan->gv2 is the velocity at the sample period immediately at (or after) the second
+	// transition point.  plan->ga1 is the acceleration immediately at (or after) the second
 	// transition point.
-	deltat = (float)gt2 - t2;
-	gv2 = FLOAT_TO_FP16(vplateau);
-	ga2 = 0;
-	gj2 = 0;
-	gj2_6 = gj2 / 6;
-
-	// current_velocity = current_velocity;  - Begin slew at the current velocity
-	current_jerk = FLOAT_TO_FP16(jerk);
+	plan->gv2 = active_velocity;
+	plan->ga2 = 0;
+	plan->gj2 = 0;
+	plan->gj2_6 = plan->gj2 / 6;
+
+	// the slew begins at the current velocity
+	plan->velocity = current_velocity;
+	plan->jerk = jerk;
+	plan->acceleration = (active_scurve) ? 0 : active_acceleration;
+}
+
+/********************************************************************
+* reachable()
+*
+* return the velocity that can be reached from a starting velocity over
+* a distance at a constant acceleration, sqrt(v^2 + 2ax).  The result
+* saturates at the largest 15.16 value.
+*
+* parameters:
+*   velocity - the 15.16 starting velocity magnitude
+*   acceleration - the 15.16 acceleration magnitude
+*   distance - the distance in steps
+*/
+static unsigned long reachable(unsigned long velocity, unsigned long acceleration, unsigned long distance) {
+	unsigned long long ad = (unsigned long long)acceleration * distance;
+	if (ad >= (1ULL << 46)) return 0x7FFFFFFF;
+	unsigned long result = isqrt((ad << 17) + (unsigned long long)velocity * velocity);
+	return (result > 0x7FFFFFFF) ? 0x7FFFFFFF : result;
+}
+
+/********************************************************************
+* moveLimit()
+*
+* limit a junction velocity to the plateau velocity of a queued move and
+* to the speed at which the move still takes four sample periods, the
+* shortest blended segment.
+*/
+static unsigned long moveLimit(QueuedMove *move, unsigned long velocity) {
+	unsigned long long quarter = ((unsigned long long)labs(move->deltax)) << 14;
+	if (velocity > (unsigned long)labs(move->velocity)) velocity = labs(move->velocity);
+	if (velocity > quarter) velocity = quarter;
+	return velocity;
+}
+
+/********************************************************************
+* blendReachable()
+*
+* return the fastest junction velocity a queued move can ramp to (or
+* from) given the velocity at its other end.  Whole-frame ramps and the
+* shortest plateau and final ramp use about three sample periods more
+* than the continuous profile, so that distance is held back.
+*/
+static unsigned long blendReachable(QueuedMove *move, unsigned long velocity) {
+	unsigned long x = labs(move->deltax);
+	unsigned long a = labs(move->acceleration);
+	unsigned long margin = (unsigned long)(((unsigned long long)moveLimit(move, reachable(velocity, a, x)) * 3) >> 16);
+	return moveLimit(move, reachable(velocity, a, (x > margin) ? x - margin : 0));
+}
+
+/********************************************************************
+* exitVelocity()
+*
+* look ahead through the queued moves to find the fastest velocity at
+* which a move can hand over to the next one.  Working back from a stop
+* at the end of the queue, each junction is limited so that the later
+* moves can still slow to their own exits.  The path stops wherever the
+* direction changes.
+*
+* parameters:
+*   move - the move being planned
+*   entry - the 15.16 velocity at which the move begins
+*   head - the index of the first move queued after this one
+*   tail - the index after the last queued move
+* returns:
+*   the 15.16 exit velocity magnitude
+*/
+static unsigned long exitVelocity(QueuedMove *move, FP16 entry, unsigned char head, unsigned char tail) {
+	unsigned long exit = 0;
+	unsigned char i = tail;
+	while (i != head) {
+		QueuedMove *later = &moveQueue[(unsigned char)(i - 1) % VPROFILER_QUEUE_SIZE];
+		QueuedMove *earlier = ((unsigned char)(i - 1) == head) ? move : &moveQueue[(unsigned char)(i - 2) % VPROFILER_QUEUE_SIZE];
+		unsigned long velocity = blendReachable(later, exit);
+		if ((later->deltax < 0) != (earlier->deltax < 0)) velocity = 0;
+		exit = moveLimit(earlier, velocity);
+		i--;
+	}
+
+	// the move itself must be able to reach its exit from its entry
+	unsigned long velocity = blendReachable(move, labs(entry));
+	return (exit < velocity) ? exit : velocity;
+}
+
+/********************************************************************
+* rampFrames()
+*
+* return the whole number of sample periods needed to ramp between two
+* velocity magnitudes at an acceleration, but no fewer than minimum.
+*/
+static unsigned long rampFrames(unsigned long from, unsigned long to, unsigned long acceleration, unsigned long minimum) {
+	unsigned long frames = (to > from) ? (to - from + acceleration - 1) / acceleration : 0;
+	return (frames < minimum) ? minimum : frames;
+}
+
+/********************************************************************
+* solvePlateau()
+*
+* return the plateau velocity at which a blended move with the given
+* ramp and plateau lengths covers exactly its distance.  The velocities
+* emitted over the move sum to
+*   vp*((n1-1)/2 + n2 + (n3-1)/2) + entry*(n1+1)/2 + exit*(n3+1)/2
+* If the ramps alone are too long the shortest layout is used instead.
+*/
+static FP16 solvePlateau(unsigned long long x16, unsigned long entry, unsigned long exit, unsigned long *n1, unsigned long *n2, unsigned long *n3) {
+	long long num = (long long)(x16 * 2) - (long long)entry * (*n1 + 1) - (long long)exit * (*n3 + 1);
+	if (num < 0) {
+		*n1 = 1;
+		*n2 = 1;
+		*n3 = 2;
+		num = (long long)(x16 * 2) - (long long)entry * 2 - (long long)exit * 3;
+	}
+	return (num > 0) ? (FP16)(num / (long long)(*n1 + 2 * *n2 + *n3 - 2)) : 0;
+}
+
+/********************************************************************
+* blendDistance()
+*
+* return the exact sum, in 15.16 steps, of the velocities emitted by a
+* blended move using the truncated ramp accelerations of planBlend().
+*/
+static long long blendDistance(FP16 vp, unsigned long entry, unsigned long exit, unsigned long n1, unsigned long n2, unsigned long n3) {
+	FP16 a1 = (vp - (FP16)entry) / (FP16)n1;
+	FP16 a3 = (vp - (FP16)exit) / (FP16)n3;
+	return (long long)entry * n1 + (long long)a1 * (n1 * (n1 - 1) / 2) +
+		(long long)vp * (n2 + n3) - (long long)a3 * (n3 * (n3 + 1) / 2);
+}
+
+/********************************************************************
+* planBlend()
+*
+* calculate a trapezoidal profile that begins and ends at nonzero
+* velocities for a move in a blended path.  The ramp and plateau
+* lengths are whole sample periods and the plateau velocity is solved
+* so that the velocities emitted by the control loop sum to exactly
+* deltax.  The ramps may be slightly gentler than the requested
+* acceleration as a result.
+*
+* parameters:
+*   plan - the segment set to fill in
+*   deltax - the signed number of steps to move
+*   entry - the 15.16 velocity magnitude at the start of the move
+*   velocity - the 15.16 plateau velocity
+*   exit - the 15.16 velocity magnitude at the end of the move
+*   acceleration - the 15.16 acceleration
+* returns:
+*   the 15.16 exit velocity magnitude actually planned
+*/
+static unsigned long planBlend(VProfilePlan *plan, long deltax, unsigned long entry, FP16 velocity, unsigned long exit, FP16 acceleration)
+{
+	unsigned long long x16 = ((unsigned long long)labs(deltax)) << 16;
+	unsigned long v = labs(velocity);
+	unsigned long a = labs(acceleration);
+	unsigned long n1, n2, n3;
+	unsigned long long ramps;
+
+	// frames spent on each ramp at the requested plateau velocity
+	n1 = rampFrames(entry, v, a, 1);
+	n3 = rampFrames(exit, v, a, 2);
+	ramps = ((unsigned long long)(entry + v) * n1 + (unsigned long long)(v + exit) * n3) / 2;
+	if (ramps + v > x16) {
+		// too short to reach the requested velocity - use the peak
+		// velocity, sqrt(ax + (entry^2 + exit^2)/2)
+		unsigned long peak = isqrt((((unsigned long long)a * labs(deltax)) << 16) +
+			((unsigned long long)entry * entry + (unsigned long long)exit * exit) / 2);
+		if (peak < v) v = peak;
+		n1 = rampFrames(entry, v, a, 1);
+		n3 = rampFrames(exit, v, a, 2);
+		ramps = ((unsigned long long)(entry + v) * n1 + (unsigned long long)(v + exit) * n3) / 2;
+	}
+	n2 = ((v) && (ramps + v < x16)) ? (unsigned long)((x16 - ramps + v - 1) / v) : 1;
+
+	// solve the plateau velocity for the exact distance.  Whole-frame
+	// ramps can leave a short move unable to reach its exit, in which
+	// case the exit is lowered to the plateau and the plateau solved
+	// again, which can only raise it.
+	FP16 vp = solvePlateau(x16, entry, exit, &n1, &n2, &n3);
+	if (vp < (FP16)exit) {
+		exit = vp;
+		vp = solvePlateau(x16, entry, exit, &n1, &n2, &n3);
+	}
+
+	// the ramps step by truncated accelerations, so correct the plateau
+	// against the exact sum and put the remaining counts into a single
+	// plateau sample
+	unsigned char i;
+	for (i = 0; i < 2; i++) {
+		vp += (FP16)((2 * ((long long)x16 - blendDistance(vp, entry, exit, n1, n2, n3))) / (long long)(n1 + 2 * n2 + n3 - 2));
+	}
+	FP16 residual = (FP16)((long long)x16 - blendDistance(vp, entry, exit, n1, n2, n3));
+	FP16 a1 = (vp - (FP16)entry) / (FP16)n1;
+	FP16 a3 = (vp - (FP16)exit) / (FP16)n3;
+	char sign = (deltax < 0) ? -1 : 1;
+
+	// ramp up to the first transition and hold the plateau.  The last
+	// plateau sample carries the residual (phase 1 is skipped for a one
+	// sample plateau).  Then ramp down with a reload half way.
+	plan->gt1 = n1;
+	plan->gt3 = n1 + n2;
+	plan->gt2 = (n2 > 1) ? plan->gt3 - 1 : plan->gt3;
+	plan->gt4 = plan->gt3 + n3 / 2;
+	plan->gt5 = plan->gt3 + n3;
+	plan->gv1 = sign * ((n2 > 1) ? vp : vp + residual);
+	plan->ga1 = 0;
+	plan->gv2 = sign * (vp + residual);
+	plan->ga2 = 0;
+	plan->gv3 = sign * (vp - a3);
+	plan->ga3 = -sign * a3;
+	plan->gv4 = sign * (vp - a3 * (FP16)(n3 / 2 + 1));
+	plan->ga4 = -sign * a3;
+	plan->gdx1 = plan->gdx2 = plan->gdx3 = plan->gdx4 = plan->gdx5 = 0;
+	plan->gj1 = plan->gj2 = plan->gj3 = plan->gj4 = 0;
+	plan->gj1_6 = plan->gj2_6 = plan->gj3_6 = plan->gj4_6 = 0;
+
+	plan->velocity = sign * (FP16)entry;
+	plan->jerk = 0;
+	plan->acceleration = sign * a1;
+	return exit;
+}
+
+/********************************************************************
+* requestPlan()
+*
+* ask the main loop to plan a new profile from the most recently set
+* motion parameters.  Any plan that is in progress or waiting to be
+* swapped in is discarded.  The trajectory holds its present velocity
+* until the new plan becomes active.
+*
+* parameters:
+*   kind - PLAN_POSITION or PLAN_VELOCITY
+*/
+static void requestPlan(char kind)
+{
+	unsigned char sreg = SREG;
+	__builtin_avr_cli();
+	planSequence++;
+	planReady = 0;
+	planRequest = kind;
+	phase = PHASE_PENDING;
+	SREG = sreg;
+}
+
+/********************************************************************
+* vprofiler_start()
+*
+* request a position-velocity move using the most recently set motion
+* parameters.  The segments are calculated by vprofiler_plan() from the
+* main loop and the move begins at the first sample period after the
+* plan is ready.  For velocity only moves, use vprofiler_startv().
+*/
+void vprofiler_start()
+{
+	requestPlan(PLAN_POSITION);
+}
+
+/********************************************************************
+* vprofiler_startv()
+*
+* request a controlled velocity slew using the most recently set motion
+* parameters.  The slew begins from the velocity held while the plan is
+* being calculated.  For position-velocity moves, use vprofiler_start().
+*/
+void vprofiler_startv()
+{
+	requestPlan(PLAN_VELOCITY);
+}
+
+/********************************************************************
+* vprofiler_plan()
+*
+* calculate any requested profile into the inactive segment set.  This
+* function performs the arithmetic for a new move and should be
+* called from the main loop rather than the control loop.  The plan is
+* only published if no newer request arrived while it was calculated.
+*/
+void vprofiler_plan()
+{
+	unsigned char sreg = SREG;
+	__builtin_avr_cli();
+	char kind = planRequest;
+	unsigned char sequence = planSequence;
+	long position = active_position;
+	long velocity = active_velocity;
+	long acceleration = active_acceleration;
+	char scurve = active_scurve;
+	long v0 = current_velocity;
+	QueuedMove move;
+	planRequest = PLAN_NONE;
+
+	// a running queued path takes its next move once the previous plan
+	// has been swapped in
+	if ((kind == PLAN_NONE) && (queueActive) && (!planReady) && (queueHead != queueTail)) {
+		kind = PLAN_QUEUE;
+		move = moveQueue[queueHead % VPROFILER_QUEUE_SIZE];
+		queueHead++;
+		queuePlanning = 1;
+		v0 = queueVelocity;
+	}
+	unsigned char head = queueHead;
+	unsigned char tail = queueTail;
+	SREG = sreg;
+
+	unsigned long exit = 0;
+	if (kind == PLAN_NONE) return;
+	if (kind == PLAN_POSITION) {
+		planPosition(nextPlan, position, velocity, acceleration, scurve);
+	} else if (kind == PLAN_VELOCITY) {
+		planVelocity(nextPlan, v0, velocity, acceleration, scurve);
+	} else {
+		exit = exitVelocity(&move, v0, head, tail);
+		exit = planBlend(nextPlan, move.deltax, labs(v0), move.velocity, exit, move.acceleration);
+	}
+
+	// publish the plan unless it was superseded while being calculated
+	sreg = SREG;
+	__builtin_avr_cli();
+	if (sequence == planSequence) {
+		planReady = 1;
+		if (kind == PLAN_QUEUE) queueVelocity = (move.deltax < 0) ? -(FP16)exit : (FP16)exit;
+	}
+	if (kind == PLAN_QUEUE) queuePlanning = 0;
+	SREG = sreg;
+}
+
+/********************************************************************
+* swapPlan()
+*
+* make the newly calculated segment set active and load the starting
+* conditions for its first phase.  Called from the control loop at a
+* sample period boundary.
+*/
+static void swapPlan()
+{
+	VProfilePlan *plan = nextPlan;
+	nextPlan = activePlan;
+	activePlan = plan;
+	planReady = 0;
+
+	current_position = 0;
+	current_velocity = plan->velocity;
+	current_jerk = plan->jerk;
 	current_jerk6 = current_jerk / 6;
-	current_acceleration = (active_scurve) ? 0 : active_acceleration;
-	current_t = gt1;
+	current_acceleration = plan->acceleration;
+	current_t = plan->gt1;
 	phase = 0;
 }
 
+/********************************************************************
+* cancelPlan()
+*
+* discard any plan that has not started and abandon a running queued
+* path along with the moves left in the queue.  Called from the control
+* loop.
+*/
+static void cancelPlan()
+{
+	planSequence++;
+	planRequest = PLAN_NONE;
+	planReady = 0;
+	if (queueActive) {
+		queueActive = 0;
+		queueHead = queueTail;
+	}
+}
+
+/********************************************************************
+* vprofiler_queueMove()
+*
+* add a move to the end of the queued path.  Called from the main loop.
+*
+* parameters:
+*   deltax - the signed number of steps from the end of the previous
+*      queued move
+*   velocity - the 15.16 plateau velocity of the move
+*   acceleration - the 15.16 acceleration of the move
+* returns:
+*   nonzero if the move was queued, zero if the queue is full
+*/
+unsigned char vprofiler_queueMove(long deltax, FP16 velocity, FP16 acceleration)
+{
+	if ((unsigned char)(queueTail - queueHead) >= VPROFILER_QUEUE_SIZE) return 0;
+	QueuedMove *move = &moveQueue[queueTail % VPROFILER_QUEUE_SIZE];
+	move->deltax = deltax;
+	move->velocity = labs(velocity);
+	move->acceleration = labs(acceleration);
+	queueTail++;
+	return 1;
+}
+
+/********************************************************************
+* vprofiler_getQueueCount()
+*
+* return the number of queued moves that have not yet been planned.
+*/
+unsigned char vprofiler_getQueueCount()
+{
+	return (unsigned char)(queueTail - queueHead);
+}
+
+/********************************************************************
+* vprofiler_isQueueActive()
+*
+* return nonzero while a queued path is being followed.
+*/
+unsigned char vprofiler_isQueueActive()
+{
+	return queueActive;
+}
+
+/********************************************************************
+* vprofiler_startQueue()
+*
+* begin following the queued path from rest.  The moves are planned by
+* vprofiler_plan() one ahead of the move being executed and each hands
+* over to the next at its junction velocity.  Called from the control
+* loop.
+*/
+void vprofiler_startQueue()
+{
+	planSequence++;
+	planRequest = PLAN_NONE;
+	planReady = 0;
+	queueVelocity = 0;
+	queueActive = 1;
+	phase = PHASE_PENDING;
+}
+
+/********************************************************************
+* vprofiler_stopQueue()
+*
+* abandon a running queued path and flush the moves left in the queue.
+* Called from the control loop.
+*/
+void vprofiler_stopQueue()
+{
+	if (queueActive) cancelPlan();
+}
+
 void vprofiler_stop()
 {
     estop = 1;
@@ -286,65 +858,99 @@ void vprofiler_update() {
         phase = 5;
         estop = 0;
         current_t = dwell;
+
+        // discard any plan that has not started
+        cancelPlan();
     }
-	if (current_t == 1) {
-		switch (phase) {
-			case 0:
-				// second half of acceleration transient
-				current_position = gdx1;
-				current_velocity = gv1;
-				current_acceleration = ga1;
-				current_jerk = gj1;
-				current_jerk6 = gj1_6;
-				current_t = gt2 - gt1;
-				phase = (gt2 == gt3) ? 2 : 1;
-				break;
-			case 1:
-				// start of velocity plateau
-				current_position = gdx2;
-				current_velocity = gv2;
-				current_acceleration = ga2;
-				current_jerk = gj2;
-				current_jerk6 = gj2_6;
-				current_t = gt3 - gt2;
-				phase = 2;
-				break;
-			case 2:
-				// end of velocity plateau
-				current_position = gdx3;
-				current_velocity = gv3;
-				current_acceleration = ga3;
-				current_jerk = gj3;
-				current_jerk6 = gj3_6;
-				current_t = gt4 - gt3;
-				phase = 3;
-				break;
-			case 3:
-				// second half of deceleration transient
-				current_position = gdx4;
-				current_velocity = gv4;
-				current_acceleration = ga4;
-				current_jerk = gj4;
-				current_jerk6 = gj4_6;
-				phase = 4;
-				current_t = gt5 - gt4;
-				break;
-			case 4:
-				// completion of motion
-				current_position = gdx5;
-				current_velocity = 0;
-				current_acceleration = 0;
-				current_jerk = 0;
-				current_jerk6 = 0;
-				phase = 5;
-				current_t = dwell;
-				break;
-			default:
-				// dwell time expired
-				current_t = 0xFFFFFFFF;
-				phase = 0x7F;
-				break;
+	if (phase == PHASE_PENDING) {
+		// hold the present velocity until the requested plan is ready
+		// then make it active at this sample period boundary
+		if (planReady) {
+			swapPlan();
+		} else {
+			current_position = current_velocity;
 		}
+		return;
+	}
+	if (current_t == 1) {
+		// a phase shorter than a frame ends in the frame it starts, so
+		// the phases are loaded until one ends in a later frame.  The
+		// frame takes the values of the last transition within it.
+		do {
+			switch (phase) {
+				case 0:
+					// second half of acceleration transient
+					current_position = activePlan->gdx1;
+					current_velocity = activePlan->gv1;
+					current_acceleration = activePlan->ga1;
+					current_jerk = activePlan->gj1;
+					current_jerk6 = activePlan->gj1_6;
+					current_t = activePlan->gt2 - activePlan->gt1;
+					phase = (activePlan->gt2 == activePlan->gt3) ? 2 : 1;
+					break;
+				case 1:
+					// start of velocity plateau
+					current_position = activePlan->gdx2;
+					current_velocity = activePlan->gv2;
+					current_acceleration = activePlan->ga2;
+					current_jerk = activePlan->gj2;
+					current_jerk6 = activePlan->gj2_6;
+					current_t = activePlan->gt3 - activePlan->gt2;
+					phase = 2;
+					break;
+				case 2:
+					// end of velocity plateau
+					current_position = activePlan->gdx3;
+					current_velocity = activePlan->gv3;
+					current_acceleration = activePlan->ga3;
+					current_jerk = activePlan->gj3;
+					current_jerk6 = activePlan->gj3_6;
+					current_t = activePlan->gt4 - activePlan->gt3;
+					phase = 3;
+					break;
+				case 3:
+					// second half of deceleration transient
+					current_position = activePlan->gdx4;
+					current_velocity = activePlan->gv4;
+					current_acceleration = activePlan->ga4;
+					current_jerk = activePlan->gj4;
+					current_jerk6 = activePlan->gj4_6;
+					phase = 4;
+					current_t = activePlan->gt5 - activePlan->gt4;
+					break;
+				case 4:
+					// a queued path hands over to its next move at this
+					// sample period, holding the velocity if the move is
+					// still being planned
+					if (queueActive) {
+						if (planReady) {
+							swapPlan();
+							break;
+						}
+						if ((queueHead != queueTail) || (queuePlanning)) {
+							phase = PHASE_PENDING;
+							current_position = current_velocity;
+							break;
+						}
+						queueActive = 0;
+					}
+
+					// completion of motion
+					current_position = activePlan->gdx5;
+					current_velocity = 0;
+					current_acceleration = 0;
+					current_jerk = 0;
+					current_jerk6 = 0;
+					phase = 5;
+					current_t = dwell;
+					break;
+				default:
+					// dwell time expired
+					current_t = 0xFFFFFFFF;
+					phase = 0x7F;
+					break;
+			}
+		} while ((current_t < 1) && (phase < 5));
 	}
 	else {
 		current_position = current_velocity + current_acceleration / 2 + current_jerk6;
@@ -370,31 +976,47 @@ void vprofiler_updatev() {
         phase = 5;
         estop = 0;
         current_t = dwell;
+
+        // discard any plan that has not started
+        cancelPlan();
     }
+	if (phase == PHASE_PENDING) {
+		// hold the present velocity until the requested plan is ready
+		// then make it active at this sample period boundary
+		if (planReady) {
+			swapPlan();
+		} else {
+			current_position = current_velocity;
+		}
+		return;
+	}
 	if (current_t == 1) {
 		// current_t is a countdown timer until the end of the 
 		// current motion phase.  When it reaches 1, it is time
-		// to load the parameters for the next motion phase
-		switch (phase) {
-			case 0:
-				// second half of acceleration transient
-				current_velocity = gv1;
-				current_acceleration = ga1;
-				current_jerk = gj1;
-				current_jerk6 = gj1_6;
-				current_t = gt2 - gt1;
-				phase = (gt2 == gt3) ? 2 : 1;
-				break;
-			default:
-				// start of velocity plateau
-				current_velocity = gv2;
-				current_acceleration = ga2;
-				current_jerk = gj2;
-				current_jerk6 = gj2_6;
-				current_t = 10000;   // set current_t above 1
-				phase = 2;
-				break;
-		}
+		// to load the parameters for the next motion phase.  A
+		// transient shorter than a frame goes straight to the plateau.
+		do {
+			switch (phase) {
+				case 0:
+					// second half of acceleration transient
+					current_velocity = activePlan->gv1;
+					current_acceleration = activePlan->ga1;
+					current_jerk = activePlan->gj1;
+					current_jerk6 = activePlan->gj1_6;
+					current_t = activePlan->gt2 - activePlan->gt1;
+					phase = 1;
+					break;
+				default:
+					// start of velocity plateau
+					current_velocity = activePlan->gv2;
+					current_acceleration = activePlan->ga2;
+					current_jerk = activePlan->gj2;
+					current_jerk6 = activePlan->gj2_6;
+					current_t = 10000;   // set current_t above 1
+					phase = 2;
+					break;
+			}
+		} while (current_t < 1);
 	}
 	else {
 		current_position = current_velocity + current_acceleration / 2 + current_jerk6;
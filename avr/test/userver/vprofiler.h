@@ -32,13 +32,22 @@
 #define FP16_TO_FLOAT(x) (((float)(x))/((float)65536.0f))
 #define FLOAT_TO_FP16(x) ((long)((x)*65536.0f))
 
+// the number of moves that can be queued for a blended path
+#define VPROFILER_QUEUE_SIZE 8
+
 void vprofiler_setParameters(long deltax, FP16 velocity, FP16 acceleration, char scurve);
 void vprofiler_start();
 void vprofiler_update();
 void vprofiler_startv();
 void vprofiler_updatev();
+void vprofiler_plan();
 void vprofiler_stop();
 unsigned char vprofiler_isDone();
+unsigned char vprofiler_queueMove(long deltax, FP16 velocity, FP16 acceleration);
+unsigned char vprofiler_getQueueCount();
+unsigned char vprofiler_isQueueActive();
+void vprofiler_startQueue();
+void vprofiler_stopQueue();
 
 extern long current_velocity;
 #endif // VPROFILER_H_INCLUDED
@@ -0,0 +1,8 @@
+//    avr/io.h
+//
+//    This header stands in for the avr-libc register definitions when
+//    the planner sources are compiled for the host.  Only the status
+//    register is used, to hold off interrupts around shared state.
+//
+#pragma once
+extern unsigned char SREG;
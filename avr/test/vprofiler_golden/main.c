@@ -0,0 +1,305 @@
+//*******************************************************************
+//    main.c
+//
+//    This creates a golden test for the fixed point motion profile
+//    planner (userver/vprofiler.c).  A sweep of position moves and
+//    velocity slews is run through both the fixed point planner and the
+//    floating point planner that it replaced, and the results are
+//    compared.  The float planner cannot run moves whose acceleration
+//    transient is shorter than a frame, so those are checked against
+//    the ideal profile instead.  The test is built and run on the host
+//    (see the Makefile).
+//    All of the sources, this one included, are compiled with long 
+//    narrowed to 32 bits so that the arithmetic matches the avr.
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "vprofiler.h"
+#include "vprofiler_float.h"
+
+// the status register used by the planners' critical sections
+unsigned char SREG;
+
+// the limits the fixed point planner must stay within, all measured
+// against the float planner.  The float planner itself misses the end
+// of some s-curve moves by several steps, so the final position error
+// of the fixed point planner may only exceed that of the float planner
+// by POSITION_MARGIN.
+#define POSITION_MARGIN      1.0     // extra final position error (steps)
+#define DURATION_DIFF_LIMIT  2       // move length (frames)
+#define PEAK_DIFF_LIMIT      0.05    // peak velocity (relative)
+#define SLEW_DIFF_LIMIT      0.001   // distance covered by a slew (relative)
+
+// the limits for moves checked against the ideal profile.  A move of a
+// step or two ends within a frame of its ideal end, and the plateau
+// velocity is truncated to 16 fractional bits, which stretches a slow
+// move by a small fraction of its length.
+#define SHORT_POSITION_LIMIT 0.25    // final position error (steps)
+#define SHORT_DURATION_LIMIT 0.001   // move length (relative)
+
+// the dwell time the planners add to the end of a position move
+#define DWELL_FRAMES 10
+
+// the longest move that will be run (in frames)
+#define MAX_FRAMES 2000000L
+
+// one of the two planners under test
+typedef struct {
+    void (*setParameters)(long deltax, FP16 velocity, FP16 acceleration, char scurve);
+    void (*start)();
+    void (*startv)();
+    void (*update)();
+    void (*updatev)();
+    void (*plan)();
+    void (*stop)();
+    unsigned char (*isDone)();
+    long *velocity;
+} Planner;
+
+static Planner fixedPlanner = {
+    vprofiler_setParameters, vprofiler_start, vprofiler_startv,
+    vprofiler_update, vprofiler_updatev, vprofiler_plan, vprofiler_stop,
+    vprofiler_isDone, &current_velocity
+};
+
+static Planner floatPlanner = {
+    vfloat_setParameters, vfloat_start, vfloat_startv,
+    vfloat_update, vfloat_updatev, vfloat_plan, vfloat_stop,
+    vfloat_isDone, &vfloat_velocity
+};
+
+// the result of running one move through a planner
+typedef struct {
+    long frames;          // frames until the move was done
+    double position;      // distance moved (steps)
+    double peak;          // largest velocity (steps/frame)
+    long velocity;        // velocity at the end (FP16)
+} MoveResult;
+
+/********************************************************************
+* runPosition()
+*
+* run a position move through a planner, integrating the velocity
+* until the planner reports that the move is done.
+*/
+static MoveResult runPosition(Planner *p, long deltax, FP16 velocity, FP16 acceleration, char scurve)
+{
+    MoveResult result = { 0, 0.0, 0.0, 0 };
+    long long sum = 0;
+    long peak = 0;
+
+    p->setParameters(deltax, velocity, acceleration, scurve);
+    p->start();
+    p->update();
+    p->plan();
+    p->update();
+    while ((!p->isDone()) && (result.frames < MAX_FRAMES)) {
+        p->update();
+        sum += *p->velocity;
+        if (labs(*p->velocity) > peak) peak = labs(*p->velocity);
+        result.frames++;
+    }
+    result.position = sum/65536.0;
+    result.peak = peak/65536.0;
+    result.velocity = *p->velocity;
+    return result;
+}
+
+/********************************************************************
+* runSlew()
+*
+* bring a planner to a starting velocity, then run a velocity slew
+* to a new velocity for a fixed number of frames.
+*/
+static MoveResult runSlew(Planner *p, FP16 from, FP16 to, FP16 acceleration, char scurve)
+{
+    MoveResult result = { 0, 0.0, 0.0, 0 };
+    long long sum = 0;
+
+    // stopping leaves the velocity at zero.  The float planner never
+    // ends a slew to the velocity that is already held, so it is only
+    // given one if needed.
+    p->stop();
+    p->updatev();
+    if ((from != 0) || (p != &floatPlanner)) {
+        p->setParameters(from, from, 65536L, 0);
+        p->startv();
+        p->updatev();
+        p->plan();
+        p->updatev();
+        for (int i = 0; i < 100; i++) p->updatev();
+    }
+
+    p->setParameters(to, to, acceleration, scurve);
+    p->startv();
+    p->updatev();
+    p->plan();
+    p->updatev();
+    for (result.frames = 0; result.frames < 20000; result.frames++) {
+        p->updatev();
+        sum += *p->velocity;
+    }
+    result.position = sum/65536.0;
+    result.velocity = *p->velocity;
+    return result;
+}
+
+static double absd(double x) {
+    return (x < 0) ? -x : x;
+}
+
+/********************************************************************
+* idealFrames()
+*
+* the length of an ideal trapezoid move that ramps to the velocity
+* (or as close to it as the distance allows) and back to rest.
+*/
+static double idealFrames(double distance, double velocity, double acceleration)
+{
+    if (velocity * velocity / acceleration <= distance) {
+        return distance / velocity + velocity / acceleration;
+    }
+    return 2 * sqrt(distance / acceleration);
+}
+
+int main()
+{
+    static const long distances[] = { 1, 7, 100, 1000, 12345, 200000, 3000000, -5000, -777777 };
+    static const double velocities[] = { 0.05, 0.5, 3, 20, 60 };
+    static const double accelerations[] = { 0.0005, 0.003, 0.01, 0.2, 1.5 };
+    static const double startVelocities[] = { 0, 10, -3 };
+    const int nd = sizeof(distances)/sizeof(distances[0]);
+    const int nv = sizeof(velocities)/sizeof(velocities[0]);
+    const int na = sizeof(accelerations)/sizeof(accelerations[0]);
+    const int ns = sizeof(startVelocities)/sizeof(startVelocities[0]);
+
+    int failures = 0;
+    int moves = 0;
+    double fixedWorst = 0, floatWorst = 0, marginWorst = 0;
+    double diffWorst = 0, diffSum = 0;
+    double peakWorst = 0;
+    long durationWorst = 0;
+    int shortMoves = 0;
+    double shortWorst = 0, stretchWorst = 0;
+
+    // position moves
+    for (char scurve = 0; scurve < 2; scurve++)
+    for (int d = 0; d < nd; d++)
+    for (int v = 0; v < nv; v++)
+    for (int a = 0; a < na; a++) {
+        // skip moves that would never reach speed or take too long to 
+        // run
+        if (accelerations[a] < velocities[v]/30000.0) continue;
+        if (labs(distances[d])/velocities[v] > MAX_FRAMES/2) continue;
+
+        FP16 velocity = (FP16)(velocities[v]*65536);
+        FP16 acceleration = (FP16)(accelerations[a]*65536);
+        MoveResult fx = runPosition(&fixedPlanner, distances[d], velocity, acceleration, scurve);
+
+        // moves that reach full speed or cover the whole distance in
+        // less than two frames are checked against the ideal profile
+        if ((accelerations[a] > velocities[v]/2) || (accelerations[a] > labs(distances[d])/2)) {
+            double error = absd(fx.position - distances[d]);
+            double ideal = idealFrames(labs(distances[d]), velocities[v], accelerations[a]) + DWELL_FRAMES;
+            double stretch = absd(fx.frames - ideal)/ideal;
+            shortMoves++;
+            if (error > shortWorst) shortWorst = error;
+            if (stretch > stretchWorst) stretchWorst = stretch;
+            if ((fx.frames >= MAX_FRAMES) || (error > SHORT_POSITION_LIMIT) || (fx.velocity != 0) ||
+                (fx.peak > velocities[v]*(1 + PEAK_DIFF_LIMIT)) ||
+                (absd(fx.frames - ideal) > ideal*SHORT_DURATION_LIMIT + DURATION_DIFF_LIMIT)) {
+                printf("FAIL short move %d v %g a %g scurve %d: fixed %d frames %.3f steps peak %.4f, "
+                    "ideal %.0f frames\n",
+                    (int)distances[d], velocities[v], accelerations[a], scurve,
+                    (int)fx.frames, fx.position, fx.peak, ideal);
+                failures++;
+            }
+            continue;
+        }
+        MoveResult fl = runPosition(&floatPlanner, distances[d], velocity, acceleration, scurve);
+
+        double fixedError = absd(fx.position - distances[d]);
+        double floatError = absd(fl.position - distances[d]);
+        double diff = absd(fx.position - fl.position);
+        double peak = (fl.peak > 0) ? absd(fx.peak - fl.peak)/fl.peak : 0;
+        long duration = labs(fx.frames - fl.frames);
+        moves++;
+        diffSum += diff;
+        if (fixedError > fixedWorst) fixedWorst = fixedError;
+        if (floatError > floatWorst) floatWorst = floatError;
+        if (fixedError - floatError > marginWorst) marginWorst = fixedError - floatError;
+        if (diff > diffWorst) diffWorst = diff;
+        if (peak > peakWorst) peakWorst = peak;
+        if (duration > durationWorst) durationWorst = duration;
+
+        if ((fx.frames >= MAX_FRAMES) || (fixedError > floatError + POSITION_MARGIN) ||
+            (duration > DURATION_DIFF_LIMIT) || (peak > PEAK_DIFF_LIMIT)) {
+            printf("FAIL move %d v %g a %g scurve %d: fixed %d frames %.3f steps peak %.4f, "
+                "float %d frames %.3f steps peak %.4f\n",
+                (int)distances[d], velocities[v], accelerations[a], scurve,
+                (int)fx.frames, fx.position, fx.peak, (int)fl.frames, fl.position, fl.peak);
+            failures++;
+        }
+    }
+    printf("position moves: %d\n", moves);
+    printf("  final position error: fixed %.3f steps, float %.3f steps, fixed over float %.3f steps (worst)\n",
+        fixedWorst, floatWorst, marginWorst);
+    printf("  fixed against float: position %.3f steps worst, %.3f mean, duration %d frames, peak velocity %.5f\n",
+        diffWorst, diffSum/moves, (int)durationWorst, peakWorst);
+    printf("short transient moves: %d\n", shortMoves);
+    printf("  against the ideal profile: final position error %.3f steps, duration %.5f (relative) worst\n",
+        shortWorst, stretchWorst);
+
+    // velocity slews
+    int slews = 0;
+    double slewWorst = 0;
+    long velocityWorst = 0;
+    for (char scurve = 0; scurve < 2; scurve++)
+    for (int s = 0; s < ns; s++)
+    for (int v = 0; v < nv; v++)
+    for (int sign = -1; sign <= 1; sign += 2) {
+        FP16 from = (FP16)(startVelocities[s]*65536);
+        FP16 to = (FP16)(sign*velocities[v]*65536);
+        FP16 acceleration = (FP16)(0.01*65536);
+        MoveResult fx = runSlew(&fixedPlanner, from, to, acceleration, scurve);
+
+        // a slew to the velocity that is already held is checked
+        // against holding the velocity
+        MoveResult fl = { fx.frames, fx.frames * (to/65536.0), 0.0, to };
+        if (from != to) fl = runSlew(&floatPlanner, from, to, acceleration, scurve);
+
+        double diff = absd(fx.position - fl.position)/(absd(fl.position) + 1.0);
+        long velocity = labs(fx.velocity - fl.velocity);
+        slews++;
+        if (diff > slewWorst) slewWorst = diff;
+        if (velocity > velocityWorst) velocityWorst = velocity;
+        if ((diff > SLEW_DIFF_LIMIT) || (fx.velocity != to)) {
+            printf("FAIL slew %g to %g scurve %d: fixed %.3f steps end %d, float %.3f steps end %d\n",
+                startVelocities[s], sign*velocities[v], scurve,
+                fx.position, (int)fx.velocity, fl.position, (int)fl.velocity);
+            failures++;
+        }
+    }
+    printf("velocity slews: %d\n", slews);
+    printf("  fixed against float: distance %.6f (relative), final velocity %d (FP16) worst\n",
+        slewWorst, (int)velocityWorst);
+
+    printf(failures ? "vprofiler golden: FAIL\n" : "vprofiler golden: PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,571 @@
+//    vfloat_float.c
+//
+//    This file is the floating point motion profile planner that was
+//    used by the userver before the planner was moved to fixed point
+//    math.  It is kept here, with its functions renamed to vfloat_*,
+//    as the reference for the vprofiler golden test.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#include <math.h>
+#include <stdlib.h>
+#include <avr/io.h>
+#include "vprofiler_float.h"
+
+#define PLAN_NONE     0
+#define PLAN_POSITION 1
+#define PLAN_VELOCITY 2
+
+#define PHASE_PENDING 0x7E
+
+// the segment set for one motion profile.  Plans are calculated in the
+// main loop into one set while the control loop integrates the other.
+typedef struct {
+	long gt1, gt2, gt3, gt4, gt5;
+	long gdx1, gdx2, gdx3, gdx4, gdx5;
+	long gv1, gv2, gv3, gv4;
+	long ga1, ga2, ga3, ga4;
+	long gj1, gj2, gj3, gj4;
+	long gj1_6, gj2_6, gj3_6, gj4_6;
+	long velocity;            // starting velocity
+	long acceleration;        // starting acceleration
+	long jerk;                // starting jerk
+} VProfilePlan;
+
+static long active_position;
+static long active_velocity;
+static long active_acceleration;
+static char active_scurve;
+
+static long current_t;
+long vfloat_velocity;      // fixed point 16 fractional bits
+static long current_acceleration;  // fixed point 16 fractional bits
+static long current_position;      // fixed point 16 fractional bits
+static long current_jerk;
+static long current_jerk6;
+
+static VProfilePlan plans[2];
+static VProfilePlan *activePlan = &plans[0];
+static VProfilePlan *nextPlan = &plans[1];
+
+static volatile char planRequest = PLAN_NONE;
+static volatile char planReady = 0;
+static volatile unsigned char planSequence = 0;
+
+static char estop = 0;
+static char phase = 0x7F;
+static long dwell = 10;            // the dwell time after the profile
+								   // completes before it registers as done.
+
+/********************************************************************
+* setParameters
+*
+* set the motion parameters for the next move.  The new parameters are
+* not used until the next motion is begun.
+*
+* parameters:
+*   deltax - a signed integer, that specifies the number of encoder
+*      steps that the motor should move.
+*   velocity - a 15.16 signed fixed point number for the target
+*      steady-state velocity of the profile. Although this number is
+*      signed, assume it is positive only.
+*   acceleration - a 15.16 signed fixed point number that specifies
+*      the average acceleration during the transient phase of the
+*      motion.  Acceleration must be more than 1/32000 times the velocity
+*      to avoid numeric overflow.
+*   scurve - nonzero if the profile should be an s-curve.  zero
+*      if the motion should be a trapezoid.
+*/
+void vfloat_setParameters(long deltax, FP16 velocity, FP16 acceleration, char scurve) {
+	active_position = deltax;
+	active_velocity = (deltax > 0) ? labs(velocity) : -1 * labs(velocity);
+	active_acceleration = (deltax > 0) ? labs(acceleration) : -1 * labs(acceleration);
+	active_scurve = scurve;
+}
+
+static FP16 calc_v(float v0, float a, float j, float dt) {
+	return FLOAT_TO_FP16(v0 + a * dt + j * dt * dt / 2.0f);
+}
+
+static FP16 calc_dx(float v0, float a, float j, float dt) {
+	return FLOAT_TO_FP16(v0*dt + a * dt*dt/2.0f + j * dt * dt * dt / 6.0f);
+}
+
+/********************************************************************
+* planPosition()
+*
+* calculate the trajectory parameters for a position-velocity move into
+* the given segment set.
+*
+* parameters:
+*   plan - the segment set to fill in
+*   active_position - the signed number of steps to move
+*   active_velocity - the 15.16 signed plateau velocity
+*   active_acceleration - the 15.16 signed average acceleration
+*   active_scurve - nonzero for an s-curve, zero for a trapezoid
+*/
+static void planPosition(VProfilePlan *plan, long active_position, long active_velocity, long active_acceleration, char active_scurve)
+{
+	// TODO - need to perform special case where position = 0
+	
+	float t2 = FP16_TO_FLOAT(active_velocity) / FP16_TO_FLOAT(active_acceleration);
+	// for scurve, average_acceleration = (1/2) peak_acceleration
+
+	// calculate the distance traveled if the the trajectory accelerates fully to
+	// the plateau velocity.
+	float xt2 = 0.5f * FP16_TO_FLOAT(active_acceleration) * t2 * t2;
+	float t3 = t2 + ((float)active_position-2.0f*xt2) / FP16_TO_FLOAT(active_velocity);
+	float jerk = 0.0f;
+	float vprofile = FP16_TO_FLOAT(active_velocity);
+
+	if (active_scurve) jerk = FP16_TO_FLOAT(active_acceleration) * 4.0f / t2;
+	if (fabs(xt2) >= fabs((float)active_position) / 2.0f) {
+		// truncated - average acceleration remains as requested transient and
+		// plateau times change
+		t2 = sqrt((float)active_position / FP16_TO_FLOAT(active_acceleration));
+		t3 = t2;
+		xt2 = 0.5f * FP16_TO_FLOAT(active_acceleration) * t2 * t2;
+		// calculate the plateau velocity
+		if (active_scurve) jerk = FP16_TO_FLOAT(active_acceleration)*4.0f / t2;
+		vprofile = FP16_TO_FLOAT(active_acceleration) * t2;
+	}
+	// float dxt3 = (float)active_position - 2.0 * xt2;
+
+	// calculate the time points for each transition
+	// half way through the acceleration transient
+	plan->gt1 = (long)(t2 / 2.0 + 1.0);
+	plan->gt2 = (long)(t2 + 1.0);
+	plan->gt3 = (long)(t3)+1;
+	plan->gt4 = (long)(t3 + t2 / 2.0 + 1.0);
+	plan->gt5 = (long)(t3 + t2 + 1.0);
+
+	float deltat;
+	deltat = (float)plan->gt1 - (t2 / 2.0f);
+	plan->gdx1 = (active_scurve) ?
+		calc_dx(vprofile/2.0, +2.0f * FP16_TO_FLOAT(active_acceleration), -jerk, deltat) :
+		calc_dx(vprofile / 2.0, +FP16_TO_FLOAT(active_acceleration), 0.0f, deltat);
+	plan->gdx1 -= (active_scurve) ?
+		calc_dx(vprofile / 2.0, 2.0f * FP16_TO_FLOAT(active_acceleration), jerk, (deltat - 1.0f)) :
+		calc_dx(vprofile / 2.0, FP16_TO_FLOAT(active_acceleration), 0.0f, (deltat - 1.0f));
+	plan->gv1 = (active_scurve) ?
+		calc_v(vprofile / 2.0, + 2.0f * FP16_TO_FLOAT(active_acceleration),-jerk,deltat) :
+		calc_v(vprofile / 2.0, + FP16_TO_FLOAT(active_acceleration), 0.0f, deltat);
+	plan->ga1 = FLOAT_TO_FP16((active_scurve) ?
+		2.0f * FP16_TO_FLOAT(active_acceleration) - jerk * deltat :
+		FP16_TO_FLOAT(active_acceleration));
+	plan->gj1 = FLOAT_TO_FP16((active_scurve) ?-jerk : 0.0f);
+	plan->gj1_6 = plan->gj1 / 6;
+
+	deltat = (float)plan->gt2 - t2;
+	plan->gdx2 = calc_dx(vprofile, 0, 0, deltat);
+	plan->gdx2 -= (active_scurve) ?
+		calc_dx(vprofile, 0, -jerk, (deltat - 1.0f)) :
+		calc_dx(vprofile, FP16_TO_FLOAT(active_acceleration), 0.0f, (deltat - 1.0f));
+	plan->gv2 = FLOAT_TO_FP16(vprofile);
+	plan->ga2 = 0;
+	plan->gj2 = 0;
+	plan->gj2_6 = plan->gj2 / 6;
+
+	deltat = (float)plan->gt3 - t3;
+	plan->gdx3 = (active_scurve) ?
+		calc_dx(vprofile, 0, -jerk, deltat) :
+		calc_dx(vprofile, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
+	if (plan->gt2 == plan->gt3) {
+		// truncated waveform
+		plan->gdx3 -= (active_scurve) ?
+			calc_dx(vprofile, 0, -jerk, (deltat - 1.0f)) :
+			calc_dx(vprofile, FP16_TO_FLOAT(active_acceleration), 0.0f, (deltat - 1.0f));
+	}
+	else {
+		// full waveform
+		plan->gdx3 -= (active_scurve) ?
+			calc_dx(vprofile, 0, 0, (deltat - 1.0)) :
+			calc_dx(vprofile, 0, 0.0f, (deltat - 1.0));
+	}
+	plan->gv3 = (active_scurve) ?
+		calc_v(vprofile, 0, -jerk, deltat) :
+		calc_v(vprofile, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
+	plan->ga3 = FLOAT_TO_FP16((active_scurve) ?- jerk * deltat : FP16_TO_FLOAT(-active_acceleration));
+	plan->gj3 = FLOAT_TO_FP16((active_scurve) ? -jerk : 0.0f);
+	plan->gj3_6 = plan->gj3 / 6;
+
+	deltat = (float)plan->gt4 - (t3 + t2 / 2.0f);
+	plan->gdx4 = (active_scurve) ?
+		calc_dx(vprofile / 2.0f, 2.0f * FP16_TO_FLOAT(-active_acceleration), +jerk, deltat) :
+		calc_dx(vprofile / 2.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
+	plan->gdx4 -= (active_scurve) ?
+		calc_dx(vprofile / 2.0f, 2.0f * FP16_TO_FLOAT(-active_acceleration), -jerk, (deltat-1.0f)) :
+		calc_dx(vprofile / 2.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, (deltat-1.0f));
+	plan->gv4 = (active_scurve) ?
+		calc_v(vprofile/2.0f, 2.0f * FP16_TO_FLOAT(-active_acceleration), +jerk, deltat) :
+		calc_v(vprofile/2.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, deltat);
+	plan->ga4 = FLOAT_TO_FP16((active_scurve) ?
+		2.0f * FP16_TO_FLOAT(-active_acceleration) + jerk * deltat :
+		FP16_TO_FLOAT(-active_acceleration));
+	plan->gj4 = FLOAT_TO_FP16((active_scurve) ? +jerk : 0.0f);
+	plan->gj4_6 = plan->gj4 / 6;
+
+	deltat = (float)plan->gt5 - (t2 + t3);
+	plan->gdx5 = (active_scurve) ?
+		-calc_dx(0.0f, 0.0f, jerk, (deltat - 1.0f)) :
+		-calc_dx(0.0f, FP16_TO_FLOAT(-active_acceleration), 0.0f, (deltat - 1.0f));
+
+	plan->velocity = 0;
+	plan->jerk = FLOAT_TO_FP16(jerk);
+	plan->acceleration = (active_scurve) ? 0 : active_acceleration;
+}
+
+/********************************************************************
+* planVelocity()
+*
+* calculate the trajectory parameters for a controlled velocity slew
+* into the given segment set.
+*
+* parameters:
+*   plan - the segment set to fill in
+*   vfloat_velocity - the 15.16 velocity the slew begins from
+*   active_velocity - the 15.16 signed target velocity
+*   active_acceleration - the 15.16 signed average acceleration
+*   active_scurve - nonzero for an s-curve, zero for a trapezoid
+*/
+static void planVelocity(VProfilePlan *plan, long vfloat_velocity, long active_velocity, long active_acceleration, char active_scurve)
+{
+	float t2 = FP16_TO_FLOAT(active_velocity-vfloat_velocity) / FP16_TO_FLOAT(active_acceleration);
+	if (t2<0) {
+		active_acceleration = -active_acceleration;
+		t2 = -t2;
+	}
+
+	// calculate the jerk for scurve moves
+	float jerk = 0.0f;
+	float vplateau = FP16_TO_FLOAT(active_velocity);	
+	if (active_scurve) jerk = FP16_TO_FLOAT(active_acceleration) * 4.0f / t2;
+
+	// calculate the time points for each transition.
+	plan->gt1 = (long)(t2 / 2.0 + 1.0);  	// half way through the acceleration transient
+	plan->gt2 = (long)(t2 + 1.0);			// the beginning of the constant velocity phase
+
+	// plan->gv1 is the velocity at the sample period immediately at (or after) the first
+	// transition point.  plan->ga1 is the acceleration immediately at (or after) the first
+	// transition point.
+	float deltat;
+	deltat = (float)plan->gt1 - (t2 / 2.0f);
+	plan->gv1 = (active_scurve) ?
+		calc_v(((FP16_TO_FLOAT(vfloat_velocity)) + vplateau) / 2.0, + 2.0f * FP16_TO_FLOAT(active_acceleration),-jerk,deltat) :
+		calc_v(((FP16_TO_FLOAT(vfloat_velocity)) + vplateau) / 2.0, + FP16_TO_FLOAT(active_acceleration), 0.0f, deltat);
+	plan->ga1 = FLOAT_TO_FP16((active_scurve) ?
+		2.0f * FP16_TO_FLOAT(active_acceleration) - jerk * deltat :
+		FP16_TO_FLOAT(active_acceleration));
+	plan->gj1 = FLOAT_TO_FP16((active_scurve) ?-jerk : 0.0f);
+	plan->gj1_6 = plan->gj1 / 6;
+
+	// plan->gv2 is the velocity at the sample period immediately at (or after) the second
+	// transition point.  plan->ga1 is the acceleration immediately at (or after) the second
+	// transition point.
+	deltat = (float)plan->gt2 - t2;
+	plan->gv2 = FLOAT_TO_FP16(vplateau);
+	plan->ga2 = 0;
+	plan->gj2 = 0;
+	plan->gj2_6 = plan->gj2 / 6;
+
+	// the slew begins at the current velocity
+	plan->velocity = vfloat_velocity;
+	plan->jerk = FLOAT_TO_FP16(jerk);
+	plan->acceleration = (active_scurve) ? 0 : active_acceleration;
+}
+
+/********************************************************************
+* requestPlan()
+*
+* ask the main loop to plan a new profile from the most recently set
+* motion parameters.  Any plan that is in progress or waiting to be
+* swapped in is discarded.  The trajectory holds its present velocity
+* until the new plan becomes active.
+*
+* parameters:
+*   kind - PLAN_POSITION or PLAN_VELOCITY
+*/
+static void requestPlan(char kind)
+{
+	unsigned char sreg = SREG;
+	__builtin_avr_cli();
+	planSequence++;
+	planReady = 0;
+	planRequest = kind;
+	phase = PHASE_PENDING;
+	SREG = sreg;
+}
+
+/********************************************************************
+* vfloat_start()
+*
+* request a position-velocity move using the most recently set motion
+* parameters.  The segments are calculated by vfloat_plan() from the
+* main loop and the move begins at the first sample period after the
+* plan is ready.  For velocity only moves, use vfloat_startv().
+*/
+void vfloat_start()
+{
+	requestPlan(PLAN_POSITION);
+}
+
+/********************************************************************
+* vfloat_startv()
+*
+* request a controlled velocity slew using the most recently set motion
+* parameters.  The slew begins from the velocity held while the plan is
+* being calculated.  For position-velocity moves, use vfloat_start().
+*/
+void vfloat_startv()
+{
+	requestPlan(PLAN_VELOCITY);
+}
+
+/********************************************************************
+* vfloat_plan()
+*
+* calculate any requested profile into the inactive segment set.  This
+* function performs the floating point work for a new move and should be
+* called from the main loop rather than the control loop.  The plan is
+* only published if no newer request arrived while it was calculated.
+*/
+void vfloat_plan()
+{
+	unsigned char sreg = SREG;
+	__builtin_avr_cli();
+	char kind = planRequest;
+	unsigned char sequence = planSequence;
+	long position = active_position;
+	long velocity = active_velocity;
+	long acceleration = active_acceleration;
+	char scurve = active_scurve;
+	long v0 = vfloat_velocity;
+	planRequest = PLAN_NONE;
+	SREG = sreg;
+
+	if (kind == PLAN_NONE) return;
+	if (kind == PLAN_POSITION) {
+		planPosition(nextPlan, position, velocity, acceleration, scurve);
+	} else {
+		planVelocity(nextPlan, v0, velocity, acceleration, scurve);
+	}
+
+	// publish the plan unless it was superseded while being calculated
+	sreg = SREG;
+	__builtin_avr_cli();
+	if (sequence == planSequence) planReady = 1;
+	SREG = sreg;
+}
+
+/********************************************************************
+* swapPlan()
+*
+* make the newly calculated segment set active and load the starting
+* conditions for its first phase.  Called from the control loop at a
+* sample period boundary.
+*/
+static void swapPlan()
+{
+	VProfilePlan *plan = nextPlan;
+	nextPlan = activePlan;
+	activePlan = plan;
+	planReady = 0;
+
+	current_position = 0;
+	vfloat_velocity = plan->velocity;
+	current_jerk = plan->jerk;
+	current_jerk6 = current_jerk / 6;
+	current_acceleration = plan->acceleration;
+	current_t = plan->gt1;
+	phase = 0;
+}
+
+void vfloat_stop()
+{
+    estop = 1;
+}
+
+/********************************************************************
+* update
+*
+* this function should be called once per sample period.  It updates
+* the motion trajectory based on trajectory paramters that were
+* previously set.
+*/
+void vfloat_update() {
+    if (estop) {
+        vfloat_velocity = 0;
+        current_acceleration = 0;
+        current_jerk = 0;
+        current_jerk6 = 0;
+        phase = 5;
+        estop = 0;
+        current_t = dwell;
+
+        // discard any plan that has not started
+        planSequence++;
+        planRequest = PLAN_NONE;
+        planReady = 0;
+    }
+	if (phase == PHASE_PENDING) {
+		// hold the present velocity until the requested plan is ready
+		// then make it active at this sample period boundary
+		if (planReady) {
+			swapPlan();
+		} else {
+			current_position = vfloat_velocity;
+		}
+		return;
+	}
+	if (current_t == 1) {
+		switch (phase) {
+			case 0:
+				// second half of acceleration transient
+				current_position = activePlan->gdx1;
+				vfloat_velocity = activePlan->gv1;
+				current_acceleration = activePlan->ga1;
+				current_jerk = activePlan->gj1;
+				current_jerk6 = activePlan->gj1_6;
+				current_t = activePlan->gt2 - activePlan->gt1;
+				phase = (activePlan->gt2 == activePlan->gt3) ? 2 : 1;
+				break;
+			case 1:
+				// start of velocity plateau
+				current_position = activePlan->gdx2;
+				vfloat_velocity = activePlan->gv2;
+				current_acceleration = activePlan->ga2;
+				current_jerk = activePlan->gj2;
+				current_jerk6 = activePlan->gj2_6;
+				current_t = activePlan->gt3 - activePlan->gt2;
+				phase = 2;
+				break;
+			case 2:
+				// end of velocity plateau
+				current_position = activePlan->gdx3;
+				vfloat_velocity = activePlan->gv3;
+				current_acceleration = activePlan->ga3;
+				current_jerk = activePlan->gj3;
+				current_jerk6 = activePlan->gj3_6;
+				current_t = activePlan->gt4 - activePlan->gt3;
+				phase = 3;
+				break;
+			case 3:
+				// second half of deceleration transient
+				current_position = activePlan->gdx4;
+				vfloat_velocity = activePlan->gv4;
+				current_acceleration = activePlan->ga4;
+				current_jerk = activePlan->gj4;
+				current_jerk6 = activePlan->gj4_6;
+				phase = 4;
+				current_t = activePlan->gt5 - activePlan->gt4;
+				break;
+			case 4:
+				// completion of motion
+				current_position = activePlan->gdx5;
+				vfloat_velocity = 0;
+				current_acceleration = 0;
+				current_jerk = 0;
+				current_jerk6 = 0;
+				phase = 5;
+				current_t = dwell;
+				break;
+			default:
+				// dwell time expired
+				current_t = 0xFFFFFFFF;
+				phase = 0x7F;
+				break;
+		}
+	}
+	else {
+		current_position = vfloat_velocity + current_acceleration / 2 + current_jerk6;
+		vfloat_velocity += current_acceleration + current_jerk / 2;
+		current_acceleration += current_jerk;
+		current_t--;
+	}
+}
+
+/********************************************************************
+* vfloat_updatev
+*
+* this function should be called once per sample period for velocity
+* only moves.  It updates the motion trajectory based on trajectory 
+* paramters that were previously set.
+*/
+void vfloat_updatev() {
+    if (estop) {
+        vfloat_velocity = 0;
+        current_acceleration = 0;
+        current_jerk = 0;
+        current_jerk6 = 0;
+        phase = 5;
+        estop = 0;
+        current_t = dwell;
+
+        // discard any plan that has not started
+        planSequence++;
+        planRequest = PLAN_NONE;
+        planReady = 0;
+    }
+	if (phase == PHASE_PENDING) {
+		// hold the present velocity until the requested plan is ready
+		// then make it active at this sample period boundary
+		if (planReady) {
+			swapPlan();
+		} else {
+			current_position = vfloat_velocity;
+		}
+		return;
+	}
+	if (current_t == 1) {
+		// current_t is a countdown timer until the end of the 
+		// current motion phase.  When it reaches 1, it is time
+		// to load the parameters for the next motion phase
+		switch (phase) {
+			case 0:
+				// second half of acceleration transient
+				vfloat_velocity = activePlan->gv1;
+				current_acceleration = activePlan->ga1;
+				current_jerk = activePlan->gj1;
+				current_jerk6 = activePlan->gj1_6;
+				current_t = activePlan->gt2 - activePlan->gt1;
+				phase = (activePlan->gt2 == activePlan->gt3) ? 2 : 1;
+				break;
+			default:
+				// start of velocity plateau
+				vfloat_velocity = activePlan->gv2;
+				current_acceleration = activePlan->ga2;
+				current_jerk = activePlan->gj2;
+				current_jerk6 = activePlan->gj2_6;
+				current_t = 10000;   // set current_t above 1
+				phase = 2;
+				break;
+		}
+	}
+	else {
+		current_position = vfloat_velocity + current_acceleration / 2 + current_jerk6;
+		vfloat_velocity += current_acceleration + current_jerk / 2;
+		current_acceleration += current_jerk;
+		if (phase!=2) current_t--;
+	}
+}
+
+unsigned char vfloat_isDone() {
+	return phase == 0x7f;
+}
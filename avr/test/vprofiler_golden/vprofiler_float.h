@@ -0,0 +1,37 @@
+//    vprofiler_float.h
+//
+//    This header file declares the floating point reference planner
+//    used by the vprofiler golden test.
+//    
+//    More information on the PICMG IoT data model can be found within
+//    the PICMG family of IoT specifications.  For more information,
+//    please visit the PICMG web site (www.picmg.org)
+//
+//    Copyright (C) 2021,  PICMG
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+#include "vprofiler.h"
+
+void vfloat_setParameters(long deltax, FP16 velocity, FP16 acceleration, char scurve);
+void vfloat_start();
+void vfloat_update();
+void vfloat_startv();
+void vfloat_updatev();
+void vfloat_plan();
+void vfloat_stop();
+unsigned char vfloat_isDone();
+
+extern long vfloat_velocity;